@@ -0,0 +1,13 @@
+#!/bin/bash
+set -e
+DIR="$( cd "$( dirname "${BASH_SOURCE}" )" && pwd )"
+
+ROOT_DIR="${DIR}/.."
+BUILD_DIR="${ROOT_DIR}/build/tsan"
+
+mkdir -p "${BUILD_DIR}"
+(cd "${BUILD_DIR}" && cmake "${ROOT_DIR}" -DCMAKE_BUILD_TYPE=Debug -DBUILD_WITH_TSAN=ON)
+(cd "${BUILD_DIR}" && cmake --build .)
+# joins take the locks of several storages in the order of their terms,
+# so only data races are reported here, not lock order inversions
+(cd "${BUILD_DIR}" && TSAN_OPTIONS="detect_deadlocks=0" ctest --verbose)
@@ -9,18 +9,26 @@
 #include <cassert>
 #include <cstddef>
 #include <cstdint>
+#include <cstdlib>
+#include <cstring>
 
+#include <new>
 #include <tuple>
+#include <atomic>
+#include <chrono>
 #include <memory>
 #include <vector>
+#include <optional>
 #include <limits>
 #include <utility>
 #include <iterator>
 #include <stdexcept>
 #include <algorithm>
 #include <functional>
+#include <unordered_map>
 #include <type_traits>
 #include <shared_mutex>
+#include <memory_resource>
 #include <mutex>
 
 
@@ -31,6 +39,33 @@
 //
 // -----------------------------------------------------------------------------
 
+// define ECS_HPP_NO_EXCEPTIONS to replace all throws with assert and abort,
+// it's defined automatically when exceptions are disabled by the compiler
+
+#if !defined(ECS_HPP_NO_EXCEPTIONS)
+#  if !defined(__cpp_exceptions) && !defined(__EXCEPTIONS) && !defined(_CPPUNWIND)
+#    define ECS_HPP_NO_EXCEPTIONS
+#  endif
+#endif
+
+#if defined(ECS_HPP_NO_EXCEPTIONS)
+#  define ECS_HPP_TRY if ( true )
+#  define ECS_HPP_CATCH_ALL if ( false )
+#  define ECS_HPP_RETHROW
+#else
+#  define ECS_HPP_TRY try
+#  define ECS_HPP_CATCH_ALL catch (...)
+#  define ECS_HPP_RETHROW throw
+#endif
+
+#if defined(__GNUC__) || defined(__clang__)
+#  define ECS_HPP_COLD __attribute__((cold, noinline))
+#elif defined(_MSC_VER)
+#  define ECS_HPP_COLD __declspec(noinline)
+#else
+#  define ECS_HPP_COLD
+#endif
+
 namespace ecs_hpp
 {
     class entity;
@@ -42,6 +77,7 @@ namespace ecs_hpp
     class const_component;
 
     class prototype;
+    class compiled_prototype;
 
     template < typename E >
     class after;
@@ -53,6 +89,11 @@ namespace ecs_hpp
     class feature;
     class registry;
 
+    template < typename Registry >
+    class static_entity;
+    template < typename... Cs >
+    class static_registry;
+
     template < typename T >
     class exists;
     template < typename... Ts >
@@ -68,11 +109,22 @@ namespace ecs_hpp
     class option_disj;
     class option_bool;
 
+    template < typename T >
+    class without;
+    template < typename T >
+    class maybe;
+    template < typename R >
+    class related;
+
     template < typename... Ts >
     class aspect;
 
     class entity_filler;
     class registry_filler;
+
+    struct runtime_component_info;
+    class runtime_query;
+    class iteration_cursor;
 }
 
 namespace ecs_hpp
@@ -83,6 +135,8 @@ namespace ecs_hpp
     constexpr std::size_t entity_id_index_bits = 22u;
     constexpr std::size_t entity_id_version_bits = 10u;
 
+    constexpr family_id static_family_id_limit = 64u;
+
     static_assert(
         std::is_unsigned_v<family_id>,
         "ecs_hpp (family_id must be an unsigned integer)");
@@ -91,11 +145,21 @@ namespace ecs_hpp
         std::is_unsigned_v<entity_id>,
         "ecs_hpp (entity_id must be an unsigned integer)");
 
+    static_assert(
+        static_family_id_limit > 0u,
+        "ecs_hpp (invalid static family id limit)");
+
     static_assert(
         entity_id_index_bits > 0u &&
         entity_id_version_bits > 0u &&
         sizeof(entity_id) == (entity_id_index_bits + entity_id_version_bits) / 8u,
         "ecs_hpp (invalid entity id index and version bits)");
+
+    enum class status : std::uint8_t {
+        ok,
+        entity_capacity_exhausted,
+        component_capacity_exhausted
+    };
 }
 
 // -----------------------------------------------------------------------------
@@ -106,6 +170,41 @@ namespace ecs_hpp
 
 namespace ecs_hpp::detail
 {
+    //
+    // throw_*
+    //
+    // Out of line, so inlined hot paths keep only a call on the cold branch.
+    //
+
+    [[noreturn]] ECS_HPP_COLD inline void throw_logic_error(const char* what) {
+    #if defined(ECS_HPP_NO_EXCEPTIONS)
+        assert(false && what);
+        (void)what;
+        std::abort();
+    #else
+        throw std::logic_error(what);
+    #endif
+    }
+
+    [[noreturn]] ECS_HPP_COLD inline void throw_length_error(const char* what) {
+    #if defined(ECS_HPP_NO_EXCEPTIONS)
+        assert(false && what);
+        (void)what;
+        std::abort();
+    #else
+        throw std::length_error(what);
+    #endif
+    }
+
+    [[noreturn]] ECS_HPP_COLD inline void throw_bad_array_new_length() {
+    #if defined(ECS_HPP_NO_EXCEPTIONS)
+        assert(false && "bad array new length");
+        std::abort();
+    #else
+        throw std::bad_array_new_length();
+    #endif
+    }
+
     //
     // hash_combine
     //
@@ -114,6 +213,16 @@ namespace ecs_hpp::detail
         return l ^ (r + 0x9e3779b9 + (l << 6) + (l >> 2));
     }
 
+    //
+    // mix_hash
+    //
+
+    constexpr std::uint64_t mix_hash(std::uint64_t v) noexcept {
+        v = (v ^ (v >> 30u)) * 0xbf58476d1ce4e5b9u;
+        v = (v ^ (v >> 27u)) * 0x94d049bb133111ebu;
+        return v ^ (v >> 31u);
+    }
+
     //
     // tuple_tail
     //
@@ -178,6 +287,28 @@ namespace ecs_hpp::detail
             v);
     }
 
+    //
+    // is_one_of
+    //
+
+    template < typename T, typename... Ts >
+    inline constexpr bool is_one_of_v = (... || std::is_same_v<T, Ts>);
+
+    //
+    // are_unique
+    //
+
+    template < typename... Ts >
+    struct are_unique
+    : std::true_type {};
+
+    template < typename T, typename... Ts >
+    struct are_unique<T, Ts...>
+    : std::bool_constant<!is_one_of_v<T, Ts...> && are_unique<Ts...>::value> {};
+
+    template < typename... Ts >
+    inline constexpr bool are_unique_v = are_unique<Ts...>::value;
+
     //
     // next_capacity_size
     //
@@ -188,7 +319,7 @@ namespace ecs_hpp::detail
         std::size_t max_size)
     {
         if ( min_size > max_size ) {
-            throw std::length_error("ecs_hpp::next_capacity_size");
+            throw_length_error("ecs_hpp::next_capacity_size");
         }
         if ( cur_size >= max_size / 2u ) {
             return max_size;
@@ -196,6 +327,23 @@ namespace ecs_hpp::detail
         return std::max(cur_size * 2u, min_size);
     }
 
+    //
+    // count_trailing_zeros
+    //
+
+    inline unsigned count_trailing_zeros(std::uint64_t v) noexcept {
+        assert(v);
+    #if defined(__GNUC__) || defined(__clang__)
+        return static_cast<unsigned>(__builtin_ctzll(v));
+    #else
+        unsigned count = 0u;
+        for ( ; !(v & 1u); v >>= 1u ) {
+            ++count;
+        }
+        return count;
+    #endif
+    }
+
     //
     // entity_id index/version
     //
@@ -228,29 +376,138 @@ namespace ecs_hpp::detail
 //
 // -----------------------------------------------------------------------------
 
+namespace ecs_hpp
+{
+    //
+    // static_family_id
+    //
+    // Specialize it for a type to give the type a fixed family id:
+    //
+    // template <>
+    // struct ecs_hpp::static_family_id<position>
+    // : std::integral_constant<ecs_hpp::family_id, 1u> {};
+    //
+    // Fixed ids must be in [1, static_family_id_limit) and are the same
+    // in every translation unit, shared library and run. All other types
+    // get ids from static_family_id_limit upwards on the first use.
+    //
+
+    template < typename T >
+    struct static_family_id {};
+}
+
 namespace ecs_hpp::detail
 {
+    template < typename T, typename = void >
+    struct has_static_family_id
+    : std::false_type {};
+
+    template < typename T >
+    struct has_static_family_id<T, std::void_t<decltype(static_family_id<T>::value)>>
+    : std::true_type {};
+
+    template < typename T >
+    inline constexpr bool has_static_family_id_v = has_static_family_id<T>::value;
+
     template < typename Void = void >
     class type_family_base {
         static_assert(
             std::is_void_v<Void>,
             "unexpected internal error");
-    protected:
-        static family_id last_id_;
+    public:
+        static family_id next_id() noexcept {
+            const family_id self_id = static_cast<family_id>(
+                static_family_id_limit + last_id_.fetch_add(1u, std::memory_order_relaxed));
+            assert(self_id >= static_family_id_limit && "ecs_hpp::family_id overflow");
+            return self_id;
+        }
+    private:
+        static std::atomic<family_id> last_id_;
     };
 
     template < typename T >
     class type_family final : public type_family_base<> {
     public:
         static family_id id() noexcept {
-            static family_id self_id = ++last_id_;
-            assert(self_id > 0u && "ecs_hpp::family_id overflow");
-            return self_id;
+            if constexpr ( has_static_family_id_v<T> ) {
+                static_assert(
+                    static_family_id<T>::value > 0u &&
+                    static_family_id<T>::value < static_family_id_limit,
+                    "ecs_hpp (static family id out of range)");
+                return static_family_id<T>::value;
+            } else {
+                static const family_id self_id = next_id();
+                return self_id;
+            }
         }
     };
 
     template < typename Void >
-    family_id type_family_base<Void>::last_id_ = 0u;
+    std::atomic<family_id> type_family_base<Void>::last_id_{0u};
+}
+
+// -----------------------------------------------------------------------------
+//
+// detail::resource_allocator
+//
+// -----------------------------------------------------------------------------
+
+namespace ecs_hpp::detail
+{
+    // unlike std::pmr::polymorphic_allocator it propagates on copy, move and swap,
+    // so containers keep their value semantics and noexcept moves
+
+    template < typename T >
+    class resource_allocator {
+    public:
+        using value_type = T;
+        using propagate_on_container_copy_assignment = std::true_type;
+        using propagate_on_container_move_assignment = std::true_type;
+        using propagate_on_container_swap = std::true_type;
+    public:
+        resource_allocator() noexcept
+        : resource_(std::pmr::get_default_resource()) {}
+
+        resource_allocator(std::pmr::memory_resource* resource) noexcept
+        : resource_(resource) {
+            assert(resource);
+        }
+
+        template < typename U >
+        resource_allocator(const resource_allocator<U>& other) noexcept
+        : resource_(other.resource()) {}
+
+        T* allocate(std::size_t n) {
+            if ( n > std::numeric_limits<std::size_t>::max() / sizeof(T) ) {
+                throw_bad_array_new_length();
+            }
+            return static_cast<T*>(resource_->allocate(n * sizeof(T), alignof(T)));
+        }
+
+        void deallocate(T* p, std::size_t n) noexcept {
+            resource_->deallocate(p, n * sizeof(T), alignof(T));
+        }
+
+        std::pmr::memory_resource* resource() const noexcept {
+            return resource_;
+        }
+    private:
+        std::pmr::memory_resource* resource_{nullptr};
+    };
+
+    template < typename T, typename U >
+    bool operator==(const resource_allocator<T>& l, const resource_allocator<U>& r) noexcept {
+        return l.resource() == r.resource()
+            || l.resource()->is_equal(*r.resource());
+    }
+
+    template < typename T, typename U >
+    bool operator!=(const resource_allocator<T>& l, const resource_allocator<U>& r) noexcept {
+        return !(l == r);
+    }
+
+    template < typename T >
+    using resource_vector = std::vector<T, resource_allocator<T>>;
 }
 
 // -----------------------------------------------------------------------------
@@ -351,8 +608,8 @@ namespace ecs_hpp::detail
              , typename Indexer = sparse_indexer<T> >
     class sparse_set final {
     public:
-        using iterator = typename std::vector<T>::iterator;
-        using const_iterator = typename std::vector<T>::const_iterator;
+        using iterator = typename resource_vector<T>::iterator;
+        using const_iterator = typename resource_vector<T>::const_iterator;
     public:
         iterator begin() noexcept {
             return dense_.begin();
@@ -381,6 +638,11 @@ namespace ecs_hpp::detail
         sparse_set(const Indexer& indexer = Indexer())
         : indexer_(indexer) {}
 
+        explicit sparse_set(std::pmr::memory_resource* resource, const Indexer& indexer = Indexer())
+        : indexer_(indexer)
+        , dense_(resource)
+        , sparse_(resource) {}
+
         sparse_set(const sparse_set& other) = default;
         sparse_set& operator=(const sparse_set& other) = default;
 
@@ -423,10 +685,63 @@ namespace ecs_hpp::detail
             return true;
         }
 
+        void swap_dense(std::size_t l, std::size_t r) noexcept {
+            assert(l < dense_.size() && r < dense_.size());
+            using std::swap;
+            swap(dense_[l], dense_[r]);
+            sparse_[indexer_(dense_[l])] = l;
+            sparse_[indexer_(dense_[r])] = r;
+        }
+
         void clear() noexcept {
             dense_.clear();
         }
 
+        void reserve(std::size_t capacity) {
+            dense_.reserve(capacity);
+        }
+
+        std::size_t capacity() const noexcept {
+            return dense_.capacity();
+        }
+
+        void reserve_indices(std::size_t count) {
+            if ( count > sparse_.size() ) {
+                sparse_.resize(count);
+            }
+        }
+
+        std::size_t index_capacity() const noexcept {
+            return sparse_.size();
+        }
+
+        // true when inserting the value does not allocate
+        bool fits(const T& v) const noexcept {
+            return has(v)
+                || (dense_.size() < dense_.capacity() && indexer_(v) < sparse_.size());
+        }
+
+        template < typename Compare >
+        void sort(Compare comp) {
+            std::sort(dense_.begin(), dense_.end(), comp);
+            for ( std::size_t i = 0; i < dense_.size(); ++i ) {
+                sparse_[indexer_(dense_[i])] = i;
+            }
+        }
+
+        void permute(const std::vector<std::size_t>& order) {
+            assert(order.size() == dense_.size());
+            resource_vector<T> new_dense(dense_.get_allocator());
+            new_dense.reserve(dense_.size());
+            for ( const std::size_t index : order ) {
+                new_dense.push_back(std::move(dense_[index]));
+            }
+            dense_.swap(new_dense);
+            for ( std::size_t i = 0; i < dense_.size(); ++i ) {
+                sparse_[indexer_(dense_[i])] = i;
+            }
+        }
+
         bool has(const T& v) const noexcept {
             const std::size_t vi = indexer_(v);
             return vi < sparse_.size()
@@ -445,7 +760,7 @@ namespace ecs_hpp::detail
             if ( p.second ) {
                 return p.first;
             }
-            throw std::logic_error("ecs_hpp::sparse_set (value not found)");
+            throw_logic_error("ecs_hpp::sparse_set (value not found)");
         }
 
         std::pair<std::size_t,bool> find_dense_index(const T& v) const noexcept {
@@ -454,6 +769,10 @@ namespace ecs_hpp::detail
                 : std::make_pair(std::size_t(-1), false);
         }
 
+        const T* data() const noexcept {
+            return dense_.data();
+        }
+
         bool empty() const noexcept {
             return dense_.empty();
         }
@@ -466,10 +785,14 @@ namespace ecs_hpp::detail
             return dense_.capacity() * sizeof(dense_[0])
                 + sparse_.capacity() * sizeof(sparse_[0]);
         }
+
+        std::pmr::memory_resource* resource() const noexcept {
+            return dense_.get_allocator().resource();
+        }
     private:
         Indexer indexer_;
-        std::vector<T> dense_;
-        std::vector<std::size_t> sparse_;
+        resource_vector<T> dense_;
+        resource_vector<std::size_t> sparse_;
     };
 
     template < typename T
@@ -495,8 +818,8 @@ namespace ecs_hpp::detail
              , typename Indexer = sparse_indexer<K> >
     class sparse_map final {
     public:
-        using iterator = typename std::vector<K>::iterator;
-        using const_iterator = typename std::vector<K>::const_iterator;
+        using iterator = typename resource_vector<K>::iterator;
+        using const_iterator = typename resource_vector<K>::const_iterator;
     public:
         iterator begin() noexcept {
             return keys_.begin();
@@ -525,6 +848,10 @@ namespace ecs_hpp::detail
         sparse_map(const Indexer& indexer = Indexer())
         : keys_(indexer) {}
 
+        explicit sparse_map(std::pmr::memory_resource* resource, const Indexer& indexer = Indexer())
+        : keys_(resource, indexer)
+        , values_(resource) {}
+
         sparse_map(const sparse_map& other) = default;
         sparse_map& operator=(const sparse_map& other) = default;
 
@@ -543,12 +870,12 @@ namespace ecs_hpp::detail
                 return std::make_pair(value, false);
             }
             values_.push_back(std::forward<UT>(v));
-            try {
+            ECS_HPP_TRY {
                 keys_.insert(std::forward<UK>(k));
                 return std::make_pair(&values_.back(), true);
-            } catch (...) {
+            } ECS_HPP_CATCH_ALL {
                 values_.pop_back();
-                throw;
+                ECS_HPP_RETHROW;
             }
         }
 
@@ -559,12 +886,12 @@ namespace ecs_hpp::detail
                 return std::make_pair(value, false);
             }
             values_.push_back(std::forward<UT>(v));
-            try {
+            ECS_HPP_TRY {
                 keys_.insert(std::forward<UK>(k));
                 return std::make_pair(&values_.back(), true);
-            } catch (...) {
+            } ECS_HPP_CATCH_ALL {
                 values_.pop_back();
-                throw;
+                ECS_HPP_RETHROW;
             }
         }
 
@@ -582,11 +909,54 @@ namespace ecs_hpp::detail
             return true;
         }
 
+        void swap_dense(std::size_t l, std::size_t r) noexcept {
+            using std::swap;
+            keys_.swap_dense(l, r);
+            swap(values_[l], values_[r]);
+        }
+
         void clear() noexcept {
             keys_.clear();
             values_.clear();
         }
 
+        void reserve(std::size_t capacity) {
+            keys_.reserve(capacity);
+            values_.reserve(capacity);
+        }
+
+        std::size_t capacity() const noexcept {
+            return values_.capacity();
+        }
+
+        void reserve_indices(std::size_t count) {
+            keys_.reserve_indices(count);
+        }
+
+        bool fits(const K& k) const noexcept {
+            return keys_.has(k)
+                || (values_.size() < values_.capacity() && keys_.fits(k));
+        }
+
+        template < typename Compare >
+        void sort(Compare comp) {
+            std::vector<std::size_t> order(values_.size());
+            for ( std::size_t i = 0; i < order.size(); ++i ) {
+                order[i] = i;
+            }
+            const K* keys = keys_.data();
+            std::sort(order.begin(), order.end(), [&comp, keys](std::size_t l, std::size_t r){
+                return comp(keys[l], keys[r]);
+            });
+            resource_vector<T> new_values(values_.get_allocator());
+            new_values.reserve(values_.size());
+            for ( const std::size_t index : order ) {
+                new_values.push_back(std::move(values_[index]));
+            }
+            keys_.permute(order);
+            values_.swap(new_values);
+        }
+
         bool has(const K& k) const noexcept {
             return keys_.has(k);
         }
@@ -613,6 +983,18 @@ namespace ecs_hpp::detail
                 : nullptr;
         }
 
+        const sparse_set<K, Indexer>& keys() const noexcept {
+            return keys_;
+        }
+
+        T* data() noexcept {
+            return values_.data();
+        }
+
+        const T* data() const noexcept {
+            return values_.data();
+        }
+
         bool empty() const noexcept {
             return values_.empty();
         }
@@ -625,9 +1007,13 @@ namespace ecs_hpp::detail
             return keys_.memory_usage()
                 + values_.capacity() * sizeof(values_[0]);
         }
+
+        std::pmr::memory_resource* resource() const noexcept {
+            return values_.get_allocator().resource();
+        }
     private:
         sparse_set<K, Indexer> keys_;
-        std::vector<T> values_;
+        resource_vector<T> values_;
     };
 
     template < typename K
@@ -658,1976 +1044,8166 @@ namespace ecs_hpp::detail
 
 // -----------------------------------------------------------------------------
 //
-// detail::component_storage
+// detail::object_arena
 //
 // -----------------------------------------------------------------------------
 
 namespace ecs_hpp::detail
 {
-    class component_storage_base {
+    class object_arena final {
     public:
-        virtual ~component_storage_base() = default;
-        virtual bool remove(entity_id id) noexcept = 0;
-        virtual bool has(entity_id id) const noexcept = 0;
-        virtual void clone(entity_id from, entity_id to) = 0;
-        virtual std::size_t memory_usage() const noexcept = 0;
-    };
+        object_arena() = default;
 
-    template < typename T, bool E = std::is_empty_v<T> >
-    class component_storage final : public component_storage_base {
-    public:
-        component_storage(registry& owner)
-        : owner_(owner) {}
+        explicit object_arena(std::pmr::memory_resource* resource)
+        : resource_(resource)
+        , blocks_(resource)
+        , objects_(resource) {}
 
-        template < typename... Args >
-        T& assign(entity_id id, Args&&... args) {
-            std::unique_lock lock(components_locker_);
-            if ( T* value = components_.find(id) ) {
-                *value = T{std::forward<Args>(args)...};
-                return *value;
-            }
-            return *components_.insert(id, T{std::forward<Args>(args)...}).first;
+        ~object_arena() noexcept {
+            clear();
         }
 
-        template < typename... Args >
-        T& ensure(entity_id id, Args&&... args) {
-            if ( T* value = components_.find(id) ) {
-                return *value;
+        object_arena(const object_arena&) = delete;
+        object_arena& operator=(const object_arena&) = delete;
+
+        object_arena(object_arena&& other) noexcept {
+            swap(other);
+        }
+
+        object_arena& operator=(object_arena&& other) noexcept {
+            if ( this != &other ) {
+                object_arena tmp;
+                tmp.swap(other);
+                swap(tmp);
             }
-            std::unique_lock lock(components_locker_);
-            return *components_.insert(id, T{std::forward<Args>(args)...}).first;
+            return *this;
         }
 
-        bool exists(entity_id id) const noexcept {
-            std::shared_lock lock(components_locker_);
-            return components_.has(id);
+        void swap(object_arena& other) noexcept {
+            using std::swap;
+            swap(resource_, other.resource_);
+            swap(blocks_, other.blocks_);
+            swap(objects_, other.objects_);
+            swap(block_offset_, other.block_offset_);
+            swap(block_size_, other.block_size_);
         }
 
-        bool remove(entity_id id) noexcept override {
-            std::unique_lock lock(components_locker_);
-            return components_.unordered_erase(id);
+        template < typename T, typename... Args >
+        T* create(Args&&... args) {
+            static_assert(
+                alignof(T) <= alignof(std::max_align_t),
+                "ecs_hpp::object_arena (over-aligned types are not supported)");
+            objects_.reserve(objects_.size() + 1u);
+            T* object = new (allocate_(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+            objects_.push_back({object, [](void* p) noexcept {
+                static_cast<T*>(p)->~T();
+            }});
+            return object;
         }
 
-        std::size_t remove_all() noexcept {
-            std::unique_lock lock(components_locker_);
-            const std::size_t count = components_.size();
-            components_.clear();
-            return count;
+        void clear() noexcept {
+            for ( auto iter = objects_.rbegin(); iter != objects_.rend(); ++iter ) {
+                iter->destroy(iter->ptr);
+            }
+            objects_.clear();
+            for ( const block& b : blocks_ ) {
+                resource_->deallocate(b.data, b.size, alignof(std::max_align_t));
+            }
+            blocks_.clear();
+            block_offset_ = 0u;
+            block_size_ = 0u;
         }
 
-        T* find(entity_id id) noexcept {
-            std::unique_lock lock(components_locker_);
-            return components_.find(id);
+        bool empty() const noexcept {
+            return objects_.empty();
         }
 
-        const T* find(entity_id id) const noexcept {
-            std::shared_lock lock(components_locker_);
-            return components_.find(id);
+        std::size_t size() const noexcept {
+            return objects_.size();
         }
 
-        std::size_t count() const noexcept {
-            std::shared_lock lock(components_locker_);
-            return components_.size();
+        std::pmr::memory_resource* resource() const noexcept {
+            return resource_;
+        }
+    private:
+        void* allocate_(std::size_t size, std::size_t align) {
+            std::size_t offset = (block_offset_ + align - 1u) / align * align;
+            if ( blocks_.empty() || offset + size > block_size_ ) {
+                const std::size_t new_block_size = std::max(size, default_block_size);
+                const std::size_t new_block_count =
+                    (new_block_size + sizeof(std::max_align_t) - 1u) / sizeof(std::max_align_t);
+                blocks_.reserve(blocks_.size() + 1u);
+                const block b{
+                    static_cast<std::byte*>(resource_->allocate(
+                        new_block_count * sizeof(std::max_align_t),
+                        alignof(std::max_align_t))),
+                    new_block_count * sizeof(std::max_align_t)};
+                blocks_.push_back(b);
+                block_size_ = b.size;
+                offset = 0u;
+            }
+            block_offset_ = offset + size;
+            return blocks_.back().data + offset;
         }
+    private:
+        struct block {
+            std::byte* data{nullptr};
+            std::size_t size{0u};
+        };
+        struct object_info {
+            void* ptr{nullptr};
+            void (*destroy)(void*) noexcept{nullptr};
+        };
+        static constexpr std::size_t default_block_size = 4096u;
+        std::pmr::memory_resource* resource_{std::pmr::get_default_resource()};
+        resource_vector<block> blocks_;
+        resource_vector<object_info> objects_;
+        std::size_t block_offset_{0u};
+        std::size_t block_size_{0u};
+    };
 
-        bool has(entity_id id) const noexcept override {
-            std::shared_lock lock(components_locker_);
-            return components_.has(id);
+    inline void swap(object_arena& l, object_arena& r) noexcept {
+        l.swap(r);
+    }
+}
+
+// -----------------------------------------------------------------------------
+//
+// detail::context_storage
+//
+// -----------------------------------------------------------------------------
+
+namespace ecs_hpp::detail
+{
+    class context_storage final {
+    public:
+        context_storage() = default;
+
+        ~context_storage() noexcept {
+            clear();
         }
 
-        void clone(entity_id from, entity_id to) override {
-            if ( const T* c = find(from) ) {
-                assign(to, *c);
-            }
+        context_storage(const context_storage& other) = delete;
+        context_storage& operator=(const context_storage& other) = delete;
+
+        context_storage(context_storage&& other) noexcept
+        : slots_(std::move(other.slots_)) {
+            other.slots_.clear();
         }
 
-        template < typename F >
-        void for_each_component(F&& f) {
-            std::unique_lock lock(components_locker_);
-            for ( const entity_id id : components_ ) {
-                f(id, components_.get(id));
+        context_storage& operator=(context_storage&& other) noexcept {
+            if ( this != &other ) {
+                clear();
+                slots_ = std::move(other.slots_);
+                other.slots_.clear();
             }
+            return *this;
         }
 
-        template < typename F >
-        void for_each_component(F&& f) const {
-            std::shared_lock lock(components_locker_);
-            for ( const entity_id id : components_ ) {
-                f(id, components_.get(id));
+        template < typename T, typename... Args >
+        T& assign(Args&&... args) {
+            if ( T* value = find<T>() ) {
+                *value = T{std::forward<Args>(args)...};
+                return *value;
             }
+            return emplace_<T>(std::forward<Args>(args)...);
         }
 
-        std::size_t memory_usage() const noexcept override {
-            return components_.memory_usage();
+        template < typename T, typename... Args >
+        T& ensure(Args&&... args) {
+            if ( T* value = find<T>() ) {
+                return *value;
+            }
+            return emplace_<T>(std::forward<Args>(args)...);
         }
-    private:
-        registry& owner_;
-        mutable std::shared_mutex components_locker_;
-        detail::sparse_map<entity_id, T, entity_id_indexer> components_;
-    };
 
-    template < typename T >
-    class component_storage<T, true> final : public component_storage_base {
-    public:
-        component_storage(registry& owner)
-        : owner_(owner) {}
+        template < typename T >
+        bool remove() noexcept {
+            const auto family = type_family<T>::id();
+            if ( family >= slots_.size() || !slots_[family].value ) {
+                return false;
+            }
+            slot& s = slots_[family];
+            s.destroy(s.value);
+            s = slot{};
+            return true;
+        }
 
-        template < typename... Args >
-        T& assign(entity_id id, Args&&...) {
-            if ( components_.has(id) ) {
-                return empty_value_;
+        template < typename T >
+        T* find() noexcept {
+            const auto family = type_family<T>::id();
+            return family < slots_.size()
+                ? static_cast<T*>(slots_[family].value)
+                : nullptr;
+        }
+
+        template < typename T >
+        const T* find() const noexcept {
+            const auto family = type_family<T>::id();
+            return family < slots_.size()
+                ? static_cast<const T*>(slots_[family].value)
+                : nullptr;
+        }
+
+        void clear() noexcept {
+            for ( auto iter = slots_.rbegin(); iter != slots_.rend(); ++iter ) {
+                if ( iter->value ) {
+                    iter->destroy(iter->value);
+                    *iter = slot{};
+                }
             }
-            std::unique_lock lock(components_locker_);
-            components_.insert(id);
-            return empty_value_;
         }
+    private:
+        struct slot {
+            void* value{nullptr};
+            void (*destroy)(void*) noexcept{nullptr};
+        };
 
-        template < typename... Args >
-        T& ensure(entity_id id, Args&&...) {
-            if ( components_.has(id) ) {
-                return empty_value_;
+        template < typename T, typename... Args >
+        T& emplace_(Args&&... args) {
+            const auto family = type_family<T>::id();
+            if ( family >= slots_.size() ) {
+                slots_.resize(family + 1u);
             }
-            std::unique_lock lock(components_locker_);
-            components_.insert(id);
-            return empty_value_;
+            T* value = new T{std::forward<Args>(args)...};
+            slots_[family] = slot{value, [](void* v) noexcept {
+                delete static_cast<T*>(v);
+            }};
+            return *value;
         }
+    private:
+        std::vector<slot> slots_;
+    };
+}
 
-        bool exists(entity_id id) const noexcept {
-            std::shared_lock lock(components_locker_);
-            return components_.has(id);
+// -----------------------------------------------------------------------------
+//
+// detail::entity_signatures
+//
+// -----------------------------------------------------------------------------
+
+namespace ecs_hpp::detail
+{
+    // one bit per storage slot for the first slot_count storages,
+    // the other storages have no bit and are always probed
+    class entity_signatures final {
+    public:
+        static constexpr std::size_t slot_count = 64u;
+
+        static std::uint64_t slot_bit(std::size_t slot) noexcept {
+            return slot < slot_count
+                ? std::uint64_t{1u} << slot
+                : 0u;
         }
+    public:
+        entity_signatures() = default;
 
-        bool remove(entity_id id) noexcept override {
-            std::unique_lock lock(components_locker_);
-            return components_.unordered_erase(id);
+        explicit entity_signatures(std::pmr::memory_resource* resource)
+        : resource_(resource) {}
+
+        ~entity_signatures() noexcept {
+            clear();
         }
 
-        std::size_t remove_all() noexcept {
-            std::unique_lock lock(components_locker_);
-            const std::size_t count = components_.size();
-            components_.clear();
-            return count;
+        entity_signatures(const entity_signatures& other) = delete;
+        entity_signatures& operator=(const entity_signatures& other) = delete;
+
+        entity_signatures(entity_signatures&& other) noexcept
+        : resource_(other.resource_)
+        , table_(other.table_.exchange(nullptr))
+        , page_count_(other.page_count_.exchange(0u)) {}
+
+        entity_signatures& operator=(entity_signatures&& other) noexcept {
+            if ( this != &other ) {
+                clear();
+                resource_ = other.resource_;
+                table_ = other.table_.exchange(nullptr);
+                page_count_ = other.page_count_.exchange(0u);
+            }
+            return *this;
         }
 
-        T* find(entity_id id) noexcept {
-            std::unique_lock lock(components_locker_);
-            return components_.has(id)
-                ? &empty_value_
-                : nullptr;
+        // must be called before the first set for this id
+        void reserve(entity_id id) {
+            const std::size_t index = entity_id_index(id);
+            page_table* table = table_.load(std::memory_order_acquire);
+            if ( table && table->pages[index / page_size].load(std::memory_order_acquire) ) {
+                return;
+            }
+            std::lock_guard<std::mutex> guard(growth_locker_);
+            table = table_.load(std::memory_order_relaxed);
+            if ( !table ) {
+                table = new (resource_->allocate(sizeof(page_table), alignof(page_table))) page_table();
+                table_.store(table, std::memory_order_release);
+            }
+            auto& page = table->pages[index / page_size];
+            if ( !page.load(std::memory_order_relaxed) ) {
+                auto words = static_cast<std::atomic<std::uint64_t>*>(resource_->allocate(
+                    page_size * sizeof(std::atomic<std::uint64_t>),
+                    alignof(std::atomic<std::uint64_t>)));
+                for ( std::size_t i = 0; i < page_size; ++i ) {
+                    new (&words[i]) std::atomic<std::uint64_t>(0u);
+                }
+                page.store(words, std::memory_order_release);
+                page_count_.fetch_add(1u, std::memory_order_relaxed);
+            }
         }
 
-        const T* find(entity_id id) const noexcept {
-            std::shared_lock lock(components_locker_);
-            return components_.has(id)
-                ? &empty_value_
-                : nullptr;
+        void reserve_indices(std::size_t count) {
+            for ( std::size_t index = 0; index < count; index += page_size ) {
+                reserve(static_cast<entity_id>(index));
+            }
         }
 
-        std::size_t count() const noexcept {
-            std::shared_lock lock(components_locker_);
-            return components_.size();
+        bool reserved(entity_id id) const noexcept {
+            return find_(id) != nullptr;
         }
 
-        bool has(entity_id id) const noexcept override {
-            std::shared_lock lock(components_locker_);
-            return components_.has(id);
+        void set(entity_id id, std::uint64_t bits) noexcept {
+            if ( std::atomic<std::uint64_t>* word = find_(id) ) {
+                word->fetch_or(bits, std::memory_order_relaxed);
+            }
         }
 
-        void clone(entity_id from, entity_id to) override {
-            if ( const T* c = find(from) ) {
-                assign(to, *c);
+        void reset(entity_id id, std::uint64_t bits) noexcept {
+            if ( std::atomic<std::uint64_t>* word = find_(id) ) {
+                word->fetch_and(~bits, std::memory_order_relaxed);
             }
         }
 
-        template < typename F >
-        void for_each_component(F&& f) {
-            std::unique_lock lock(components_locker_);
-            for ( const entity_id id : components_ ) {
-                f(id, empty_value_);
+        void clear(entity_id id) noexcept {
+            if ( std::atomic<std::uint64_t>* word = find_(id) ) {
+                word->store(0u, std::memory_order_relaxed);
             }
         }
 
-        template < typename F >
-        void for_each_component(F&& f) const {
-            std::shared_lock lock(components_locker_);
-            for ( const entity_id id : components_ ) {
-                f(id, empty_value_);
+        std::uint64_t get(entity_id id) const noexcept {
+            const std::atomic<std::uint64_t>* word = find_(id);
+            return word
+                ? word->load(std::memory_order_relaxed)
+                : 0u;
+        }
+
+        void clear() noexcept {
+            if ( page_table* table = table_.exchange(nullptr) ) {
+                for ( auto& page : table->pages ) {
+                    if ( auto words = page.load(std::memory_order_relaxed) ) {
+                        resource_->deallocate(
+                            words,
+                            page_size * sizeof(std::atomic<std::uint64_t>),
+                            alignof(std::atomic<std::uint64_t>));
+                    }
+                }
+                resource_->deallocate(table, sizeof(page_table), alignof(page_table));
             }
+            page_count_ = 0u;
         }
 
-        std::size_t memory_usage() const noexcept override {
-            std::shared_lock lock(components_locker_);
-            return components_.memory_usage();
+        std::size_t memory_usage() const noexcept {
+            return table_.load(std::memory_order_relaxed)
+                ? sizeof(page_table) + page_count_ * page_size * sizeof(std::uint64_t)
+                : 0u;
         }
     private:
-        registry& owner_;
-        static T empty_value_;
-        mutable std::shared_mutex components_locker_;
-        detail::sparse_set<entity_id, entity_id_indexer> components_;
-    };
+        static constexpr std::size_t page_size = 1024u;
+        static constexpr std::size_t page_count = (entity_id_index_mask + page_size) / page_size;
 
-    template < typename T >
-    T component_storage<T, true>::empty_value_;
+        struct page_table {
+            std::atomic<std::atomic<std::uint64_t>*> pages[page_count];
+        };
+
+        std::atomic<std::uint64_t>* find_(entity_id id) const noexcept {
+            const std::size_t index = entity_id_index(id);
+            const page_table* table = table_.load(std::memory_order_acquire);
+            std::atomic<std::uint64_t>* page = table
+                ? table->pages[index / page_size].load(std::memory_order_acquire)
+                : nullptr;
+            return page
+                ? &page[index % page_size]
+                : nullptr;
+        }
+    private:
+        std::pmr::memory_resource* resource_{std::pmr::get_default_resource()};
+        std::atomic<page_table*> table_{nullptr};
+        std::atomic<std::size_t> page_count_{0u};
+        std::mutex growth_locker_;
+    };
 }
 
 // -----------------------------------------------------------------------------
 //
-// entity
+// detail::seqlock_table
 //
 // -----------------------------------------------------------------------------
 
-namespace ecs_hpp
+namespace ecs_hpp::detail
 {
-    class entity final {
+    // a paged mirror of trivially copyable values, every slot is a sequence word,
+    // the owner id and the value words, pages are never moved or freed while alive
+    // so readers only load atomics and retry while a write is in progress
+    class seqlock_table final {
     public:
-        explicit entity(registry& owner) noexcept;
-        entity(registry& owner, entity_id id) noexcept;
-
-        entity(const entity&) = default;
-        entity& operator=(const entity&) = default;
-
-        entity(entity&&) noexcept = default;
-        entity& operator=(entity&&) noexcept = default;
-
-        registry& owner() noexcept;
-        const registry& owner() const noexcept;
-
-        entity_id id() const noexcept;
+        seqlock_table() = default;
 
-        entity clone() const;
-        void destroy() noexcept;
-        bool valid() const noexcept;
+        explicit seqlock_table(std::pmr::memory_resource* resource)
+        : resource_(resource) {}
 
-        template < typename T, typename... Args >
-        T& assign_component(Args&&... args);
+        ~seqlock_table() noexcept {
+            clear();
+        }
 
-        template < typename T, typename... Args >
-        T& ensure_component(Args&&... args);
+        seqlock_table(const seqlock_table& other) = delete;
+        seqlock_table& operator=(const seqlock_table& other) = delete;
 
-        template < typename T >
-        bool remove_component() noexcept;
+        bool enabled() const noexcept {
+            return enabled_;
+        }
 
-        template < typename T >
-        bool exists_component() const noexcept;
+        // the value size must be set before the first reserve
+        void value_size(std::size_t size) noexcept {
+            assert(!table_.load(std::memory_order_relaxed) || size == value_size_);
+            value_size_ = size;
+            slot_words_ = 2u + (size + sizeof(std::uint64_t) - 1u) / sizeof(std::uint64_t);
+        }
 
-        std::size_t remove_all_components() noexcept;
+        void enable() noexcept {
+            enabled_ = true;
+        }
 
-        template < typename T >
-        T& get_component();
+        // writers must be serialized and call reserve before the first store,
+        // stores of different ids may run concurrently
+        void reserve(entity_id id) {
+            const std::size_t index = entity_id_index(id);
+            page_table* table = table_.load(std::memory_order_relaxed);
+            if ( !table ) {
+                table = new (resource_->allocate(sizeof(page_table), alignof(page_table))) page_table();
+                table_.store(table, std::memory_order_release);
+            }
+            auto& page = table->pages[index / page_size];
+            if ( !page.load(std::memory_order_relaxed) ) {
+                const std::size_t words = page_size * slot_words_;
+                auto slots = static_cast<std::atomic<std::uint64_t>*>(resource_->allocate(
+                    words * sizeof(std::atomic<std::uint64_t>),
+                    alignof(std::atomic<std::uint64_t>)));
+                for ( std::size_t i = 0; i < words; ++i ) {
+                    new (&slots[i]) std::atomic<std::uint64_t>(0u);
+                }
+                page.store(slots, std::memory_order_release);
+                page_count_.fetch_add(1u, std::memory_order_relaxed);
+            }
+        }
 
-        template < typename T >
-        const T& get_component() const;
+        bool reserved(entity_id id) const noexcept {
+            return find_(id) != nullptr;
+        }
 
-        template < typename T >
-        T* find_component() noexcept;
+        void store(entity_id id, const void* src) noexcept {
+            write_(id, id + std::uint64_t{1u}, src);
+        }
 
-        template < typename T >
-        const T* find_component() const noexcept;
+        void erase(entity_id id) noexcept {
+            write_(id, 0u, nullptr);
+        }
 
-        template < typename... Ts >
-        std::tuple<Ts&...> get_components();
-        template < typename... Ts >
-        std::tuple<const Ts&...> get_components() const;
+        bool load(entity_id id, void* dst) const noexcept {
+            const std::atomic<std::uint64_t>* slot = find_(id);
+            if ( !slot ) {
+                return false;
+            }
+            std::byte* bytes = static_cast<std::byte*>(dst);
+            for ( ;; ) {
+                const std::uint64_t seq = slot[0].load(std::memory_order_acquire);
+                if ( seq & 1u ) {
+                    continue;
+                }
+                const std::uint64_t owner = slot[1].load(std::memory_order_relaxed);
+                for ( std::size_t offset = 0; offset < value_size_; offset += sizeof(std::uint64_t) ) {
+                    const std::uint64_t word = slot[2u + offset / sizeof(std::uint64_t)].load(std::memory_order_relaxed);
+                    std::memcpy(bytes + offset, &word, std::min(sizeof(word), value_size_ - offset));
+                }
+                std::atomic_thread_fence(std::memory_order_acquire);
+                if ( slot[0].load(std::memory_order_relaxed) == seq ) {
+                    return owner == id + std::uint64_t{1u};
+                }
+            }
+        }
 
-        template < typename... Ts >
-        std::tuple<Ts*...> find_components() noexcept;
-        template < typename... Ts >
-        std::tuple<const Ts*...> find_components() const noexcept;
+        void clear() noexcept {
+            if ( page_table* table = table_.exchange(nullptr) ) {
+                for ( auto& page : table->pages ) {
+                    if ( auto slots = page.load(std::memory_order_relaxed) ) {
+                        resource_->deallocate(
+                            slots,
+                            page_size * slot_words_ * sizeof(std::atomic<std::uint64_t>),
+                            alignof(std::atomic<std::uint64_t>));
+                    }
+                }
+                resource_->deallocate(table, sizeof(page_table), alignof(page_table));
+            }
+            page_count_ = 0u;
+            enabled_ = false;
+        }
 
-        std::size_t component_count() const noexcept;
+        std::size_t memory_usage() const noexcept {
+            return table_.load(std::memory_order_relaxed)
+                ? sizeof(page_table) + page_count_ * page_size * slot_words_ * sizeof(std::uint64_t)
+                : 0u;
+        }
     private:
-        registry* owner_{nullptr};
-        entity_id id_{0u};
-    };
+        static constexpr std::size_t page_size = 1024u;
+        static constexpr std::size_t page_count = (entity_id_index_mask + page_size) / page_size;
 
-    bool operator<(const entity& l, const entity& r) noexcept;
-
-    bool operator==(const entity& l, const entity& r) noexcept;
-    bool operator==(const entity& l, const const_entity& r) noexcept;
+        struct page_table {
+            std::atomic<std::atomic<std::uint64_t>*> pages[page_count];
+        };
 
-    bool operator!=(const entity& l, const entity& r) noexcept;
-    bool operator!=(const entity& l, const const_entity& r) noexcept;
-}
+        std::atomic<std::uint64_t>* find_(entity_id id) const noexcept {
+            const std::size_t index = entity_id_index(id);
+            const page_table* table = table_.load(std::memory_order_acquire);
+            std::atomic<std::uint64_t>* page = table
+                ? table->pages[index / page_size].load(std::memory_order_acquire)
+                : nullptr;
+            return page
+                ? &page[(index % page_size) * slot_words_]
+                : nullptr;
+        }
 
-namespace std
-{
-    template <>
-    struct hash<ecs_hpp::entity> final {
-        std::size_t operator()(const ecs_hpp::entity& ent) const noexcept {
-            return ecs_hpp::detail::hash_combine(
-                std::hash<const ecs_hpp::registry*>()(&ent.owner()),
-                std::hash<ecs_hpp::entity_id>()(ent.id()));
+        void write_(entity_id id, std::uint64_t owner, const void* src) noexcept {
+            std::atomic<std::uint64_t>* slot = find_(id);
+            if ( !slot ) {
+                return;
+            }
+            const std::uint64_t seq = slot[0].load(std::memory_order_relaxed);
+            slot[0].store(seq + 1u, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_release);
+            slot[1].store(owner, std::memory_order_relaxed);
+            if ( src ) {
+                const std::byte* bytes = static_cast<const std::byte*>(src);
+                for ( std::size_t offset = 0; offset < value_size_; offset += sizeof(std::uint64_t) ) {
+                    std::uint64_t word{0u};
+                    std::memcpy(&word, bytes + offset, std::min(sizeof(word), value_size_ - offset));
+                    slot[2u + offset / sizeof(std::uint64_t)].store(word, std::memory_order_relaxed);
+                }
+            }
+            slot[0].store(seq + 2u, std::memory_order_release);
         }
+    private:
+        std::pmr::memory_resource* resource_{std::pmr::get_default_resource()};
+        std::atomic<page_table*> table_{nullptr};
+        std::atomic<std::size_t> page_count_{0u};
+        std::size_t value_size_{0u};
+        std::size_t slot_words_{2u};
+        bool enabled_{false};
     };
 }
 
 // -----------------------------------------------------------------------------
 //
-// const_entity
+// detail::component_storage
 //
 // -----------------------------------------------------------------------------
 
-namespace ecs_hpp
+namespace ecs_hpp::detail
 {
-    class const_entity final {
+    class component_storage_base {
     public:
-        const_entity(const entity& ent) noexcept;
-
-        explicit const_entity(const registry& owner) noexcept;
-        const_entity(const registry& owner, entity_id id) noexcept;
+        struct raw_view {
+            const entity_id* ids{nullptr};
+            std::byte* components{nullptr};
+            std::size_t stride{0u};
+            std::size_t size{0u};
+        };
+    public:
+        component_storage_base() = default;
 
-        const_entity(const const_entity&) = default;
-        const_entity& operator=(const const_entity&) = default;
+        explicit component_storage_base(std::pmr::memory_resource* resource)
+        : disabled_bits_(resource)
+        , seqlock_(resource) {}
 
-        const_entity(const_entity&&) noexcept = default;
-        const_entity& operator=(const_entity&&) noexcept = default;
+        virtual ~component_storage_base() = default;
+        virtual void* assign_raw(entity_id id, const void* src) = 0;
+        virtual bool remove(entity_id id) noexcept = 0;
+        virtual bool has(entity_id id) const noexcept = 0;
+        virtual void* find_raw(entity_id id) noexcept = 0;
+        virtual const void* find_raw(entity_id id) const noexcept = 0;
+        virtual std::size_t count() const noexcept = 0;
+        virtual void clone(entity_id from, entity_id to) = 0;
+        virtual void capture(entity_id id, compiled_prototype& compiled) const = 0;
+        virtual std::size_t memory_usage() const noexcept = 0;
 
-        const registry& owner() const noexcept;
-        entity_id id() const noexcept;
+        // the caller must hold the storage locker
+        virtual raw_view dense_view() noexcept = 0;
 
-        bool valid() const noexcept;
+        raw_view dense_view() const noexcept {
+            return const_cast<component_storage_base*>(this)->dense_view();
+        }
 
-        template < typename T >
-        bool exists_component() const noexcept;
+        std::shared_mutex& locker() const noexcept {
+            return components_locker_;
+        }
 
-        template < typename T >
-        const T& get_component() const;
+        std::uint64_t signature_bit() const noexcept {
+            return signature_bit_;
+        }
 
-        template < typename T >
-        const T* find_component() const noexcept;
+        void signature_bit(std::uint64_t bit) noexcept {
+            signature_bit_ = bit;
+        }
 
-        template < typename... Ts >
-        std::tuple<const Ts&...> get_components() const;
+        // disabled components stay in place but are skipped
+        // by iteration and joins, the bits follow dense indices
 
-        template < typename... Ts >
-        std::tuple<const Ts*...> find_components() const noexcept;
+        bool set_enabled(entity_id id, bool yesno) {
+            std::unique_lock lock(components_locker_);
+            const auto p = dense_index_(id);
+            if ( !p.second ) {
+                return false;
+            }
+            const std::size_t word = p.first / 64u;
+            const std::uint64_t bit = std::uint64_t(1u) << (p.first % 64u);
+            if ( yesno ) {
+                if ( word < disabled_bits_.size() && (disabled_bits_[word] & bit) ) {
+                    disabled_bits_[word] &= ~bit;
+                    --disabled_count_;
+                }
+            } else {
+                // disabled bits cover all dense slots while any is disabled
+                const std::size_t words = (dense_view().size + 63u) / 64u;
+                if ( disabled_bits_.size() < words ) {
+                    disabled_bits_.resize(words, 0u);
+                }
+                if ( !(disabled_bits_[word] & bit) ) {
+                    disabled_bits_[word] |= bit;
+                    ++disabled_count_;
+                }
+            }
+            return true;
+        }
 
-        std::size_t component_count() const noexcept;
-    private:
-        const registry* owner_{nullptr};
-        entity_id id_{0u};
-    };
+        // dense slots are partitioned into an active prefix and a dormant
+        // suffix, iteration and joins cover the active prefix only
 
-    bool operator<(const const_entity& l, const const_entity& r) noexcept;
+        bool set_active(entity_id id, bool yesno) noexcept {
+            std::unique_lock lock(components_locker_);
+            const auto p = dense_index_(id);
+            if ( !p.second ) {
+                return false;
+            }
+            if ( yesno && p.first >= active_count_ ) {
+                swap_dense_(p.first, active_count_++);
+            } else if ( !yesno && p.first < active_count_ ) {
+                swap_dense_(p.first, --active_count_);
+            }
+            return true;
+        }
 
-    bool operator==(const const_entity& l, const entity& r) noexcept;
-    bool operator==(const const_entity& l, const const_entity& r) noexcept;
+        bool has_enabled(entity_id id) const noexcept {
+            std::shared_lock lock(components_locker_);
+            const auto p = dense_index_(id);
+            return p.second && enabled_at(p.first);
+        }
 
-    bool operator!=(const const_entity& l, const entity& r) noexcept;
-    bool operator!=(const const_entity& l, const const_entity& r) noexcept;
-}
+        std::size_t disabled_count() const noexcept {
+            std::shared_lock lock(components_locker_);
+            return disabled_count_;
+        }
 
-namespace std
-{
-    template <>
-    struct hash<ecs_hpp::const_entity> final {
-        std::size_t operator()(const ecs_hpp::const_entity& ent) const noexcept {
-            return ecs_hpp::detail::hash_combine(
-                std::hash<const ecs_hpp::registry*>()(&ent.owner()),
-                std::hash<ecs_hpp::entity_id>()(ent.id()));
+        std::size_t active_count() const noexcept {
+            std::shared_lock lock(components_locker_);
+            return active_count_;
         }
-    };
-}
 
-// -----------------------------------------------------------------------------
-//
-// component
-//
-// -----------------------------------------------------------------------------
+        // the caller must hold the storage locker
+        bool dormant_at(std::size_t index) const noexcept {
+            return index >= active_count_;
+        }
 
-namespace ecs_hpp
-{
-    template < typename T >
-    class component final {
-    public:
-        explicit component(const entity& owner) noexcept;
+        // the caller must hold the storage locker,
+        // unlike enabled_at it ignores the active/dormant partition
+        bool disabled_at(std::size_t index) const noexcept {
+            return disabled_count_ && !enabled_bit_(index);
+        }
 
-        component(const component&) = default;
-        component& operator=(const component&) = default;
+        // the caller must hold the storage locker
+        bool enabled_at(std::size_t index) const noexcept {
+            if ( index >= active_count_ ) {
+                return false;
+            }
+            const std::size_t word = index / 64u;
+            return !disabled_count_
+                || word >= disabled_bits_.size()
+                || !(disabled_bits_[word] & (std::uint64_t(1u) << (index % 64u)));
+        }
 
-        component(component&&) noexcept = default;
-        component& operator=(component&&) noexcept = default;
+        // the caller must hold the storage locker
+        template < typename F >
+        void for_each_enabled_index(F&& f) const {
+            for_each_enabled_index(0u, active_count_, std::forward<F>(f));
+        }
 
-        entity& owner() noexcept;
-        const entity& owner() const noexcept;
+        // the caller must hold the storage locker
+        template < typename F >
+        void for_each_enabled_index(std::size_t first, std::size_t last, F&& f) const {
+            last = std::min(last, active_count_);
+            if ( first >= last ) {
+                return;
+            }
+            if ( !disabled_count_ ) {
+                for ( std::size_t i = first; i < last; ++i ) {
+                    f(i);
+                }
+                return;
+            }
+            for ( std::size_t word = first / 64u; word * 64u < last; ++word ) {
+                std::uint64_t enabled = word < disabled_bits_.size()
+                    ? ~disabled_bits_[word]
+                    : ~std::uint64_t(0u);
+                if ( word == first / 64u ) {
+                    enabled &= ~std::uint64_t(0u) << (first % 64u);
+                }
+                if ( const std::size_t tail = last - word * 64u; tail < 64u ) {
+                    enabled &= (std::uint64_t(1u) << tail) - 1u;
+                }
+                while ( enabled ) {
+                    f(word * 64u + count_trailing_zeros(enabled));
+                    enabled &= enabled - 1u;
+                }
+            }
+        }
 
-        bool valid() const noexcept;
-        bool exists() const noexcept;
+        // sorts both partitions by entity id in place, without allocating
+        void sort_by_id() noexcept {
+            std::unique_lock lock(components_locker_);
+            const raw_view view = dense_view();
+            heap_sort_by_id_(view.ids, 0u, active_count_);
+            heap_sort_by_id_(view.ids, active_count_, view.size);
+        }
 
-        template < typename... Args >
-        T& assign(Args&&... args);
+        // seqlocked storages mirror their values into a lock-free table,
+        // readers touch neither the storage locker nor the dense arrays
 
-        template < typename... Args >
-        T& ensure(Args&&... args);
+        void enable_seqlock(std::size_t value_size) {
+            std::unique_lock lock(components_locker_);
+            if ( seqlock_.enabled() ) {
+                return;
+            }
+            const raw_view view = dense_view();
+            seqlock_.value_size(value_size);
+            for ( std::size_t i = 0; i < view.size; ++i ) {
+                seqlock_.reserve(view.ids[i]);
+            }
+            seqlock_.enable();
+            publish_seqlocked_(view);
+        }
 
-        bool remove() noexcept;
+        bool seqlocked() const noexcept {
+            std::shared_lock lock(components_locker_);
+            return seqlock_.enabled();
+        }
 
-        T& get();
-        const T& get() const;
+        bool read_seqlocked(entity_id id, void* dst) const noexcept {
+            return seqlock_.load(id, dst);
+        }
 
-        T* find() noexcept;
-        const T* find() const noexcept;
+        // makes writes through component references visible to readers
+        void publish_seqlocked() noexcept {
+            std::unique_lock lock(components_locker_);
+            if ( seqlock_.enabled() ) {
+                publish_seqlocked_(dense_view());
+            }
+        }
 
-        T& operator*();
-        const T& operator*() const;
+        // the caller must hold the storage locker, at least shared,
+        // and be the only writer of this slot
+        void publish_seqlocked_at(const raw_view& view, std::size_t index) noexcept {
+            if ( seqlock_.enabled() ) {
+                seqlock_.store(view.ids[index], view.components + index * view.stride);
+            }
+        }
+    protected:
+        // the caller must hold the storage locker
+        virtual std::pair<std::size_t,bool> dense_index_(entity_id id) const noexcept = 0;
+        virtual void swap_slots_(std::size_t l, std::size_t r) noexcept = 0;
+
+        void reserve_slots_(std::size_t size) {
+            if ( const std::size_t words = (size + 63u) / 64u; disabled_count_ && disabled_bits_.size() < words ) {
+                disabled_bits_.resize(next_capacity_size(
+                    disabled_bits_.size(), words, disabled_bits_.max_size()), 0u);
+            }
+        }
 
-        T* operator->() noexcept;
-        const T* operator->() const noexcept;
+        bool slots_fit_(std::size_t size) const noexcept {
+            return !disabled_count_ || (size + 63u) / 64u <= disabled_bits_.size();
+        }
 
-        explicit operator bool() const noexcept;
-    private:
-        entity owner_;
-    };
+        // a new slot is appended at the back, moves it into the active prefix
+        std::size_t insert_slot_(std::size_t index) noexcept {
+            if ( index != active_count_ ) {
+                swap_dense_(index, active_count_);
+            }
+            return active_count_++;
+        }
 
-    template < typename T >
-    bool operator<(const component<T>& l, const component<T>& r) noexcept;
+        // swap-and-pop erasing moves the last slot into the hole,
+        // returns the index the erased slot was moved to before that
+        std::size_t erase_slot_(std::size_t index, std::size_t last) noexcept {
+            if ( index < active_count_ ) {
+                swap_dense_(index, --active_count_);
+                index = active_count_;
+            }
+            if ( !disabled_count_ ) {
+                return index;
+            }
+            if ( !enabled_bit_(index) ) {
+                --disabled_count_;
+            }
+            const bool last_enabled = enabled_bit_(last);
+            reset_enabled_bit_(last);
+            if ( index != last && !last_enabled ) {
+                disabled_bits_[index / 64u] |= std::uint64_t(1u) << (index % 64u);
+            } else {
+                reset_enabled_bit_(index);
+            }
+            return index;
+        }
 
-    template < typename T >
-    bool operator==(const component<T>& l, const component<T>& r) noexcept;
-    template < typename T >
-    bool operator==(const component<T>& l, const const_component<T>& r) noexcept;
+        void reset_slots_() noexcept {
+            std::fill(disabled_bits_.begin(), disabled_bits_.end(), 0u);
+            disabled_count_ = 0u;
+            active_count_ = 0u;
+        }
 
-    template < typename T >
-    bool operator!=(const component<T>& l, const component<T>& r) noexcept;
-    template < typename T >
-    bool operator!=(const component<T>& l, const const_component<T>& r) noexcept;
-}
+        // the caller must hold the storage locker
+        bool seqlock_enabled_() const noexcept {
+            return seqlock_.enabled();
+        }
 
-namespace std
-{
-    template < typename T >
-    struct hash<ecs_hpp::component<T>> {
-        std::size_t operator()(const ecs_hpp::component<T>& comp) const noexcept {
-            return std::hash<ecs_hpp::entity>()(comp.owner());
+        void reserve_seqlocked_(entity_id id) {
+            if ( seqlock_.enabled() ) {
+                seqlock_.reserve(id);
+            }
         }
-    };
-}
 
-// -----------------------------------------------------------------------------
-//
-// const_component
-//
-// -----------------------------------------------------------------------------
+        bool seqlocked_fits_(entity_id id) const noexcept {
+            return !seqlock_.enabled() || seqlock_.reserved(id);
+        }
 
-namespace ecs_hpp
-{
-    template < typename T >
-    class const_component final {
-    public:
-        const_component(const component<T>& comp) noexcept;
-        explicit const_component(const const_entity& owner) noexcept;
+        void publish_seqlocked_(entity_id id, const void* src) noexcept {
+            if ( seqlock_.enabled() ) {
+                seqlock_.store(id, src);
+            }
+        }
 
-        const_component(const const_component&) = default;
-        const_component& operator=(const const_component&) = default;
+        void unpublish_seqlocked_(entity_id id) noexcept {
+            if ( seqlock_.enabled() ) {
+                seqlock_.erase(id);
+            }
+        }
 
-        const_component(const_component&&) noexcept = default;
-        const_component& operator=(const_component&&) noexcept = default;
+        std::size_t seqlock_memory_usage_() const noexcept {
+            return seqlock_.memory_usage();
+        }
 
-        const const_entity& owner() const noexcept;
+        // dense indices change, so disabled ids are collected and restored,
+        // dormant ids are kept in the suffix by the wrapped comparator
+        template < typename Compare, typename Sort >
+        void reorder_(Compare comp, Sort&& sort) {
+            const raw_view view = dense_view();
+            if ( !disabled_count_ && active_count_ == view.size ) {
+                sort(comp);
+                return;
+            }
+            std::vector<entity_id> disabled_ids;
+            disabled_ids.reserve(disabled_count_);
+            for ( std::size_t i = 0; i < view.size; ++i ) {
+                if ( !enabled_bit_(i) ) {
+                    disabled_ids.push_back(view.ids[i]);
+                }
+            }
+            std::vector<entity_id> dormant_ids(view.ids + active_count_, view.ids + view.size);
+            std::sort(dormant_ids.begin(), dormant_ids.end());
+            const std::size_t active_count = active_count_;
+            reset_slots_();
+            sort([&comp, &dormant_ids](entity_id l, entity_id r){
+                const bool ld = std::binary_search(dormant_ids.begin(), dormant_ids.end(), l);
+                const bool rd = std::binary_search(dormant_ids.begin(), dormant_ids.end(), r);
+                return ld != rd ? rd : comp(l, r);
+            });
+            active_count_ = active_count;
+            for ( const entity_id id : disabled_ids ) {
+                const std::size_t index = dense_index_(id).first;
+                disabled_bits_[index / 64u] |= std::uint64_t(1u) << (index % 64u);
+            }
+            disabled_count_ = disabled_ids.size();
+        }
+    protected:
+        mutable std::shared_mutex components_locker_;
+    private:
+        bool enabled_bit_(std::size_t index) const noexcept {
+            const std::size_t word = index / 64u;
+            return word >= disabled_bits_.size()
+                || !(disabled_bits_[word] & (std::uint64_t(1u) << (index % 64u)));
+        }
 
-        bool valid() const noexcept;
-        bool exists() const noexcept;
+        void reset_enabled_bit_(std::size_t index) noexcept {
+            if ( const std::size_t word = index / 64u; word < disabled_bits_.size() ) {
+                disabled_bits_[word] &= ~(std::uint64_t(1u) << (index % 64u));
+            }
+        }
 
-        const T& get() const;
-        const T* find() const noexcept;
+        void heap_sort_by_id_(const entity_id* ids, std::size_t first, std::size_t last) noexcept {
+            if ( std::is_sorted(ids + first, ids + last) ) {
+                return;
+            }
+            const auto sift_down = [this, ids, first](std::size_t root, std::size_t size){
+                for ( std::size_t child; (child = root * 2u + 1u) < size; root = child ) {
+                    if ( child + 1u < size && ids[first + child] < ids[first + child + 1u] ) {
+                        ++child;
+                    }
+                    if ( !(ids[first + root] < ids[first + child]) ) {
+                        return;
+                    }
+                    swap_dense_(first + root, first + child);
+                }
+            };
+            const std::size_t size = last - first;
+            for ( std::size_t i = size / 2u; i > 0u; --i ) {
+                sift_down(i - 1u, size);
+            }
+            for ( std::size_t i = size; i > 1u; --i ) {
+                swap_dense_(first, first + i - 1u);
+                sift_down(0u, i - 1u);
+            }
+        }
 
-        const T& operator*() const;
-        const T* operator->() const noexcept;
-        explicit operator bool() const noexcept;
+        void swap_dense_(std::size_t l, std::size_t r) noexcept {
+            if ( l == r ) {
+                return;
+            }
+            swap_slots_(l, r);
+            if ( disabled_count_ ) {
+                const bool l_enabled = enabled_bit_(l);
+                const bool r_enabled = enabled_bit_(r);
+                if ( l_enabled != r_enabled ) {
+                    disabled_bits_[l / 64u] ^= std::uint64_t(1u) << (l % 64u);
+                    disabled_bits_[r / 64u] ^= std::uint64_t(1u) << (r % 64u);
+                }
+            }
+        }
+
+        void publish_seqlocked_(const raw_view& view) noexcept {
+            for ( std::size_t i = 0; i < view.size; ++i ) {
+                seqlock_.store(view.ids[i], view.components + i * view.stride);
+            }
+        }
     private:
-        const_entity owner_;
+        std::uint64_t signature_bit_{0u};
+        resource_vector<std::uint64_t> disabled_bits_;
+        std::size_t disabled_count_{0u};
+        std::size_t active_count_{0u};
+        seqlock_table seqlock_;
     };
 
-    template < typename T >
-    bool operator<(const const_component<T>& l, const const_component<T>& r) noexcept;
+    template < typename T, bool E = std::is_empty_v<T> >
+    class component_storage final : public component_storage_base {
+    public:
+        component_storage() = default;
 
-    template < typename T >
-    bool operator==(const const_component<T>& l, const component<T>& r) noexcept;
-    template < typename T >
-    bool operator==(const const_component<T>& l, const const_component<T>& r) noexcept;
+        explicit component_storage(std::pmr::memory_resource* resource)
+        : component_storage_base(resource)
+        , components_(resource) {}
 
-    template < typename T >
-    bool operator!=(const const_component<T>& l, const component<T>& r) noexcept;
-    template < typename T >
-    bool operator!=(const const_component<T>& l, const const_component<T>& r) noexcept;
-}
+        template < typename... Args >
+        T& assign(entity_id id, Args&&... args) {
+            std::unique_lock lock(components_locker_);
+            if ( T* value = components_.find(id) ) {
+                *value = T{std::forward<Args>(args)...};
+                publish_seqlocked_(id, value);
+                return *value;
+            }
+            reserve_seqlocked_(id);
+            reserve_slots_(components_.size() + 1u);
+            components_.insert(id, T{std::forward<Args>(args)...});
+            T& value = components_.data()[insert_slot_(components_.size() - 1u)];
+            publish_seqlocked_(id, &value);
+            return value;
+        }
 
-namespace std
-{
-    template < typename T >
-    struct hash<ecs_hpp::const_component<T>> {
-        std::size_t operator()(const ecs_hpp::const_component<T>& comp) const noexcept {
-            return std::hash<ecs_hpp::const_entity>()(comp.owner());
+        template < typename... Args >
+        T& ensure(entity_id id, Args&&... args) {
+            if ( T* value = components_.find(id) ) {
+                return *value;
+            }
+            std::unique_lock lock(components_locker_);
+            reserve_seqlocked_(id);
+            reserve_slots_(components_.size() + 1u);
+            components_.insert(id, T{std::forward<Args>(args)...});
+            T& value = components_.data()[insert_slot_(components_.size() - 1u)];
+            publish_seqlocked_(id, &value);
+            return value;
         }
-    };
-}
 
-// -----------------------------------------------------------------------------
-//
-// prototype
-//
-// -----------------------------------------------------------------------------
+        // returns nullptr instead of allocating
+        template < typename... Args >
+        T* try_assign(entity_id id, Args&&... args) {
+            std::unique_lock lock(components_locker_);
+            if ( T* value = components_.find(id) ) {
+                *value = T{std::forward<Args>(args)...};
+                publish_seqlocked_(id, value);
+                return value;
+            }
+            if ( !components_.fits(id)
+                || !slots_fit_(components_.size() + 1u)
+                || !seqlocked_fits_(id) )
+            {
+                return nullptr;
+            }
+            components_.insert(id, T{std::forward<Args>(args)...});
+            T* value = components_.data() + insert_slot_(components_.size() - 1u);
+            publish_seqlocked_(id, value);
+            return value;
+        }
 
-namespace ecs_hpp
-{
-    namespace detail
-    {
-        class applier_base;
-        using applier_uptr = std::unique_ptr<applier_base>;
+        void reserve(std::size_t capacity, std::size_t index_capacity) {
+            std::unique_lock lock(components_locker_);
+            reserve_(capacity);
+            components_.reserve_indices(index_capacity);
+        }
 
-        class applier_base {
-        public:
-            virtual ~applier_base() = default;
-            virtual applier_uptr clone() const = 0;
-            virtual void apply_to_entity(entity& ent, bool override) const = 0;
-        };
+        void fill(const entity_id* ids, std::size_t count, const T& value) {
+            std::unique_lock lock(components_locker_);
+            reserve_(components_.size() + count);
+            reserve_slots_(components_.size() + count);
+            for ( std::size_t i = 0; i < count; ++i ) {
+                reserve_seqlocked_(ids[i]);
+            }
+            for ( std::size_t i = 0; i < count; ++i ) {
+                if ( components_.insert_or_assign(ids[i], value).second ) {
+                    insert_slot_(components_.size() - 1u);
+                }
+                publish_seqlocked_(ids[i], &value);
+            }
+        }
 
-        template < typename T >
-        class typed_applier : public applier_base {
-        public:
-            virtual void apply_to_component(T& component) const = 0;
-        };
+        bool exists(entity_id id) const noexcept {
+            std::shared_lock lock(components_locker_);
+            return components_.has(id);
+        }
 
-        template < typename T, typename... Args >
-        class typed_applier_with_args final : public typed_applier<T> {
-        public:
-            typed_applier_with_args(std::tuple<Args...>&& args);
-            typed_applier_with_args(const std::tuple<Args...>& args);
-            applier_uptr clone() const override;
-            void apply_to_entity(entity& ent, bool override) const override;
-            void apply_to_component(T& component) const override;
-        private:
-            std::tuple<Args...> args_;
-        };
-    }
+        bool remove(entity_id id) noexcept override {
+            std::unique_lock lock(components_locker_);
+            const auto p = dense_index_(id);
+            if ( !p.second ) {
+                return false;
+            }
+            erase_slot_(p.first, components_.size() - 1u);
+            unpublish_seqlocked_(id);
+            return components_.unordered_erase(id);
+        }
 
-    class prototype final {
-    public:
-        prototype() = default;
-        ~prototype() noexcept = default;
+        std::size_t remove_all() noexcept {
+            std::unique_lock lock(components_locker_);
+            const std::size_t count = components_.size();
+            for ( const entity_id id : components_.keys() ) {
+                unpublish_seqlocked_(id);
+            }
+            components_.clear();
+            reset_slots_();
+            return count;
+        }
 
-        prototype(const prototype& other);
-        prototype& operator=(const prototype& other);
+        T* find(entity_id id) noexcept {
+            std::unique_lock lock(components_locker_);
+            return components_.find(id);
+        }
 
-        prototype(prototype&& other) noexcept;
-        prototype& operator=(prototype&& other) noexcept;
+        const T* find(entity_id id) const noexcept {
+            std::shared_lock lock(components_locker_);
+            return components_.find(id);
+        }
 
-        void clear() noexcept;
-        bool empty() const noexcept;
-        void swap(prototype& other) noexcept;
+        T* find_enabled(entity_id id) noexcept {
+            std::unique_lock lock(components_locker_);
+            const auto p = dense_index_(id);
+            return p.second && enabled_at(p.first)
+                ? components_.data() + p.first
+                : nullptr;
+        }
 
-        template < typename T >
-        bool has_component() const noexcept;
+        const T* find_enabled(entity_id id) const noexcept {
+            std::shared_lock lock(components_locker_);
+            const auto p = dense_index_(id);
+            return p.second && enabled_at(p.first)
+                ? components_.data() + p.first
+                : nullptr;
+        }
 
-        template < typename T, typename... Args >
-        prototype& component(Args&&... args) &;
-        template < typename T, typename... Args >
-        prototype&& component(Args&&... args) &&;
+        std::size_t count() const noexcept override {
+            std::shared_lock lock(components_locker_);
+            return components_.size();
+        }
 
-        prototype& merge_with(const prototype& other, bool override) &;
-        prototype&& merge_with(const prototype& other, bool override) &&;
+        bool has(entity_id id) const noexcept override {
+            std::shared_lock lock(components_locker_);
+            return components_.has(id);
+        }
 
-        template < typename T >
-        bool apply_to_component(T& component) const;
-        void apply_to_entity(entity& ent, bool override) const;
-    private:
-        detail::sparse_map<
-            family_id,
-            detail::applier_uptr> appliers_;
-    };
+        void* assign_raw(entity_id id, const void* src) override {
+            return &assign(id, *static_cast<const T*>(src));
+        }
 
-    void swap(prototype& l, prototype& r) noexcept;
-}
+        void* find_raw(entity_id id) noexcept override {
+            return find(id);
+        }
 
-// -----------------------------------------------------------------------------
-//
-// triggers
-//
-// -----------------------------------------------------------------------------
+        const void* find_raw(entity_id id) const noexcept override {
+            return find(id);
+        }
 
-namespace ecs_hpp
-{
-    template < typename E >
-    class after {
-    public:
-        const E& event;
-    };
+        raw_view dense_view() noexcept override {
+            return {
+                components_.keys().data(),
+                reinterpret_cast<std::byte*>(components_.data()),
+                sizeof(T),
+                components_.size()};
+        }
 
-    template < typename E >
-    class before {
-    public:
-        const E& event;
-    };
-}
+        void clone(entity_id from, entity_id to) override {
+            if ( const T* c = find(from) ) {
+                assign(to, *c);
+            }
+        }
 
-// -----------------------------------------------------------------------------
-//
-// system
-//
-// -----------------------------------------------------------------------------
+        void capture(entity_id id, compiled_prototype& compiled) const override;
 
-namespace ecs_hpp
-{
-    template <>
-    class system<> {
-    public:
-        virtual ~system() = default;
-    };
+        template < typename Compare >
+        void sort(Compare comp) {
+            std::unique_lock lock(components_locker_);
+            reorder_(comp, [this](auto&& c){
+                components_.sort(c);
+            });
+        }
 
-    template < typename E >
-    class system<E>
-        : public virtual system<> {
-    public:
-        virtual void process(registry& owner, const E& event) = 0;
-    };
+        template < typename F >
+        void for_each_component(F&& f) {
+            std::unique_lock lock(components_locker_);
+            const entity_id* ids = components_.keys().data();
+            T* values = components_.data();
+            if ( seqlock_enabled_() ) {
+                for_each_enabled_index([this, &f, ids, values](std::size_t i){
+                    f(ids[i], values[i]);
+                    publish_seqlocked_(ids[i], values + i);
+                });
+                return;
+            }
+            for_each_enabled_index([&f, ids, values](std::size_t i){
+                f(ids[i], values[i]);
+            });
+        }
 
-    template < typename E, typename... Es>
-    class system<E, Es...>
-        : public system<E>
-        , public system<Es...> {};
-}
+        template < typename F >
+        void for_each_component(F&& f) const {
+            std::shared_lock lock(components_locker_);
+            const entity_id* ids = components_.keys().data();
+            const T* values = components_.data();
+            for_each_enabled_index([&f, ids, values](std::size_t i){
+                f(ids[i], values[i]);
+            });
+        }
 
-// -----------------------------------------------------------------------------
-//
-// feature
-//
-// -----------------------------------------------------------------------------
+        std::size_t memory_usage() const noexcept override {
+            return components_.memory_usage() + seqlock_memory_usage_();
+        }
+    protected:
+        std::pair<std::size_t,bool> dense_index_(entity_id id) const noexcept override {
+            return components_.keys().find_dense_index(id);
+        }
 
-namespace ecs_hpp
-{
-    class feature final {
+        void swap_slots_(std::size_t l, std::size_t r) noexcept override {
+            components_.swap_dense(l, r);
+        }
+    private:
+        void reserve_(std::size_t min_capacity) {
+            if ( components_.capacity() < min_capacity ) {
+                components_.reserve(next_capacity_size(
+                    components_.capacity(),
+                    min_capacity,
+                    std::vector<T>().max_size()));
+            }
+        }
+    private:
+        detail::sparse_map<entity_id, T, entity_id_indexer> components_;
+    };
+
+    template < typename T >
+    class component_storage<T, true> final : public component_storage_base {
     public:
-        feature() = default;
+        component_storage() = default;
 
-        feature(const feature&) = delete;
-        feature& operator=(const feature&) = delete;
+        explicit component_storage(std::pmr::memory_resource* resource)
+        : component_storage_base(resource)
+        , components_(resource) {}
 
-        feature(feature && other) noexcept
-        {
-            *this = std::move(other);
+        template < typename... Args >
+        T& assign(entity_id id, Args&&...) {
+            if ( components_.has(id) ) {
+                return empty_value_;
+            }
+            std::unique_lock lock(components_locker_);
+            reserve_slots_(components_.size() + 1u);
+            components_.insert(id);
+            insert_slot_(components_.size() - 1u);
+            return empty_value_;
         }
-        feature& operator=(feature&& other) noexcept
-        {
-            std::shared_lock lock(systems_locker_);
-            this->disabled_ = other.disabled_;
-            this->systems_.swap(other.systems_);
-            return *this;
+
+        template < typename... Args >
+        T& ensure(entity_id id, Args&&...) {
+            if ( components_.has(id) ) {
+                return empty_value_;
+            }
+            std::unique_lock lock(components_locker_);
+            reserve_slots_(components_.size() + 1u);
+            components_.insert(id);
+            insert_slot_(components_.size() - 1u);
+            return empty_value_;
         }
 
-        feature& enable() & noexcept;
-        feature&& enable() && noexcept;
+        template < typename... Args >
+        T* try_assign(entity_id id, Args&&...) {
+            std::unique_lock lock(components_locker_);
+            if ( components_.has(id) ) {
+                return &empty_value_;
+            }
+            if ( !components_.fits(id) || !slots_fit_(components_.size() + 1u) ) {
+                return nullptr;
+            }
+            components_.insert(id);
+            insert_slot_(components_.size() - 1u);
+            return &empty_value_;
+        }
 
-        feature& disable() & noexcept;
-        feature&& disable() && noexcept;
+        void reserve(std::size_t capacity, std::size_t index_capacity) {
+            std::unique_lock lock(components_locker_);
+            if ( components_.capacity() < capacity ) {
+                components_.reserve(capacity);
+            }
+            components_.reserve_indices(index_capacity);
+        }
 
-        bool is_enabled() const noexcept;
-        bool is_disabled() const noexcept;
+        void fill(const entity_id* ids, std::size_t count, const T&) {
+            std::unique_lock lock(components_locker_);
+            if ( components_.capacity() < components_.size() + count ) {
+                components_.reserve(next_capacity_size(
+                    components_.capacity(),
+                    components_.size() + count,
+                    std::vector<entity_id>().max_size()));
+            }
+            reserve_slots_(components_.size() + count);
+            for ( std::size_t i = 0; i < count; ++i ) {
+                if ( components_.insert(ids[i]) ) {
+                    insert_slot_(components_.size() - 1u);
+                }
+            }
+        }
 
-        template < typename T, typename... Args >
-        feature& add_system(Args&&... args) &;
-        template < typename T, typename... Args >
-        feature&& add_system(Args&&... args) &&;
+        bool exists(entity_id id) const noexcept {
+            std::shared_lock lock(components_locker_);
+            return components_.has(id);
+        }
 
-        template < typename Event >
-        feature& process_event(registry& owner, const Event& event);
-    private:
-        bool disabled_{false};
-        std::vector<std::unique_ptr<system<>>> systems_;
-        mutable std::shared_mutex systems_locker_;
-    };
-}
+        bool remove(entity_id id) noexcept override {
+            std::unique_lock lock(components_locker_);
+            const auto p = dense_index_(id);
+            if ( !p.second ) {
+                return false;
+            }
+            erase_slot_(p.first, components_.size() - 1u);
+            return components_.unordered_erase(id);
+        }
 
-// -----------------------------------------------------------------------------
-//
-// registry
-//
-// -----------------------------------------------------------------------------
+        std::size_t remove_all() noexcept {
+            std::unique_lock lock(components_locker_);
+            const std::size_t count = components_.size();
+            components_.clear();
+            reset_slots_();
+            return count;
+        }
 
-namespace ecs_hpp
-{
-    class registry final {
-    private:
-        class uentity {
-        public:
-            uentity(registry& owner, entity_id id) noexcept;
-
-            uentity(entity_id ent) noexcept;
-            uentity(entity ent) noexcept;
+        T* find(entity_id id) noexcept {
+            std::unique_lock lock(components_locker_);
+            return components_.has(id)
+                ? &empty_value_
+                : nullptr;
+        }
 
-            operator entity_id() const noexcept;
-            operator entity() const noexcept;
-            operator const_entity() const noexcept;
+        const T* find(entity_id id) const noexcept {
+            std::shared_lock lock(components_locker_);
+            return components_.has(id)
+                ? &empty_value_
+                : nullptr;
+        }
 
-            entity_id id() const noexcept;
-            registry* owner() noexcept;
-            const registry* owner() const noexcept;
+        T* find_enabled(entity_id id) noexcept {
+            return has_enabled(id)
+                ? &empty_value_
+                : nullptr;
+        }
 
-            bool check_owner(const registry* owner) const noexcept;
-        private:
-            entity_id id_{0u};
-            registry* owner_{nullptr};
-        };
+        const T* find_enabled(entity_id id) const noexcept {
+            return has_enabled(id)
+                ? &empty_value_
+                : nullptr;
+        }
 
-        class const_uentity {
-        public:
-            const_uentity(const registry& owner, entity_id id) noexcept;
+        std::size_t count() const noexcept override {
+            std::shared_lock lock(components_locker_);
+            return components_.size();
+        }
 
-            const_uentity(entity_id ent) noexcept;
-            const_uentity(entity ent) noexcept;
-            const_uentity(const_entity ent) noexcept;
-            const_uentity(const uentity& ent) noexcept;
+        bool has(entity_id id) const noexcept override {
+            std::shared_lock lock(components_locker_);
+            return components_.has(id);
+        }
 
-            operator entity_id() const noexcept;
-            operator const_entity() const noexcept;
+        void* assign_raw(entity_id id, const void* src) override {
+            (void)src;
+            return &assign(id);
+        }
 
-            entity_id id() const noexcept;
-            const registry* owner() const noexcept;
+        void* find_raw(entity_id id) noexcept override {
+            return find(id);
+        }
 
-            bool check_owner(const registry* owner) const noexcept;
-        private:
-            entity_id id_{0u};
-            const registry* owner_{nullptr};
-        };
+        const void* find_raw(entity_id id) const noexcept override {
+            return find(id);
+        }
 
-        class mutexes
-        {
-        public:
-            mutable std::shared_mutex entity_ids_locker_;
-            mutable std::shared_mutex features_locker_;
+        raw_view dense_view() noexcept override {
+            return {
+                components_.data(),
+                reinterpret_cast<std::byte*>(&empty_value_),
+                0u,
+                components_.size()};
+        }
 
-            mutexes() = default;
-            mutexes(const mutexes& other) = delete;
-            mutexes & operator=(const mutexes & other) = delete;
-            mutexes(mutexes && other) noexcept
-            {
-                // Wait until no more usages are pending
-                std::scoped_lock lock(other.entity_ids_locker_, other.features_locker_, this->entity_ids_locker_, this->entity_ids_locker_);
-            }
-            mutexes & operator=(mutexes && other) noexcept
-            {
-                // Wait until no more usages are pending
-                std::scoped_lock lock(other.entity_ids_locker_, other.features_locker_, this->entity_ids_locker_,
-                                      this->entity_ids_locker_);
-                return *this;
+        void clone(entity_id from, entity_id to) override {
+            if ( const T* c = find(from) ) {
+                assign(to, *c);
             }
-        };
-    public:
-        registry() = default;
-
-        registry(const registry& other) = delete;
-        registry& operator=(const registry& other) = delete;
+        }
 
-        registry(registry&& other) noexcept = default;
-        registry& operator=(registry&& other) noexcept = default;
+        void capture(entity_id id, compiled_prototype& compiled) const override;
 
-        entity wrap_entity(const const_uentity& ent) noexcept;
-        const_entity wrap_entity(const const_uentity& ent) const noexcept;
+        template < typename Compare >
+        void sort(Compare comp) {
+            std::unique_lock lock(components_locker_);
+            reorder_(comp, [this](auto&& c){
+                components_.sort(c);
+            });
+        }
 
-        template < typename T >
-        component<T> wrap_component(const const_uentity& ent) noexcept;
-        template < typename T >
-        const_component<T> wrap_component(const const_uentity& ent) const noexcept;
+        template < typename F >
+        void for_each_component(F&& f) {
+            std::unique_lock lock(components_locker_);
+            const entity_id* ids = components_.data();
+            for_each_enabled_index([&f, ids](std::size_t i){
+                f(ids[i], empty_value_);
+            });
+        }
 
-        entity create_entity();
-        entity create_entity(const prototype& proto);
-        entity create_entity(const const_uentity& proto);
+        template < typename F >
+        void for_each_component(F&& f) const {
+            std::shared_lock lock(components_locker_);
+            const entity_id* ids = components_.data();
+            for_each_enabled_index([&f, ids](std::size_t i){
+                f(ids[i], std::as_const(empty_value_));
+            });
+        }
 
-        void destroy_entity(const uentity& ent) noexcept;
-        bool valid_entity(const const_uentity& ent) const noexcept;
+        std::size_t memory_usage() const noexcept override {
+            std::shared_lock lock(components_locker_);
+            return components_.memory_usage();
+        }
+    protected:
+        std::pair<std::size_t,bool> dense_index_(entity_id id) const noexcept override {
+            return components_.find_dense_index(id);
+        }
 
-        template < typename T, typename... Args >
-        T& assign_component(const uentity& ent, Args&&... args);
+        void swap_slots_(std::size_t l, std::size_t r) noexcept override {
+            components_.swap_dense(l, r);
+        }
+    private:
+        static T empty_value_;
+        detail::sparse_set<entity_id, entity_id_indexer> components_;
+    };
 
-        template < typename T, typename... Args >
-        T& ensure_component(const uentity& ent, Args&&... args);
+    template < typename T >
+    T component_storage<T, true>::empty_value_;
+}
 
-        template < typename T >
-        bool remove_component(const uentity& ent) noexcept;
+// -----------------------------------------------------------------------------
+//
+// detail::static_component_storage
+//
+// -----------------------------------------------------------------------------
 
-        template < typename T >
-        bool exists_component(const const_uentity& ent) const noexcept;
+namespace ecs_hpp::detail
+{
+    // the typed core of component_storage for static_registry: no virtual base,
+    // no disabled bits, no active/dormant partition and no seqlock mirror,
+    // so every component is enabled and a storage is a map and a locker
 
-        std::size_t remove_all_components(const uentity& ent) noexcept;
+    template < typename T, bool E = std::is_empty_v<T> >
+    class static_component_storage final {
+    public:
+        template < typename... Args >
+        T& assign(entity_id id, Args&&... args) {
+            std::unique_lock lock(components_locker_);
+            if ( T* value = components_.find(id) ) {
+                *value = T{std::forward<Args>(args)...};
+                return *value;
+            }
+            return *components_.insert(id, T{std::forward<Args>(args)...}).first;
+        }
 
-        template < typename T >
-        std::size_t remove_all_components() noexcept;
+        template < typename... Args >
+        T& ensure(entity_id id, Args&&... args) {
+            std::unique_lock lock(components_locker_);
+            if ( T* value = components_.find(id) ) {
+                return *value;
+            }
+            return *components_.insert(id, T{std::forward<Args>(args)...}).first;
+        }
 
-        template < typename T >
-        T& get_component(const uentity& ent);
-        template < typename T >
-        const T& get_component(const const_uentity& ent) const;
+        bool exists(entity_id id) const noexcept {
+            std::shared_lock lock(components_locker_);
+            return components_.has(id);
+        }
 
-        template < typename T >
-        T* find_component(const uentity& ent) noexcept;
-        template < typename T >
-        const T* find_component(const const_uentity& ent) const noexcept;
+        bool remove(entity_id id) noexcept {
+            std::unique_lock lock(components_locker_);
+            return components_.unordered_erase(id);
+        }
 
-        template < typename... Ts >
-        std::tuple<Ts&...> get_components(const uentity& ent);
-        template < typename... Ts >
-        std::tuple<const Ts&...> get_components(const const_uentity& ent) const;
+        std::size_t remove_all() noexcept {
+            std::unique_lock lock(components_locker_);
+            const std::size_t count = components_.size();
+            components_.clear();
+            return count;
+        }
 
-        template < typename... Ts >
-        std::tuple<Ts*...> find_components(const uentity& ent) noexcept;
-        template < typename... Ts >
-        std::tuple<const Ts*...> find_components(const const_uentity& ent) const noexcept;
+        T* find(entity_id id) noexcept {
+            std::unique_lock lock(components_locker_);
+            return components_.find(id);
+        }
 
-        template < typename T >
-        std::size_t component_count() const noexcept;
-        std::size_t entity_count() const noexcept;
-        std::size_t entity_component_count(const const_uentity& ent) const noexcept;
+        const T* find(entity_id id) const noexcept {
+            std::shared_lock lock(components_locker_);
+            return components_.find(id);
+        }
 
-        template < typename F, typename... Opts >
-        void for_each_entity(F&& f, Opts&&... opts);
-        template < typename F, typename... Opts >
-        void for_each_entity(F&& f, Opts&&... opts) const;
+        T* find_enabled(entity_id id) noexcept {
+            return find(id);
+        }
 
-        template < typename T, typename F, typename... Opts >
-        void for_each_component(F&& f, Opts&&... opts);
-        template < typename T, typename F, typename... Opts >
-        void for_each_component(F&& f, Opts&&... opts) const;
+        const T* find_enabled(entity_id id) const noexcept {
+            return find(id);
+        }
 
-        template < typename... Ts, typename F, typename... Opts >
-        void for_joined_components(F&& f, Opts&&... opts);
-        template < typename... Ts, typename F, typename... Opts >
-        void for_joined_components(F&& f, Opts&&... opts) const;
+        std::size_t count() const noexcept {
+            std::shared_lock lock(components_locker_);
+            return components_.size();
+        }
 
-        template < typename Tag, typename... Args >
-        feature& assign_feature(Args&&... args);
+        bool has(entity_id id) const noexcept {
+            std::shared_lock lock(components_locker_);
+            return components_.has(id);
+        }
 
-        template < typename Tag, typename... Args >
-        feature& ensure_feature(Args&&... args);
+        bool has_enabled(entity_id id) const noexcept {
+            return has(id);
+        }
 
-        template < typename Tag >
-        bool has_feature() const noexcept;
+        void clone(entity_id from, entity_id to) {
+            if ( const T* c = find(from) ) {
+                assign(to, *c);
+            }
+        }
 
-        template < typename Tag >
-        feature& get_feature();
+        template < typename F >
+        void for_each_component(F&& f) {
+            std::unique_lock lock(components_locker_);
+            const entity_id* ids = components_.keys().data();
+            T* values = components_.data();
+            for ( std::size_t i = 0; i < components_.size(); ++i ) {
+                f(ids[i], values[i]);
+            }
+        }
 
-        template < typename Tag >
-        const feature& get_feature() const;
+        template < typename F >
+        void for_each_component(F&& f) const {
+            std::shared_lock lock(components_locker_);
+            const entity_id* ids = components_.keys().data();
+            const T* values = components_.data();
+            for ( std::size_t i = 0; i < components_.size(); ++i ) {
+                f(ids[i], values[i]);
+            }
+        }
 
-        template < typename Event >
-        registry& process_event(const Event& event);
+        std::size_t memory_usage() const noexcept {
+            std::shared_lock lock(components_locker_);
+            return components_.memory_usage();
+        }
+    private:
+        mutable std::shared_mutex components_locker_;
+        detail::sparse_map<entity_id, T, entity_id_indexer> components_;
+    };
 
-        struct memory_usage_info {
-            std::size_t entities{0u};
-            std::size_t components{0u};
-        };
-        memory_usage_info memory_usage() const noexcept;
+    template < typename T >
+    class static_component_storage<T, true> final {
+    public:
+        template < typename... Args >
+        T& assign(entity_id id, Args&&...) {
+            std::unique_lock lock(components_locker_);
+            components_.insert(id);
+            return empty_value_;
+        }
 
-        template < typename T >
-        std::size_t component_memory_usage() const noexcept;
-    private:
-        template < typename T >
-        detail::component_storage<T>* find_storage_() noexcept;
+        template < typename... Args >
+        T& ensure(entity_id id, Args&&...) {
+            std::unique_lock lock(components_locker_);
+            components_.insert(id);
+            return empty_value_;
+        }
 
-        template < typename T >
-        const detail::component_storage<T>* find_storage_() const noexcept;
+        bool exists(entity_id id) const noexcept {
+            std::shared_lock lock(components_locker_);
+            return components_.has(id);
+        }
 
-        template < typename T >
-        detail::component_storage<T>& get_or_create_storage_();
+        bool remove(entity_id id) noexcept {
+            std::unique_lock lock(components_locker_);
+            return components_.unordered_erase(id);
+        }
 
-        template < typename F, typename... Opts >
-        void for_joined_components_impl_(
-            std::index_sequence<>,
-            F&& f,
-            Opts&&... opts);
+        std::size_t remove_all() noexcept {
+            std::unique_lock lock(components_locker_);
+            const std::size_t count = components_.size();
+            components_.clear();
+            return count;
+        }
 
-        template < typename F, typename... Opts >
-        void for_joined_components_impl_(
-            std::index_sequence<>,
-            F&& f,
-            Opts&&... opts) const;
-
-        template < typename T
-                 , typename... Ts
-                 , typename F
-                 , typename... Opts
-                 , std::size_t I
-                 , std::size_t... Is >
-        void for_joined_components_impl_(
-            std::index_sequence<I, Is...>,
-            F&& f,
-            Opts&&... opts);
-
-        template < typename T
-                 , typename... Ts
-                 , typename F
-                 , typename... Opts
-                 , std::size_t I
-                 , std::size_t... Is >
-        void for_joined_components_impl_(
-            std::index_sequence<I, Is...>,
-            F&& f,
-            Opts&&... opts) const;
-
-        template < typename T
-                 , typename... Ts
-                 , typename F
-                 , typename Ss
-                 , typename... Cs >
-        void for_joined_components_impl_(
-            const uentity& e,
-            const F& f,
-            const Ss& ss,
-            Cs&... cs);
-
-        template < typename T
-                 , typename... Ts
-                 , typename F
-                 , typename Ss
-                 , typename... Cs >
-        void for_joined_components_impl_(
-            const const_uentity& e,
-            const F& f,
-            const Ss& ss,
-            const Cs&... cs) const;
-
-        template < typename F, typename... Cs >
-        void for_joined_components_impl_(
-            const uentity& e,
-            const F& f,
-            const std::tuple<>& ss,
-            Cs&... cs);
-
-        template < typename F, typename... Cs >
-        void for_joined_components_impl_(
-            const const_uentity& e,
-            const F& f,
-            const std::tuple<>& ss,
-            const Cs&... cs) const;
-    private:
-        entity_id last_entity_id_{0u};
-        std::vector<entity_id> free_entity_ids_;
+        T* find(entity_id id) noexcept {
+            std::shared_lock lock(components_locker_);
+            return components_.has(id)
+                ? &empty_value_
+                : nullptr;
+        }
 
-        /* protected by mutexes.entity_ids_mutex */
-        detail::sparse_set<entity_id, detail::entity_id_indexer> entity_ids_;
+        const T* find(entity_id id) const noexcept {
+            std::shared_lock lock(components_locker_);
+            return components_.has(id)
+                ? &empty_value_
+                : nullptr;
+        }
 
-        using storage_uptr = std::unique_ptr<detail::component_storage_base>;
-        detail::sparse_map<family_id, storage_uptr> storages_;
+        T* find_enabled(entity_id id) noexcept {
+            return find(id);
+        }
 
-        /* protected by mutexes.features_mutex */
-        detail::sparse_map<family_id, feature> features_;
+        const T* find_enabled(entity_id id) const noexcept {
+            return find(id);
+        }
 
-        mutable mutexes mutexes_;
+        std::size_t count() const noexcept {
+            std::shared_lock lock(components_locker_);
+            return components_.size();
+        }
+
+        bool has(entity_id id) const noexcept {
+            std::shared_lock lock(components_locker_);
+            return components_.has(id);
+        }
+
+        bool has_enabled(entity_id id) const noexcept {
+            return has(id);
+        }
+
+        void clone(entity_id from, entity_id to) {
+            if ( find(from) ) {
+                assign(to);
+            }
+        }
+
+        template < typename F >
+        void for_each_component(F&& f) {
+            std::unique_lock lock(components_locker_);
+            for ( const entity_id id : components_ ) {
+                f(id, empty_value_);
+            }
+        }
+
+        template < typename F >
+        void for_each_component(F&& f) const {
+            std::shared_lock lock(components_locker_);
+            for ( const entity_id id : components_ ) {
+                f(id, std::as_const(empty_value_));
+            }
+        }
+
+        std::size_t memory_usage() const noexcept {
+            std::shared_lock lock(components_locker_);
+            return components_.memory_usage();
+        }
+    private:
+        static T empty_value_;
+        mutable std::shared_mutex components_locker_;
+        detail::sparse_set<entity_id, entity_id_indexer> components_;
     };
+
+    template < typename T >
+    T static_component_storage<T, true>::empty_value_;
 }
 
 // -----------------------------------------------------------------------------
 //
-// options
+// runtime_component_info
 //
 // -----------------------------------------------------------------------------
 
 namespace ecs_hpp
 {
-    namespace detail
-    {
-        template < typename T >
-        struct is_option
-        : std::false_type {};
+    struct runtime_component_info {
+        std::size_t size{0u};
+        std::size_t alignment{alignof(std::max_align_t)};
+
+        // nullptr functions mean memcpy copying and moving and trivial destroying,
+        // move and destroy must not throw
+
+        void (*copy)(void* dst, const void* src){nullptr};
+        void (*move)(void* dst, void* src){nullptr};
+        void (*destroy)(void* ptr){nullptr};
 
         template < typename T >
-        struct is_option<exists<T>>
-        : std::true_type {};
+        static runtime_component_info of() noexcept {
+            static_assert(std::is_copy_constructible_v<T>);
+            static_assert(std::is_nothrow_move_constructible_v<T>);
+            runtime_component_info info;
+            info.size = sizeof(T);
+            info.alignment = alignof(T);
+            if constexpr ( !std::is_trivially_copyable_v<T> ) {
+                info.copy = [](void* dst, const void* src){
+                    new (dst) T(*static_cast<const T*>(src));
+                };
+                info.move = [](void* dst, void* src){
+                    new (dst) T(std::move(*static_cast<T*>(src)));
+                };
+            }
+            if constexpr ( !std::is_trivially_destructible_v<T> ) {
+                info.destroy = [](void* ptr){
+                    static_cast<T*>(ptr)->~T();
+                };
+            }
+            return info;
+        }
+    };
+}
 
-        template < typename... Ts >
-        struct is_option<exists_any<Ts...>>
-        : std::true_type {};
+// -----------------------------------------------------------------------------
+//
+// detail::runtime_component_storage
+//
+// -----------------------------------------------------------------------------
 
-        template < typename... Ts >
-        struct is_option<exists_all<Ts...>>
-        : std::true_type {};
+namespace ecs_hpp::detail
+{
+    class runtime_component_storage final : public component_storage_base {
+    public:
+        explicit runtime_component_storage(
+            const runtime_component_info& info,
+            std::pmr::memory_resource* resource = std::pmr::get_default_resource())
+        : component_storage_base(resource)
+        , resource_(resource)
+        , ids_(resource)
+        , info_(info)
+        , stride_((std::max(info.size, std::size_t(1u)) + info.alignment - 1u) / info.alignment * info.alignment) {
+            assert(info_.alignment && !(info_.alignment & (info_.alignment - 1u)));
+        }
 
-        template < typename T >
-        struct is_option<option_neg<T>>
-        : std::true_type {};
+        ~runtime_component_storage() noexcept override {
+            destroy_all_();
+            deallocate_(data_, capacity_);
+        }
 
-        template < typename... Ts >
-        struct is_option<option_conj<Ts...>>
-        : std::true_type {};
+        runtime_component_storage(const runtime_component_storage&) = delete;
+        runtime_component_storage& operator=(const runtime_component_storage&) = delete;
 
-        template < typename... Ts >
-        struct is_option<option_disj<Ts...>>
-        : std::true_type {};
+        const runtime_component_info& info() const noexcept {
+            return info_;
+        }
 
-        template <>
-        struct is_option<option_bool>
-        : std::true_type {};
+        void* assign_raw(entity_id id, const void* src) override {
+            std::unique_lock lock(components_locker_);
+            // one spare slot is kept for swapping slots
+            reserve_(ids_.size() + 2u);
+            reserve_slots_(ids_.size() + 1u);
+            std::byte* tmp = slot_(ids_.size());
+            copy_(tmp, src);
+            if ( const auto p = ids_.find_dense_index(id); p.second ) {
+                std::byte* dst = slot_(p.first);
+                destroy_(dst);
+                move_(dst, tmp);
+                destroy_(tmp);
+                return dst;
+            }
+            ECS_HPP_TRY {
+                ids_.insert(id);
+            } ECS_HPP_CATCH_ALL {
+                destroy_(tmp);
+                ECS_HPP_RETHROW;
+            }
+            return slot_(insert_slot_(ids_.size() - 1u));
+        }
 
-        template < typename T >
-        inline constexpr bool is_option_v = is_option<T>::value;
-    }
+        bool remove(entity_id id) noexcept override {
+            std::unique_lock lock(components_locker_);
+            const auto p = ids_.find_dense_index(id);
+            if ( !p.second ) {
+                return false;
+            }
+            const std::size_t index = erase_slot_(p.first, ids_.size() - 1u);
+            std::byte* dst = slot_(index);
+            destroy_(dst);
+            if ( index != ids_.size() - 1u ) {
+                std::byte* last = slot_(ids_.size() - 1u);
+                move_(dst, last);
+                destroy_(last);
+            }
+            ids_.unordered_erase(id);
+            return true;
+        }
 
-    //
-    // options
-    //
+        std::size_t remove_all() noexcept {
+            std::unique_lock lock(components_locker_);
+            const std::size_t count = ids_.size();
+            destroy_all_();
+            ids_.clear();
+            reset_slots_();
+            return count;
+        }
 
-    template < typename T >
-    class exists final {
+        bool has(entity_id id) const noexcept override {
+            std::shared_lock lock(components_locker_);
+            return ids_.has(id);
+        }
+
+        void* find_raw(entity_id id) noexcept override {
+            std::unique_lock lock(components_locker_);
+            const auto p = ids_.find_dense_index(id);
+            return p.second ? slot_(p.first) : nullptr;
+        }
+
+        const void* find_raw(entity_id id) const noexcept override {
+            std::shared_lock lock(components_locker_);
+            const auto p = ids_.find_dense_index(id);
+            return p.second ? slot_(p.first) : nullptr;
+        }
+
+        std::size_t count() const noexcept override {
+            std::shared_lock lock(components_locker_);
+            return ids_.size();
+        }
+
+        void clone(entity_id from, entity_id to) override {
+            if ( const void* c = std::as_const(*this).find_raw(from) ) {
+                assign_raw(to, c);
+            }
+        }
+
+        // compiled prototypes hold typed values only
+        void capture(entity_id, compiled_prototype&) const override {}
+
+        template < typename F >
+        void for_each_component(F&& f) {
+            std::unique_lock lock(components_locker_);
+            for_each_enabled_index([this, &f](std::size_t i){
+                f(ids_.data()[i], static_cast<void*>(slot_(i)));
+            });
+        }
+
+        template < typename F >
+        void for_each_component(F&& f) const {
+            std::shared_lock lock(components_locker_);
+            for_each_enabled_index([this, &f](std::size_t i){
+                f(ids_.data()[i], static_cast<const void*>(slot_(i)));
+            });
+        }
+
+        raw_view dense_view() noexcept override {
+            return {ids_.data(), data_, stride_, ids_.size()};
+        }
+
+        std::size_t memory_usage() const noexcept override {
+            return ids_.memory_usage()
+                + capacity_ * stride_;
+        }
+    protected:
+        std::pair<std::size_t,bool> dense_index_(entity_id id) const noexcept override {
+            return ids_.find_dense_index(id);
+        }
+
+        void swap_slots_(std::size_t l, std::size_t r) noexcept override {
+            assert(ids_.size() < capacity_);
+            std::byte* tmp = slot_(ids_.size());
+            move_(tmp, slot_(l));
+            destroy_(slot_(l));
+            move_(slot_(l), slot_(r));
+            destroy_(slot_(r));
+            move_(slot_(r), tmp);
+            destroy_(tmp);
+            ids_.swap_dense(l, r);
+        }
+    private:
+        std::byte* slot_(std::size_t index) const noexcept {
+            return data_ + index * stride_;
+        }
+
+        void copy_(void* dst, const void* src) const {
+            if ( info_.copy ) {
+                info_.copy(dst, src);
+            } else {
+                std::memcpy(dst, src, info_.size);
+            }
+        }
+
+        void move_(void* dst, void* src) const noexcept {
+            if ( info_.move ) {
+                info_.move(dst, src);
+            } else {
+                std::memcpy(dst, src, info_.size);
+            }
+        }
+
+        void destroy_(void* ptr) const noexcept {
+            if ( info_.destroy ) {
+                info_.destroy(ptr);
+            }
+        }
+
+        void destroy_all_() noexcept {
+            for ( std::size_t i = 0; i < ids_.size(); ++i ) {
+                destroy_(slot_(i));
+            }
+        }
+
+        void reserve_(std::size_t min_capacity) {
+            if ( min_capacity <= capacity_ ) {
+                return;
+            }
+            const std::size_t new_capacity = next_capacity_size(
+                capacity_,
+                min_capacity,
+                std::numeric_limits<std::size_t>::max() / stride_);
+            std::byte* new_data = static_cast<std::byte*>(resource_->allocate(
+                new_capacity * stride_,
+                info_.alignment));
+            for ( std::size_t i = 0; i < ids_.size(); ++i ) {
+                move_(new_data + i * stride_, slot_(i));
+                destroy_(slot_(i));
+            }
+            deallocate_(data_, capacity_);
+            data_ = new_data;
+            capacity_ = new_capacity;
+        }
+
+        void deallocate_(std::byte* data, std::size_t capacity) const noexcept {
+            if ( data ) {
+                resource_->deallocate(data, capacity * stride_, info_.alignment);
+            }
+        }
+    private:
+        std::pmr::memory_resource* resource_{nullptr};
+        sparse_set<entity_id, entity_id_indexer> ids_;
+        runtime_component_info info_;
+        std::size_t stride_{0u};
+        std::byte* data_{nullptr};
+        std::size_t capacity_{0u};
+    };
+}
+
+// -----------------------------------------------------------------------------
+//
+// detail::hierarchy_storage
+//
+// -----------------------------------------------------------------------------
+
+namespace ecs_hpp::detail
+{
+    class hierarchy_storage final {
     public:
-        bool operator()(const const_entity& e) const {
-            return e.exists_component<T>();
+        struct link {
+            entity_id parent{0u};
+            entity_id first_child{0u};
+            entity_id last_child{0u};
+            entity_id prev_sibling{0u};
+            entity_id next_sibling{0u};
+            std::size_t child_count{0u};
+        };
+
+        struct entry {
+            entity_id id{0u};
+            entity_id parent{0u};
+            std::size_t depth{0u};
+        };
+    public:
+        hierarchy_storage() = default;
+
+        explicit hierarchy_storage(std::pmr::memory_resource* resource)
+        : links_(resource)
+        , order_(resource) {}
+
+        bool attach(entity_id child, entity_id parent) {
+            for ( entity_id id = parent; id != 0u; ) {
+                if ( id == child ) {
+                    return false;
+                }
+                const link* l = links_.find(id);
+                id = l ? l->parent : 0u;
+            }
+            unlink_(child);
+            links_.insert(child, link{});
+            links_.insert(parent, link{});
+            link& c = links_.get(child);
+            link& p = links_.get(parent);
+            c.parent = parent;
+            c.prev_sibling = p.last_child;
+            if ( p.last_child ) {
+                links_.get(p.last_child).next_sibling = child;
+            } else {
+                p.first_child = child;
+            }
+            p.last_child = child;
+            ++p.child_count;
+            dirty_ = true;
+            return true;
+        }
+
+        bool detach(entity_id child) noexcept {
+            const link* c = links_.find(child);
+            if ( !c || !c->parent ) {
+                return false;
+            }
+            unlink_(child);
+            release_if_unused_(child);
+            return true;
+        }
+
+        void remove(entity_id id) noexcept {
+            if ( !links_.has(id) ) {
+                return;
+            }
+            unlink_(id);
+            for ( entity_id child = links_.get(id).first_child; child != 0u; ) {
+                link& c = links_.get(child);
+                const entity_id next = c.next_sibling;
+                c.parent = c.prev_sibling = c.next_sibling = 0u;
+                release_if_unused_(child);
+                child = next;
+            }
+            links_.unordered_erase(id);
+            dirty_ = true;
+        }
+
+        // ids must be a subtree collected by collect_subtree, root first
+        void remove_subtree(const std::vector<entity_id>& ids) noexcept {
+            if ( ids.empty() || !links_.has(ids.front()) ) {
+                return;
+            }
+            unlink_(ids.front());
+            for ( const entity_id id : ids ) {
+                links_.unordered_erase(id);
+            }
+            dirty_ = true;
+        }
+
+        entity_id parent(entity_id id) const noexcept {
+            const link* l = links_.find(id);
+            return l ? l->parent : 0u;
+        }
+
+        std::size_t child_count(entity_id id) const noexcept {
+            const link* l = links_.find(id);
+            return l ? l->child_count : 0u;
+        }
+
+        template < typename F >
+        void for_each_child(entity_id id, F&& f) const {
+            const link* l = links_.find(id);
+            for ( entity_id child = l ? l->first_child : 0u; child != 0u; ) {
+                const entity_id next = links_.get(child).next_sibling;
+                f(child);
+                child = next;
+            }
+        }
+
+        void collect_subtree(entity_id root, std::vector<entity_id>& ids) const {
+            const std::size_t first = ids.size();
+            ids.push_back(root);
+            for ( std::size_t i = first; i < ids.size(); ++i ) {
+                for_each_child(ids[i], [&ids](entity_id child){
+                    ids.push_back(child);
+                });
+            }
+        }
+
+        // roots first, then breadth-first: every parent precedes
+        // its children and siblings are contiguous
+        const resource_vector<entry>& order() {
+            if ( !dirty_ ) {
+                return order_;
+            }
+            order_.clear();
+            for ( const entity_id id : links_ ) {
+                if ( !links_.get(id).parent ) {
+                    order_.push_back({id, 0u, 0u});
+                }
+            }
+            for ( std::size_t i = 0; i < order_.size(); ++i ) {
+                const entry e = order_[i];
+                for_each_child(e.id, [this, &e](entity_id child){
+                    order_.push_back({child, e.id, e.depth + 1u});
+                });
+            }
+            dirty_ = false;
+            return order_;
+        }
+
+        bool empty() const noexcept {
+            return links_.empty();
+        }
+
+        std::size_t memory_usage() const noexcept {
+            return links_.memory_usage()
+                + order_.capacity() * sizeof(order_[0]);
+        }
+    private:
+        void unlink_(entity_id child) noexcept {
+            link* c = links_.find(child);
+            if ( !c || !c->parent ) {
+                return;
+            }
+            const entity_id parent = c->parent;
+            link& p = links_.get(parent);
+            if ( c->prev_sibling ) {
+                links_.get(c->prev_sibling).next_sibling = c->next_sibling;
+            } else {
+                p.first_child = c->next_sibling;
+            }
+            if ( c->next_sibling ) {
+                links_.get(c->next_sibling).prev_sibling = c->prev_sibling;
+            } else {
+                p.last_child = c->prev_sibling;
+            }
+            --p.child_count;
+            c->parent = c->prev_sibling = c->next_sibling = 0u;
+            release_if_unused_(parent);
+            dirty_ = true;
+        }
+
+        void release_if_unused_(entity_id id) noexcept {
+            const link* l = links_.find(id);
+            if ( l && !l->parent && !l->child_count ) {
+                links_.unordered_erase(id);
+            }
+        }
+    private:
+        sparse_map<entity_id, link, entity_id_indexer> links_;
+        resource_vector<entry> order_;
+        bool dirty_{false};
+    };
+}
+
+// -----------------------------------------------------------------------------
+//
+// detail::relation_storage
+//
+// -----------------------------------------------------------------------------
+
+namespace ecs_hpp::detail
+{
+    class relation_storage_base {
+    public:
+        virtual ~relation_storage_base() = default;
+        virtual std::size_t remove_all(entity_id id) noexcept = 0;
+        virtual std::size_t count() const noexcept = 0;
+        virtual std::size_t memory_usage() const noexcept = 0;
+    };
+
+    // every link knows its position in the peer list,
+    // so unlinking either side is a back-patched swap-and-pop
+    template < typename R >
+    class relation_storage final : public relation_storage_base {
+    public:
+        relation_storage() = default;
+
+        explicit relation_storage(std::pmr::memory_resource* resource)
+        : targets_(resource)
+        , sources_(resource) {}
+
+        template < typename... Args >
+        R& assign(entity_id source, entity_id target, Args&&... args) {
+            std::unique_lock lock(relations_locker_);
+            auto& targets = *targets_.insert(source, target_list()).first;
+            for ( auto& l : targets ) {
+                if ( l.target == target ) {
+                    l.value = R{std::forward<Args>(args)...};
+                    return l.value;
+                }
+            }
+            ECS_HPP_TRY {
+                targets.push_back(target_link{target, 0u, R{std::forward<Args>(args)...}});
+                source_list& sources = *sources_.insert(target, source_list()).first;
+                sources.push_back(source_link{source, targets.size() - 1u});
+                targets.back().source_index = sources.size() - 1u;
+            } ECS_HPP_CATCH_ALL {
+                if ( !targets.empty() && targets.back().target == target ) {
+                    targets.pop_back();
+                }
+                release_empty_(target, sources_);
+                release_empty_(source, targets_);
+                ECS_HPP_RETHROW;
+            }
+            ++count_;
+            return targets.back().value;
+        }
+
+        bool remove(entity_id source, entity_id target) noexcept {
+            std::unique_lock lock(relations_locker_);
+            target_list* targets = targets_.find(source);
+            if ( !targets ) {
+                return false;
+            }
+            for ( std::size_t i = 0; i < targets->size(); ++i ) {
+                if ( (*targets)[i].target == target ) {
+                    erase_source_(target, (*targets)[i].source_index);
+                    erase_target_(source, i);
+                    release_empty_(target, sources_);
+                    release_empty_(source, targets_);
+                    --count_;
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        // O(relations of the entity), peers are unlinked in O(1)
+        std::size_t remove_all(entity_id id) noexcept override {
+            std::unique_lock lock(relations_locker_);
+            std::size_t removed_count = 0u;
+            while ( target_list* targets = targets_.find(id) ) {
+                const target_link& l = targets->back();
+                const entity_id target = l.target;
+                erase_source_(target, l.source_index);
+                erase_target_(id, targets->size() - 1u);
+                release_empty_(target, sources_);
+                release_empty_(id, targets_);
+                ++removed_count;
+            }
+            while ( source_list* sources = sources_.find(id) ) {
+                const source_link& l = sources->back();
+                const entity_id source = l.source;
+                erase_target_(source, l.target_index);
+                erase_source_(id, sources->size() - 1u);
+                release_empty_(source, targets_);
+                release_empty_(id, sources_);
+                ++removed_count;
+            }
+            count_ -= removed_count;
+            return removed_count;
+        }
+
+        bool exists(entity_id source) const noexcept {
+            std::shared_lock lock(relations_locker_);
+            return targets_.has(source);
+        }
+
+        bool exists(entity_id source, entity_id target) const noexcept {
+            return find(source, target) != nullptr;
+        }
+
+        R* find(entity_id source, entity_id target) noexcept {
+            std::unique_lock lock(relations_locker_);
+            return find_(source, target);
+        }
+
+        const R* find(entity_id source, entity_id target) const noexcept {
+            std::shared_lock lock(relations_locker_);
+            return const_cast<relation_storage*>(this)->find_(source, target);
+        }
+
+        std::size_t count() const noexcept override {
+            std::shared_lock lock(relations_locker_);
+            return count_;
+        }
+
+        std::size_t target_count(entity_id source) const noexcept {
+            std::shared_lock lock(relations_locker_);
+            const target_list* targets = targets_.find(source);
+            return targets ? targets->size() : 0u;
+        }
+
+        std::size_t source_count(entity_id target) const noexcept {
+            std::shared_lock lock(relations_locker_);
+            const source_list* sources = sources_.find(target);
+            return sources ? sources->size() : 0u;
+        }
+
+        template < typename F >
+        void for_each_target(entity_id source, F&& f) {
+            std::unique_lock lock(relations_locker_);
+            if ( target_list* targets = targets_.find(source) ) {
+                for ( auto& l : *targets ) {
+                    f(l.target, l.value);
+                }
+            }
+        }
+
+        template < typename F >
+        void for_each_target(entity_id source, F&& f) const {
+            std::shared_lock lock(relations_locker_);
+            if ( const target_list* targets = targets_.find(source) ) {
+                for ( const auto& l : *targets ) {
+                    f(l.target, l.value);
+                }
+            }
+        }
+
+        template < typename F >
+        void for_each_source(entity_id target, F&& f) {
+            std::unique_lock lock(relations_locker_);
+            if ( const source_list* sources = sources_.find(target) ) {
+                for ( const source_link& l : *sources ) {
+                    f(l.source, targets_.get(l.source)[l.target_index].value);
+                }
+            }
+        }
+
+        template < typename F >
+        void for_each_source(entity_id target, F&& f) const {
+            std::shared_lock lock(relations_locker_);
+            if ( const source_list* sources = sources_.find(target) ) {
+                for ( const source_link& l : *sources ) {
+                    f(l.source, std::as_const(targets_.get(l.source)[l.target_index].value));
+                }
+            }
+        }
+
+        std::size_t memory_usage() const noexcept override {
+            std::shared_lock lock(relations_locker_);
+            std::size_t usage = targets_.memory_usage() + sources_.memory_usage();
+            for ( const entity_id id : targets_ ) {
+                usage += targets_.get(id).capacity() * sizeof(target_link);
+            }
+            for ( const entity_id id : sources_ ) {
+                usage += sources_.get(id).capacity() * sizeof(source_link);
+            }
+            return usage;
+        }
+    private:
+        struct target_link {
+            entity_id target{0u};
+            std::size_t source_index{0u};
+            R value;
+        };
+
+        struct source_link {
+            entity_id source{0u};
+            std::size_t target_index{0u};
+        };
+
+        using target_list = std::vector<target_link>;
+        using source_list = std::vector<source_link>;
+
+        R* find_(entity_id source, entity_id target) noexcept {
+            if ( target_list* targets = targets_.find(source) ) {
+                for ( auto& l : *targets ) {
+                    if ( l.target == target ) {
+                        return &l.value;
+                    }
+                }
+            }
+            return nullptr;
+        }
+
+        // swap-and-pop, the moved link is back-patched in its peer list
+        void erase_target_(entity_id source, std::size_t index) noexcept {
+            target_list& targets = targets_.get(source);
+            if ( index != targets.size() - 1u ) {
+                targets[index] = std::move(targets.back());
+                const target_link& moved = targets[index];
+                sources_.get(moved.target)[moved.source_index].target_index = index;
+            }
+            targets.pop_back();
+        }
+
+        void erase_source_(entity_id target, std::size_t index) noexcept {
+            source_list& sources = sources_.get(target);
+            if ( index != sources.size() - 1u ) {
+                sources[index] = sources.back();
+                const source_link& moved = sources[index];
+                targets_.get(moved.source)[moved.target_index].source_index = index;
+            }
+            sources.pop_back();
+        }
+
+        template < typename List >
+        static void release_empty_(
+            entity_id id,
+            sparse_map<entity_id, List, entity_id_indexer>& lists) noexcept
+        {
+            const List* list = lists.find(id);
+            if ( list && list->empty() ) {
+                lists.unordered_erase(id);
+            }
+        }
+    private:
+        mutable std::shared_mutex relations_locker_;
+        sparse_map<entity_id, target_list, entity_id_indexer> targets_;
+        sparse_map<entity_id, source_list, entity_id_indexer> sources_;
+        std::size_t count_{0u};
+    };
+}
+
+// -----------------------------------------------------------------------------
+//
+// detail::shared_storage
+//
+// -----------------------------------------------------------------------------
+
+namespace ecs_hpp
+{
+    //
+    // shared_component_hash
+    //
+    // Shared values are interned by hash and operator==, specialize it
+    // for types without a std::hash specialization:
+    //
+    // template <>
+    // struct ecs_hpp::shared_component_hash<mesh> {
+    //     std::size_t operator()(const mesh& m) const noexcept;
+    // };
+    //
+
+    template < typename T >
+    struct shared_component_hash : std::hash<T> {};
+}
+
+namespace ecs_hpp::detail
+{
+    class shared_storage_base {
+    public:
+        virtual ~shared_storage_base() = default;
+        virtual bool remove(entity_id id) noexcept = 0;
+        virtual bool has(entity_id id) const noexcept = 0;
+        virtual void clone(entity_id from, entity_id to) = 0;
+        virtual void capture(entity_id id, compiled_prototype& compiled) const = 0;
+        virtual std::size_t count() const noexcept = 0;
+        virtual std::size_t memory_usage() const noexcept = 0;
+    };
+
+    // entities with equal values share one group, groups are indexed
+    // by the value hash and values are never mutated in place,
+    // each group is a separate node, so a value keeps its address
+    // while any entity still shares it
+    template < typename T >
+    class shared_storage final : public shared_storage_base {
+    public:
+        shared_storage() = default;
+
+        explicit shared_storage(std::pmr::memory_resource* resource)
+        : groups_(resource)
+        , index_(resource)
+        , members_(resource) {}
+
+        ~shared_storage() noexcept override {
+            for ( group* g : groups_ ) {
+                destroy_group_(g);
+            }
+        }
+
+        template < typename... Args >
+        const T& assign(entity_id id, Args&&... args) {
+            T value{std::forward<Args>(args)...};
+            std::unique_lock lock(shared_locker_);
+            return assign_(id, std::move(value))->value;
+        }
+
+        void fill(const entity_id* ids, std::size_t count, const T& value) {
+            if ( !count ) {
+                return;
+            }
+            std::unique_lock lock(shared_locker_);
+            const std::size_t hash = shared_component_hash<T>{}(value);
+            group* g = find_group_(hash, value);
+            std::size_t i = 0u;
+            if ( !g ) {
+                g = join_new_(ids[i++], hash, T(value));
+            }
+            for ( ; i < count; ++i ) {
+                join_(ids[i], g);
+            }
+        }
+
+        template < typename F >
+        const T* patch(entity_id id, F&& f) {
+            std::unique_lock lock(shared_locker_);
+            const member* m = members_.find(id);
+            if ( !m ) {
+                return nullptr;
+            }
+            T value = m->owner->value;
+            f(value);
+            return &assign_(id, std::move(value))->value;
+        }
+
+        bool remove(entity_id id) noexcept override {
+            std::unique_lock lock(shared_locker_);
+            const member* m = members_.find(id);
+            if ( !m ) {
+                return false;
+            }
+            const member old = *m;
+            members_.unordered_erase(id);
+            leave_(old);
+            return true;
+        }
+
+        bool has(entity_id id) const noexcept override {
+            std::shared_lock lock(shared_locker_);
+            return members_.has(id);
+        }
+
+        const T* find(entity_id id) const noexcept {
+            std::shared_lock lock(shared_locker_);
+            const member* m = members_.find(id);
+            return m ? &m->owner->value : nullptr;
+        }
+
+        void clone(entity_id from, entity_id to) override {
+            std::unique_lock lock(shared_locker_);
+            if ( const member* m = members_.find(from) ) {
+                join_(to, m->owner);
+            }
+        }
+
+        void capture(entity_id id, compiled_prototype& compiled) const override;
+
+        std::size_t count() const noexcept override {
+            std::shared_lock lock(shared_locker_);
+            return members_.size();
+        }
+
+        std::size_t group_count() const noexcept {
+            std::shared_lock lock(shared_locker_);
+            return groups_.size();
+        }
+
+        template < typename F >
+        void for_each_component(F&& f) {
+            std::unique_lock lock(shared_locker_);
+            for ( const group* g : groups_ ) {
+                for ( const entity_id id : g->entities ) {
+                    f(id, g->value);
+                }
+            }
+        }
+
+        template < typename F >
+        void for_each_component(F&& f) const {
+            std::shared_lock lock(shared_locker_);
+            for ( const group* g : groups_ ) {
+                for ( const entity_id id : g->entities ) {
+                    f(id, g->value);
+                }
+            }
+        }
+
+        std::size_t memory_usage() const noexcept override {
+            std::shared_lock lock(shared_locker_);
+            std::size_t usage = members_.memory_usage();
+            usage += groups_.capacity() * sizeof(group*);
+            usage += index_.bucket_count() * sizeof(void*);
+            usage += index_.size() * (sizeof(typename index_map::value_type) + sizeof(void*));
+            for ( const group* g : groups_ ) {
+                usage += sizeof(group);
+                usage += g->entities.capacity() * sizeof(entity_id);
+            }
+            return usage;
+        }
+    private:
+        // the entities of a group are its references,
+        // the last one to leave destroys the group
+        struct group {
+            T value;
+            resource_vector<entity_id> entities;
+            std::size_t hash{0u};
+            std::size_t position{0u};
+        };
+
+        struct member {
+            group* owner{nullptr};
+            std::size_t index{0u};
+        };
+
+        using index_map = std::pmr::unordered_multimap<std::size_t, group*>;
+
+        group* assign_(entity_id id, T&& value) {
+            const std::size_t hash = shared_component_hash<T>{}(value);
+            if ( group* g = find_group_(hash, value) ) {
+                join_(id, g);
+                return g;
+            }
+            return join_new_(id, hash, std::move(value));
+        }
+
+        group* find_group_(std::size_t hash, const T& value) const {
+            static_assert(
+                std::is_invocable_r_v<std::size_t, shared_component_hash<T>, const T&>,
+                "ecs_hpp::shared_storage (shared components must be hashable by shared_component_hash)");
+            const auto range = index_.equal_range(hash);
+            for ( auto iter = range.first; iter != range.second; ++iter ) {
+                if ( iter->second->value == value ) {
+                    return iter->second;
+                }
+            }
+            return nullptr;
+        }
+
+        group* create_group_(std::size_t hash, T&& value) {
+            resource_allocator<group> allocator(groups_.get_allocator());
+            group* g = allocator.allocate(1u);
+            ECS_HPP_TRY {
+                new (g) group{
+                    std::move(value),
+                    resource_vector<entity_id>(allocator),
+                    hash,
+                    groups_.size()};
+            } ECS_HPP_CATCH_ALL {
+                allocator.deallocate(g, 1u);
+                ECS_HPP_RETHROW;
+            }
+            return g;
+        }
+
+        void destroy_group_(group* g) noexcept {
+            resource_allocator<group> allocator(groups_.get_allocator());
+            g->~group();
+            allocator.deallocate(g, 1u);
+        }
+
+        group* join_new_(entity_id id, std::size_t hash, T&& value) {
+            group* g = create_group_(hash, std::move(value));
+            ECS_HPP_TRY {
+                groups_.push_back(g);
+            } ECS_HPP_CATCH_ALL {
+                destroy_group_(g);
+                ECS_HPP_RETHROW;
+            }
+            ECS_HPP_TRY {
+                const auto iter = index_.emplace(hash, g);
+                ECS_HPP_TRY {
+                    join_(id, g);
+                } ECS_HPP_CATCH_ALL {
+                    index_.erase(iter);
+                    ECS_HPP_RETHROW;
+                }
+            } ECS_HPP_CATCH_ALL {
+                groups_.pop_back();
+                destroy_group_(g);
+                ECS_HPP_RETHROW;
+            }
+            return g;
+        }
+
+        void join_(entity_id id, group* g) {
+            const member* m = members_.find(id);
+            if ( m && m->owner == g ) {
+                return;
+            }
+            const bool joined = m != nullptr;
+            const member old = joined ? *m : member{};
+            g->entities.push_back(id);
+            ECS_HPP_TRY {
+                members_.insert_or_assign(id, member{g, g->entities.size() - 1u});
+            } ECS_HPP_CATCH_ALL {
+                g->entities.pop_back();
+                ECS_HPP_RETHROW;
+            }
+            if ( joined ) {
+                leave_(old);
+            }
+        }
+
+        typename index_map::iterator find_index_(group* g) noexcept {
+            const auto range = index_.equal_range(g->hash);
+            for ( auto iter = range.first; iter != range.second; ++iter ) {
+                if ( iter->second == g ) {
+                    return iter;
+                }
+            }
+            assert(false && "ecs_hpp::shared_storage (unindexed group)");
+            return index_.end();
+        }
+
+        void leave_(const member& old) noexcept {
+            group* g = old.owner;
+            if ( old.index != g->entities.size() - 1u ) {
+                g->entities[old.index] = g->entities.back();
+                members_.get(g->entities[old.index]).index = old.index;
+            }
+            g->entities.pop_back();
+            if ( !g->entities.empty() ) {
+                return;
+            }
+            index_.erase(find_index_(g));
+            if ( g->position != groups_.size() - 1u ) {
+                groups_[g->position] = groups_.back();
+                groups_[g->position]->position = g->position;
+            }
+            groups_.pop_back();
+            destroy_group_(g);
+        }
+    private:
+        mutable std::shared_mutex shared_locker_;
+        resource_vector<group*> groups_;
+        index_map index_;
+        sparse_map<entity_id, member, entity_id_indexer> members_;
+    };
+}
+
+// -----------------------------------------------------------------------------
+//
+// detail::transient_storage
+//
+// -----------------------------------------------------------------------------
+
+namespace ecs_hpp::detail
+{
+    class transient_storage_base {
+    public:
+        virtual ~transient_storage_base() = default;
+        virtual bool remove(entity_id id) noexcept = 0;
+        virtual bool has(entity_id id) const noexcept = 0;
+        virtual void clear() noexcept = 0;
+        virtual std::size_t count() const noexcept = 0;
+        virtual std::size_t memory_usage() const noexcept = 0;
+    };
+
+    // clear is O(1): the dense arrays keep their capacity and
+    // sparse slots of the previous frames fail the generation check
+    template < typename T >
+    class transient_storage final : public transient_storage_base {
+        static_assert(
+            std::is_trivially_destructible_v<T>,
+            "ecs_hpp::transient_storage (transient components must be trivially destructible)");
+    public:
+        transient_storage() = default;
+
+        explicit transient_storage(std::pmr::memory_resource* resource)
+        : slots_(resource)
+        , ids_(resource)
+        , values_(resource) {}
+
+        template < typename... Args >
+        T& assign(entity_id id, Args&&... args) {
+            std::unique_lock lock(transient_locker_);
+            if ( T* value = find_(id) ) {
+                *value = T{std::forward<Args>(args)...};
+                return *value;
+            }
+            const std::size_t index = entity_id_index(id);
+            if ( index >= slots_.size() ) {
+                slots_.resize(next_capacity_size(
+                    slots_.size(), index + 1u, slots_.max_size()));
+            }
+            if ( ids_.size() == ids_.capacity() ) {
+                ids_.reserve(next_capacity_size(
+                    ids_.capacity(), ids_.size() + 1u, ids_.max_size()));
+            }
+            values_.push_back(T{std::forward<Args>(args)...});
+            ids_.push_back(id);
+            slots_[index] = {generation_, ids_.size() - 1u};
+            return values_.back();
+        }
+
+        bool remove(entity_id id) noexcept override {
+            std::unique_lock lock(transient_locker_);
+            if ( !find_(id) ) {
+                return false;
+            }
+            const std::size_t dense_index = slots_[entity_id_index(id)].index;
+            if ( dense_index != ids_.size() - 1u ) {
+                values_[dense_index] = std::move(values_.back());
+                ids_[dense_index] = ids_.back();
+                slots_[entity_id_index(ids_[dense_index])].index = dense_index;
+            }
+            values_.pop_back();
+            ids_.pop_back();
+            return true;
+        }
+
+        bool has(entity_id id) const noexcept override {
+            std::shared_lock lock(transient_locker_);
+            return find_(id) != nullptr;
+        }
+
+        T* find(entity_id id) noexcept {
+            std::shared_lock lock(transient_locker_);
+            return find_(id);
+        }
+
+        const T* find(entity_id id) const noexcept {
+            std::shared_lock lock(transient_locker_);
+            return find_(id);
+        }
+
+        void clear() noexcept override {
+            std::unique_lock lock(transient_locker_);
+            ids_.clear();
+            values_.clear();
+            if ( ++generation_ == 0u ) {
+                std::fill(slots_.begin(), slots_.end(), slot{});
+                generation_ = 1u;
+            }
+        }
+
+        std::size_t count() const noexcept override {
+            std::shared_lock lock(transient_locker_);
+            return ids_.size();
+        }
+
+        template < typename F >
+        void for_each_component(F&& f) {
+            std::unique_lock lock(transient_locker_);
+            for ( std::size_t i = 0; i < ids_.size(); ++i ) {
+                f(ids_[i], values_[i]);
+            }
+        }
+
+        template < typename F >
+        void for_each_component(F&& f) const {
+            std::shared_lock lock(transient_locker_);
+            for ( std::size_t i = 0; i < ids_.size(); ++i ) {
+                f(ids_[i], values_[i]);
+            }
+        }
+
+        std::size_t memory_usage() const noexcept override {
+            std::shared_lock lock(transient_locker_);
+            return slots_.capacity() * sizeof(slots_[0])
+                + ids_.capacity() * sizeof(ids_[0])
+                + values_.capacity() * sizeof(values_[0]);
+        }
+    private:
+        struct slot {
+            std::size_t generation{0u};
+            std::size_t index{0u};
+        };
+
+        T* find_(entity_id id) const noexcept {
+            const std::size_t index = entity_id_index(id);
+            if ( index >= slots_.size() ) {
+                return nullptr;
+            }
+            const slot& s = slots_[index];
+            return s.generation == generation_ && s.index < ids_.size() && ids_[s.index] == id
+                ? const_cast<T*>(&values_[s.index])
+                : nullptr;
+        }
+    private:
+        mutable std::shared_mutex transient_locker_;
+        std::size_t generation_{1u};
+        resource_vector<slot> slots_;
+        resource_vector<entity_id> ids_;
+        resource_vector<T> values_;
+    };
+}
+
+// -----------------------------------------------------------------------------
+//
+// detail::buffered_storage
+//
+// -----------------------------------------------------------------------------
+
+namespace ecs_hpp::detail
+{
+    class buffered_storage_base {
+    public:
+        virtual ~buffered_storage_base() = default;
+        virtual bool remove(entity_id id) noexcept = 0;
+        virtual bool has(entity_id id) const noexcept = 0;
+        virtual std::size_t count() const noexcept = 0;
+        virtual void clone(entity_id from, entity_id to) = 0;
+        virtual std::size_t memory_usage() const noexcept = 0;
+    };
+
+    // readers see the front (previous) values and writers fill the back (next) ones,
+    // structural changes write both buffers and a swap carries the new values forward
+    template < typename T >
+    class buffered_storage final : public buffered_storage_base {
+    public:
+        buffered_storage() = default;
+
+        explicit buffered_storage(std::pmr::memory_resource* resource)
+        : ids_(resource)
+        , front_(resource)
+        , back_(resource) {}
+
+        template < typename... Args >
+        T& assign(entity_id id, Args&&... args) {
+            std::unique_lock lock(buffered_locker_);
+            T value{std::forward<Args>(args)...};
+            if ( const auto p = ids_.find_dense_index(id); p.second ) {
+                front_[p.first] = value;
+                back_[p.first] = std::move(value);
+                return back_[p.first];
+            }
+            T prev = value;
+            insert_(id, std::move(prev), std::move(value));
+            return back_.back();
+        }
+
+        bool remove(entity_id id) noexcept override {
+            std::unique_lock lock(buffered_locker_);
+            const auto p = ids_.find_dense_index(id);
+            if ( !p.second ) {
+                return false;
+            }
+            if ( p.first != front_.size() - 1u ) {
+                front_[p.first] = std::move(front_.back());
+                back_[p.first] = std::move(back_.back());
+            }
+            front_.pop_back();
+            back_.pop_back();
+            ids_.unordered_erase(id);
+            return true;
+        }
+
+        bool has(entity_id id) const noexcept override {
+            std::shared_lock lock(buffered_locker_);
+            return ids_.has(id);
+        }
+
+        const T* find_previous(entity_id id) const noexcept {
+            std::shared_lock lock(buffered_locker_);
+            const auto p = ids_.find_dense_index(id);
+            return p.second ? &front_[p.first] : nullptr;
+        }
+
+        // writers of different entities do not exclude each other
+        T* find_next(entity_id id) noexcept {
+            std::shared_lock lock(buffered_locker_);
+            const auto p = ids_.find_dense_index(id);
+            return p.second ? &back_[p.first] : nullptr;
+        }
+
+        // values that were not written this frame stay as they were
+        void swap_buffers() noexcept(std::is_nothrow_copy_assignable_v<T>) {
+            std::unique_lock lock(buffered_locker_);
+            front_.swap(back_);
+            std::copy(front_.begin(), front_.end(), back_.begin());
+        }
+
+        void clone(entity_id from, entity_id to) override {
+            std::unique_lock lock(buffered_locker_);
+            const auto p = ids_.find_dense_index(from);
+            if ( !p.second || ids_.has(to) ) {
+                return;
+            }
+            T prev = front_[p.first];
+            T next = back_[p.first];
+            insert_(to, std::move(prev), std::move(next));
+        }
+
+        std::size_t count() const noexcept override {
+            std::shared_lock lock(buffered_locker_);
+            return ids_.size();
+        }
+
+        template < typename F >
+        void for_each_component(F&& f) {
+            std::shared_lock lock(buffered_locker_);
+            for ( std::size_t i = 0; i < ids_.size(); ++i ) {
+                f(ids_.data()[i], std::as_const(front_[i]), back_[i]);
+            }
+        }
+
+        template < typename F >
+        void for_each_component(F&& f) const {
+            std::shared_lock lock(buffered_locker_);
+            for ( std::size_t i = 0; i < ids_.size(); ++i ) {
+                f(ids_.data()[i], front_[i]);
+            }
+        }
+
+        std::size_t memory_usage() const noexcept override {
+            std::shared_lock lock(buffered_locker_);
+            return ids_.memory_usage()
+                + front_.capacity() * sizeof(T)
+                + back_.capacity() * sizeof(T);
+        }
+    private:
+        void insert_(entity_id id, T&& prev, T&& next) {
+            if ( front_.size() == front_.capacity() ) {
+                const std::size_t capacity = next_capacity_size(
+                    front_.capacity(), front_.size() + 1u, front_.max_size());
+                front_.reserve(capacity);
+                back_.reserve(capacity);
+            }
+            front_.push_back(std::move(prev));
+            ECS_HPP_TRY {
+                back_.push_back(std::move(next));
+            } ECS_HPP_CATCH_ALL {
+                front_.pop_back();
+                ECS_HPP_RETHROW;
+            }
+            ECS_HPP_TRY {
+                ids_.insert(id);
+            } ECS_HPP_CATCH_ALL {
+                front_.pop_back();
+                back_.pop_back();
+                ECS_HPP_RETHROW;
+            }
+        }
+    private:
+        mutable std::shared_mutex buffered_locker_;
+        sparse_set<entity_id, entity_id_indexer> ids_;
+        resource_vector<T> front_;
+        resource_vector<T> back_;
+    };
+}
+
+// -----------------------------------------------------------------------------
+//
+// detail::update_schedule
+//
+// -----------------------------------------------------------------------------
+
+namespace ecs_hpp::detail
+{
+    // entities are spread over `period` phase buckets,
+    // a bucket is due on frames where frame % period == phase
+    class update_schedule final {
+    public:
+        update_schedule() = default;
+
+        explicit update_schedule(std::pmr::memory_resource* resource)
+        : resource_(resource)
+        , entries_(resource)
+        , periods_(resource) {}
+
+        // phase buckets are allocated eagerly, so periods should stay small
+        void assign(entity_id id, std::uint32_t period) {
+            assert(period > 0u);
+            if ( const entry* e = entries_.find(id); e && e->period == period ) {
+                return;
+            }
+            remove(id);
+            auto iter = std::find_if(periods_.begin(), periods_.end(), [period](const buckets& b){
+                return b.period == period;
+            });
+            if ( iter == periods_.end() ) {
+                buckets b{period, resource_vector<ids_t>(resource_)};
+                b.phases.reserve(period);
+                for ( std::uint32_t i = 0; i < period; ++i ) {
+                    b.phases.emplace_back(resource_);
+                }
+                periods_.push_back(std::move(b));
+                iter = std::prev(periods_.end());
+            }
+            const auto phase = std::min_element(iter->phases.begin(), iter->phases.end(), [](const ids_t& l, const ids_t& r){
+                return l.size() < r.size();
+            });
+            phase->insert(id);
+            ECS_HPP_TRY {
+                entries_.insert(id, entry{period, static_cast<std::uint32_t>(phase - iter->phases.begin())});
+            } ECS_HPP_CATCH_ALL {
+                phase->unordered_erase(id);
+                ECS_HPP_RETHROW;
+            }
+        }
+
+        bool remove(entity_id id) noexcept {
+            const entry* e = entries_.find(id);
+            if ( !e ) {
+                return false;
+            }
+            for ( buckets& b : periods_ ) {
+                if ( b.period == e->period ) {
+                    b.phases[e->phase].unordered_erase(id);
+                    break;
+                }
+            }
+            entries_.unordered_erase(id);
+            return true;
+        }
+
+        std::uint32_t period(entity_id id) const noexcept {
+            const entry* e = entries_.find(id);
+            return e ? e->period : 0u;
+        }
+
+        // callbacks must not change the schedule
+        template < typename F >
+        void for_each_due(std::uint64_t frame, F&& f) const {
+            for ( const buckets& b : periods_ ) {
+                for ( const entity_id id : b.phases[static_cast<std::size_t>(frame % b.period)] ) {
+                    f(id);
+                }
+            }
+        }
+
+        std::size_t size() const noexcept {
+            return entries_.size();
+        }
+
+        std::size_t memory_usage() const noexcept {
+            std::size_t usage = entries_.memory_usage()
+                + periods_.capacity() * sizeof(buckets);
+            for ( const buckets& b : periods_ ) {
+                usage += b.phases.capacity() * sizeof(ids_t);
+                for ( const ids_t& ids : b.phases ) {
+                    usage += ids.memory_usage();
+                }
+            }
+            return usage;
+        }
+    private:
+        using ids_t = sparse_set<entity_id, entity_id_indexer>;
+
+        struct entry {
+            std::uint32_t period{0u};
+            std::uint32_t phase{0u};
+        };
+
+        struct buckets {
+            std::uint32_t period{0u};
+            resource_vector<ids_t> phases;
+        };
+    private:
+        std::pmr::memory_resource* resource_{std::pmr::get_default_resource()};
+        sparse_map<entity_id, entry, entity_id_indexer> entries_;
+        resource_vector<buckets> periods_;
+    };
+}
+
+// -----------------------------------------------------------------------------
+//
+// entity
+//
+// -----------------------------------------------------------------------------
+
+namespace ecs_hpp
+{
+    class entity final {
+    public:
+        explicit entity(registry& owner) noexcept;
+        entity(registry& owner, entity_id id) noexcept;
+
+        entity(const entity&) = default;
+        entity& operator=(const entity&) = default;
+
+        entity(entity&&) noexcept = default;
+        entity& operator=(entity&&) noexcept = default;
+
+        registry& owner() noexcept;
+        const registry& owner() const noexcept;
+
+        entity_id id() const noexcept;
+
+        entity clone() const;
+        void destroy() noexcept;
+        bool valid() const noexcept;
+
+        template < typename T, typename... Args >
+        T& assign_component(Args&&... args);
+
+        template < typename T, typename... Args >
+        T& ensure_component(Args&&... args);
+
+        template < typename T >
+        bool remove_component() noexcept;
+
+        template < typename T >
+        bool exists_component() const noexcept;
+
+        std::size_t remove_all_components() noexcept;
+
+        template < typename T >
+        T& get_component();
+
+        template < typename T >
+        const T& get_component() const;
+
+        template < typename T >
+        T* find_component() noexcept;
+
+        template < typename T >
+        const T* find_component() const noexcept;
+
+        template < typename... Ts >
+        std::tuple<Ts&...> get_components();
+        template < typename... Ts >
+        std::tuple<const Ts&...> get_components() const;
+
+        template < typename... Ts >
+        std::tuple<Ts*...> find_components() noexcept;
+        template < typename... Ts >
+        std::tuple<const Ts*...> find_components() const noexcept;
+
+        std::size_t component_count() const noexcept;
+    private:
+        registry* owner_{nullptr};
+        entity_id id_{0u};
+    };
+
+    bool operator<(const entity& l, const entity& r) noexcept;
+
+    bool operator==(const entity& l, const entity& r) noexcept;
+    bool operator==(const entity& l, const const_entity& r) noexcept;
+
+    bool operator!=(const entity& l, const entity& r) noexcept;
+    bool operator!=(const entity& l, const const_entity& r) noexcept;
+}
+
+namespace std
+{
+    template <>
+    struct hash<ecs_hpp::entity> final {
+        std::size_t operator()(const ecs_hpp::entity& ent) const noexcept {
+            return ecs_hpp::detail::hash_combine(
+                std::hash<const ecs_hpp::registry*>()(&ent.owner()),
+                std::hash<ecs_hpp::entity_id>()(ent.id()));
+        }
+    };
+}
+
+// -----------------------------------------------------------------------------
+//
+// const_entity
+//
+// -----------------------------------------------------------------------------
+
+namespace ecs_hpp
+{
+    class const_entity final {
+    public:
+        const_entity(const entity& ent) noexcept;
+
+        explicit const_entity(const registry& owner) noexcept;
+        const_entity(const registry& owner, entity_id id) noexcept;
+
+        const_entity(const const_entity&) = default;
+        const_entity& operator=(const const_entity&) = default;
+
+        const_entity(const_entity&&) noexcept = default;
+        const_entity& operator=(const_entity&&) noexcept = default;
+
+        const registry& owner() const noexcept;
+        entity_id id() const noexcept;
+
+        bool valid() const noexcept;
+
+        template < typename T >
+        bool exists_component() const noexcept;
+
+        template < typename T >
+        const T& get_component() const;
+
+        template < typename T >
+        const T* find_component() const noexcept;
+
+        template < typename... Ts >
+        std::tuple<const Ts&...> get_components() const;
+
+        template < typename... Ts >
+        std::tuple<const Ts*...> find_components() const noexcept;
+
+        std::size_t component_count() const noexcept;
+    private:
+        const registry* owner_{nullptr};
+        entity_id id_{0u};
+    };
+
+    bool operator<(const const_entity& l, const const_entity& r) noexcept;
+
+    bool operator==(const const_entity& l, const entity& r) noexcept;
+    bool operator==(const const_entity& l, const const_entity& r) noexcept;
+
+    bool operator!=(const const_entity& l, const entity& r) noexcept;
+    bool operator!=(const const_entity& l, const const_entity& r) noexcept;
+}
+
+namespace std
+{
+    template <>
+    struct hash<ecs_hpp::const_entity> final {
+        std::size_t operator()(const ecs_hpp::const_entity& ent) const noexcept {
+            return ecs_hpp::detail::hash_combine(
+                std::hash<const ecs_hpp::registry*>()(&ent.owner()),
+                std::hash<ecs_hpp::entity_id>()(ent.id()));
+        }
+    };
+}
+
+// -----------------------------------------------------------------------------
+//
+// component
+//
+// -----------------------------------------------------------------------------
+
+namespace ecs_hpp
+{
+    template < typename T >
+    class component final {
+    public:
+        explicit component(const entity& owner) noexcept;
+
+        component(const component&) = default;
+        component& operator=(const component&) = default;
+
+        component(component&&) noexcept = default;
+        component& operator=(component&&) noexcept = default;
+
+        entity& owner() noexcept;
+        const entity& owner() const noexcept;
+
+        bool valid() const noexcept;
+        bool exists() const noexcept;
+
+        template < typename... Args >
+        T& assign(Args&&... args);
+
+        template < typename... Args >
+        T& ensure(Args&&... args);
+
+        bool remove() noexcept;
+
+        T& get();
+        const T& get() const;
+
+        T* find() noexcept;
+        const T* find() const noexcept;
+
+        T& operator*();
+        const T& operator*() const;
+
+        T* operator->() noexcept;
+        const T* operator->() const noexcept;
+
+        explicit operator bool() const noexcept;
+    private:
+        entity owner_;
+    };
+
+    template < typename T >
+    bool operator<(const component<T>& l, const component<T>& r) noexcept;
+
+    template < typename T >
+    bool operator==(const component<T>& l, const component<T>& r) noexcept;
+    template < typename T >
+    bool operator==(const component<T>& l, const const_component<T>& r) noexcept;
+
+    template < typename T >
+    bool operator!=(const component<T>& l, const component<T>& r) noexcept;
+    template < typename T >
+    bool operator!=(const component<T>& l, const const_component<T>& r) noexcept;
+}
+
+namespace std
+{
+    template < typename T >
+    struct hash<ecs_hpp::component<T>> {
+        std::size_t operator()(const ecs_hpp::component<T>& comp) const noexcept {
+            return std::hash<ecs_hpp::entity>()(comp.owner());
+        }
+    };
+}
+
+// -----------------------------------------------------------------------------
+//
+// const_component
+//
+// -----------------------------------------------------------------------------
+
+namespace ecs_hpp
+{
+    template < typename T >
+    class const_component final {
+    public:
+        const_component(const component<T>& comp) noexcept;
+        explicit const_component(const const_entity& owner) noexcept;
+
+        const_component(const const_component&) = default;
+        const_component& operator=(const const_component&) = default;
+
+        const_component(const_component&&) noexcept = default;
+        const_component& operator=(const_component&&) noexcept = default;
+
+        const const_entity& owner() const noexcept;
+
+        bool valid() const noexcept;
+        bool exists() const noexcept;
+
+        const T& get() const;
+        const T* find() const noexcept;
+
+        const T& operator*() const;
+        const T* operator->() const noexcept;
+        explicit operator bool() const noexcept;
+    private:
+        const_entity owner_;
+    };
+
+    template < typename T >
+    bool operator<(const const_component<T>& l, const const_component<T>& r) noexcept;
+
+    template < typename T >
+    bool operator==(const const_component<T>& l, const component<T>& r) noexcept;
+    template < typename T >
+    bool operator==(const const_component<T>& l, const const_component<T>& r) noexcept;
+
+    template < typename T >
+    bool operator!=(const const_component<T>& l, const component<T>& r) noexcept;
+    template < typename T >
+    bool operator!=(const const_component<T>& l, const const_component<T>& r) noexcept;
+}
+
+namespace std
+{
+    template < typename T >
+    struct hash<ecs_hpp::const_component<T>> {
+        std::size_t operator()(const ecs_hpp::const_component<T>& comp) const noexcept {
+            return std::hash<ecs_hpp::const_entity>()(comp.owner());
+        }
+    };
+}
+
+// -----------------------------------------------------------------------------
+//
+// prototype
+//
+// -----------------------------------------------------------------------------
+
+namespace ecs_hpp
+{
+    namespace detail
+    {
+        class applier_base;
+        using applier_sptr = std::shared_ptr<const applier_base>;
+
+        class applier_base {
+        public:
+            virtual ~applier_base() = default;
+            virtual void apply_to_entity(entity& ent, bool override) const = 0;
+            virtual void compile_to(compiled_prototype& compiled) const = 0;
+        };
+
+        template < typename T >
+        class typed_applier : public applier_base {
+        public:
+            virtual void apply_to_component(T& component) const = 0;
+        };
+
+        template < typename T, typename... Args >
+        class typed_applier_with_args final : public typed_applier<T> {
+        public:
+            typed_applier_with_args(std::tuple<Args...>&& args);
+            typed_applier_with_args(const std::tuple<Args...>& args);
+            void apply_to_entity(entity& ent, bool override) const override;
+            void compile_to(compiled_prototype& compiled) const override;
+            void apply_to_component(T& component) const override;
+        private:
+            std::tuple<Args...> args_;
+        };
+
+        template < typename T >
+        struct shared_applier_tag {};
+
+        template < typename T >
+        class shared_applier final : public applier_base {
+        public:
+            shared_applier(T value);
+            void apply_to_entity(entity& ent, bool override) const override;
+            void compile_to(compiled_prototype& compiled) const override;
+        private:
+            T value_;
+        };
+    }
+
+    class prototype final {
+    public:
+        prototype() = default;
+        ~prototype() noexcept = default;
+
+        explicit prototype(std::shared_ptr<const prototype> parent);
+        explicit prototype(std::pmr::memory_resource* resource);
+
+        prototype(const prototype& other);
+        prototype& operator=(const prototype& other);
+
+        prototype(prototype&& other) noexcept;
+        prototype& operator=(prototype&& other) noexcept;
+
+        void clear() noexcept;
+        bool empty() const noexcept;
+        void swap(prototype& other) noexcept;
+
+        const std::shared_ptr<const prototype>& parent() const noexcept;
+        std::pmr::memory_resource* resource() const noexcept;
+
+        prototype& inherit(std::shared_ptr<const prototype> parent) &;
+        prototype&& inherit(std::shared_ptr<const prototype> parent) &&;
+
+        template < typename T >
+        bool has_component() const noexcept;
+
+        template < typename T, typename... Args >
+        prototype& component(Args&&... args) &;
+        template < typename T, typename... Args >
+        prototype&& component(Args&&... args) &&;
+
+        template < typename T >
+        bool has_shared_component() const noexcept;
+
+        template < typename T, typename... Args >
+        prototype& shared_component(Args&&... args) &;
+        template < typename T, typename... Args >
+        prototype&& shared_component(Args&&... args) &&;
+
+        prototype& merge_with(const prototype& other, bool override) &;
+        prototype&& merge_with(const prototype& other, bool override) &&;
+
+        template < typename T >
+        bool apply_to_component(T& component) const;
+        void apply_to_entity(entity& ent, bool override) const;
+
+        compiled_prototype compile(registry& owner) const;
+
+        static compiled_prototype capture(entity source);
+        static compiled_prototype capture(registry& owner, const const_entity& source);
+    private:
+        using applier_map = detail::sparse_map<family_id, detail::applier_sptr>;
+
+        const applier_map& resolved_appliers_() const;
+        void reset_resolved_appliers_() noexcept;
+    private:
+        // own overrides only, the parent chain is resolved on demand
+        applier_map appliers_;
+        std::shared_ptr<const prototype> parent_;
+        mutable std::shared_ptr<const applier_map> resolved_appliers_cache_;
+    };
+
+    void swap(prototype& l, prototype& r) noexcept;
+}
+
+// -----------------------------------------------------------------------------
+//
+// compiled_prototype
+//
+// -----------------------------------------------------------------------------
+
+namespace ecs_hpp
+{
+    class compiled_prototype final {
+    public:
+        compiled_prototype(registry& owner) noexcept;
+
+        compiled_prototype(const compiled_prototype& other) = delete;
+        compiled_prototype& operator=(const compiled_prototype& other) = delete;
+
+        compiled_prototype(compiled_prototype&& other) noexcept = default;
+        compiled_prototype& operator=(compiled_prototype&& other) noexcept = default;
+
+        registry& owner() noexcept;
+        const registry& owner() const noexcept;
+
+        bool empty() const noexcept;
+        std::size_t component_count() const noexcept;
+
+        template < typename T, typename... Args >
+        compiled_prototype& component(Args&&... args) &;
+        template < typename T, typename... Args >
+        compiled_prototype&& component(Args&&... args) &&;
+
+        template < typename T, typename... Args >
+        compiled_prototype& shared_component(Args&&... args) &;
+        template < typename T, typename... Args >
+        compiled_prototype&& shared_component(Args&&... args) &&;
+
+        compiled_prototype& capture(const const_entity& source) &;
+        compiled_prototype&& capture(const const_entity& source) &&;
+
+        void apply_to_entity(entity& ent) const;
+        void apply_to_entities(const entity_id* ids, std::size_t count) const;
+    private:
+        using fill_fn = void(*)(void* storage, const entity_id* ids, std::size_t count, const void* value);
+
+        struct entry {
+            void* storage{nullptr};
+            void* value{nullptr};
+            fill_fn fill{nullptr};
+            std::uint64_t signature_bit{0u};
+        };
+
+        // a replaced value is assigned in place, so the arena does not grow
+        template < typename T, typename... Args >
+        bool replace_entry_(const void* storage, Args&&... args);
+        void add_entry_(void* storage, void* value, fill_fn fill, std::uint64_t signature_bit);
+    private:
+        registry* owner_{nullptr};
+        std::vector<entry> entries_;
+        detail::object_arena values_;
+    };
+}
+
+// -----------------------------------------------------------------------------
+//
+// triggers
+//
+// -----------------------------------------------------------------------------
+
+namespace ecs_hpp
+{
+    template < typename E >
+    class after {
+    public:
+        const E& event;
+    };
+
+    template < typename E >
+    class before {
+    public:
+        const E& event;
+    };
+}
+
+// -----------------------------------------------------------------------------
+//
+// system
+//
+// -----------------------------------------------------------------------------
+
+namespace ecs_hpp
+{
+    template <>
+    class system<> {
+    public:
+        virtual ~system() = default;
+    };
+
+    template < typename E >
+    class system<E>
+        : public virtual system<> {
+    public:
+        virtual void process(registry& owner, const E& event) = 0;
+    };
+
+    template < typename E, typename... Es>
+    class system<E, Es...>
+        : public system<E>
+        , public system<Es...> {};
+}
+
+// -----------------------------------------------------------------------------
+//
+// feature
+//
+// -----------------------------------------------------------------------------
+
+namespace ecs_hpp
+{
+    class feature final {
+    public:
+        feature() = default;
+
+        feature(const feature&) = delete;
+        feature& operator=(const feature&) = delete;
+
+        feature(feature && other) noexcept
+        {
+            *this = std::move(other);
+        }
+        feature& operator=(feature&& other) noexcept
+        {
+            std::shared_lock lock(systems_locker_);
+            this->disabled_ = other.disabled_;
+            this->systems_.swap(other.systems_);
+            return *this;
+        }
+
+        feature& enable() & noexcept;
+        feature&& enable() && noexcept;
+
+        feature& disable() & noexcept;
+        feature&& disable() && noexcept;
+
+        bool is_enabled() const noexcept;
+        bool is_disabled() const noexcept;
+
+        template < typename T, typename... Args >
+        feature& add_system(Args&&... args) &;
+        template < typename T, typename... Args >
+        feature&& add_system(Args&&... args) &&;
+
+        template < typename Event >
+        feature& process_event(registry& owner, const Event& event);
+    private:
+        bool disabled_{false};
+        std::vector<std::unique_ptr<system<>>> systems_;
+        mutable std::shared_mutex systems_locker_;
+    };
+}
+
+// -----------------------------------------------------------------------------
+//
+// runtime_query
+//
+// -----------------------------------------------------------------------------
+
+namespace ecs_hpp
+{
+    class runtime_query final {
+    public:
+        runtime_query() = default;
+
+        runtime_query& required(family_id family) &;
+        runtime_query&& required(family_id family) &&;
+
+        runtime_query& excluded(family_id family) &;
+        runtime_query&& excluded(family_id family) &&;
+
+        runtime_query& optional(family_id family) &;
+        runtime_query&& optional(family_id family) &&;
+
+        const std::vector<family_id>& required_families() const noexcept;
+        const std::vector<family_id>& excluded_families() const noexcept;
+        const std::vector<family_id>& optional_families() const noexcept;
+
+        // components are passed to callbacks as required ones first, then optional ones
+        std::size_t component_count() const noexcept;
+    private:
+        std::vector<family_id> required_;
+        std::vector<family_id> excluded_;
+        std::vector<family_id> optional_;
+    };
+}
+
+// -----------------------------------------------------------------------------
+//
+// iteration_cursor
+//
+// -----------------------------------------------------------------------------
+
+namespace ecs_hpp
+{
+    // a cycle visits each entity present at its start at most once,
+    // so storage reordering between slices neither skips nor repeats,
+    // resuming a cycle for another component type starts a new one
+    class iteration_cursor final {
+    public:
+        iteration_cursor() = default;
+
+        bool in_cycle() const noexcept;
+        std::size_t remaining() const noexcept;
+        std::size_t cycle_count() const noexcept;
+
+        void reset() noexcept;
+    private:
+        friend class registry;
+        std::vector<entity_id> ids_;
+        std::size_t position_{0u};
+        std::size_t cycle_count_{0u};
+        family_id family_{0u};
+    };
+}
+
+// -----------------------------------------------------------------------------
+//
+// registry
+//
+// -----------------------------------------------------------------------------
+
+namespace ecs_hpp
+{
+    class registry final {
+    private:
+        friend class compiled_prototype;
+
+        class uentity {
+        public:
+            uentity(registry& owner, entity_id id) noexcept;
+
+            uentity(entity_id ent) noexcept;
+            uentity(entity ent) noexcept;
+
+            operator entity_id() const noexcept;
+            operator entity() const noexcept;
+            operator const_entity() const noexcept;
+
+            entity_id id() const noexcept;
+            registry* owner() noexcept;
+            const registry* owner() const noexcept;
+
+            bool check_owner(const registry* owner) const noexcept;
+        private:
+            entity_id id_{0u};
+            registry* owner_{nullptr};
+        };
+
+        class const_uentity {
+        public:
+            const_uentity(const registry& owner, entity_id id) noexcept;
+
+            const_uentity(entity_id ent) noexcept;
+            const_uentity(entity ent) noexcept;
+            const_uentity(const_entity ent) noexcept;
+            const_uentity(const uentity& ent) noexcept;
+
+            operator entity_id() const noexcept;
+            operator const_entity() const noexcept;
+
+            entity_id id() const noexcept;
+            const registry* owner() const noexcept;
+
+            bool check_owner(const registry* owner) const noexcept;
+        private:
+            entity_id id_{0u};
+            const registry* owner_{nullptr};
+        };
+
+        class mutexes
+        {
+        public:
+            mutable std::shared_mutex entity_ids_locker_;
+            mutable std::shared_mutex features_locker_;
+            mutable std::shared_mutex hierarchy_locker_;
+
+            mutexes() = default;
+            mutexes(const mutexes& other) = delete;
+            mutexes & operator=(const mutexes & other) = delete;
+            mutexes(mutexes && other) noexcept
+            {
+                // Wait until no more usages are pending
+                std::scoped_lock lock(other.entity_ids_locker_, other.features_locker_, other.hierarchy_locker_,
+                                      this->entity_ids_locker_, this->features_locker_, this->hierarchy_locker_);
+            }
+            mutexes & operator=(mutexes && other) noexcept
+            {
+                // Wait until no more usages are pending
+                if ( this != &other ) {
+                    std::scoped_lock lock(other.entity_ids_locker_, other.features_locker_, other.hierarchy_locker_,
+                                          this->entity_ids_locker_, this->features_locker_, this->hierarchy_locker_);
+                }
+                return *this;
+            }
+        };
+    public:
+        registry() = default;
+        explicit registry(std::pmr::memory_resource* resource);
+
+        registry(const registry& other) = delete;
+        registry& operator=(const registry& other) = delete;
+
+        registry(registry&& other) noexcept = default;
+        registry& operator=(registry&& other) noexcept = default;
+
+        entity wrap_entity(const const_uentity& ent) noexcept;
+        const_entity wrap_entity(const const_uentity& ent) const noexcept;
+
+        template < typename T >
+        component<T> wrap_component(const const_uentity& ent) noexcept;
+        template < typename T >
+        const_component<T> wrap_component(const const_uentity& ent) const noexcept;
+
+        entity create_entity();
+        entity create_entity(const prototype& proto);
+        entity create_entity(const compiled_prototype& proto);
+
+        template < typename OutputIt >
+        OutputIt instantiate(const prototype& proto, std::size_t count, OutputIt out);
+        template < typename OutputIt >
+        OutputIt instantiate(const compiled_prototype& proto, std::size_t count, OutputIt out);
+        entity create_entity(const const_uentity& proto);
+
+        // bounded mode: reserve entities first, then components,
+        // the try_ functions never allocate and report exhaustion instead
+
+        void reserve_entities(std::size_t count);
+        template < typename T >
+        void reserve_components(std::size_t count);
+
+        status try_create_entity(entity& ent) noexcept;
+        template < typename T, typename... Args >
+        status try_assign_component(const uentity& ent, Args&&... args)
+            noexcept(std::is_nothrow_constructible_v<T, Args...>
+                && std::is_nothrow_move_constructible_v<T>
+                && std::is_nothrow_move_assignable_v<T>);
+
+        void destroy_entity(const uentity& ent) noexcept;
+        bool valid_entity(const const_uentity& ent) const noexcept;
+
+        bool sleep_entity(const uentity& ent);
+        bool wake_entity(const uentity& ent) noexcept;
+        bool dormant_entity(const const_uentity& ent) const noexcept;
+        std::size_t dormant_entity_count() const noexcept;
+
+        void schedule_entity(const uentity& ent, std::uint32_t period);
+        bool unschedule_entity(const uentity& ent) noexcept;
+        std::uint32_t scheduled_period(const const_uentity& ent) const noexcept;
+
+        template < typename T, typename... Args >
+        T& assign_component(const uentity& ent, Args&&... args);
+
+        template < typename T, typename... Args >
+        T& ensure_component(const uentity& ent, Args&&... args);
+
+        template < typename T >
+        bool remove_component(const uentity& ent) noexcept;
+
+        template < typename T >
+        bool exists_component(const const_uentity& ent) const noexcept;
+
+        std::size_t remove_all_components(const uentity& ent) noexcept;
+
+        template < typename T >
+        std::size_t remove_all_components() noexcept;
+
+        template < typename T >
+        bool enable_component(const uentity& ent);
+        template < typename T >
+        bool disable_component(const uentity& ent);
+        template < typename T >
+        bool enabled_component(const const_uentity& ent) const noexcept;
+
+        bool enable_component(const uentity& ent, family_id family);
+        bool disable_component(const uentity& ent, family_id family);
+        bool enabled_component(const const_uentity& ent, family_id family) const noexcept;
+
+        family_id register_component(const runtime_component_info& info);
+
+        void* assign_component(const uentity& ent, family_id family, const void* src);
+        bool remove_component(const uentity& ent, family_id family) noexcept;
+        bool exists_component(const const_uentity& ent, family_id family) const noexcept;
+
+        void* find_component(const uentity& ent, family_id family) noexcept;
+        const void* find_component(const const_uentity& ent, family_id family) const noexcept;
+
+        template < typename T >
+        T& get_component(const uentity& ent);
+        template < typename T >
+        const T& get_component(const const_uentity& ent) const;
+
+        template < typename T >
+        T* find_component(const uentity& ent) noexcept;
+        template < typename T >
+        const T* find_component(const const_uentity& ent) const noexcept;
+
+        template < typename... Ts >
+        std::tuple<Ts&...> get_components(const uentity& ent);
+        template < typename... Ts >
+        std::tuple<const Ts&...> get_components(const const_uentity& ent) const;
+
+        template < typename... Ts >
+        std::tuple<Ts*...> find_components(const uentity& ent) noexcept;
+        template < typename... Ts >
+        std::tuple<const Ts*...> find_components(const const_uentity& ent) const noexcept;
+
+        // seqlocked components are read without locks from a mirror, writes through
+        // references are published by for_each_component, for_each_component_chunk,
+        // publish_components and end_frame
+        template < typename T >
+        void enable_seqlock_reads();
+        template < typename T >
+        bool seqlock_reads_enabled() const noexcept;
+        template < typename T >
+        std::optional<T> read_component(const const_uentity& ent) const noexcept;
+        template < typename T >
+        void publish_components() noexcept;
+
+        template < typename T >
+        std::size_t component_count() const noexcept;
+        std::size_t component_count(family_id family) const noexcept;
+        std::size_t entity_count() const noexcept;
+        std::size_t entity_component_count(const const_uentity& ent) const noexcept;
+
+        template < typename F, typename... Opts >
+        void for_each_entity(F&& f, Opts&&... opts);
+        template < typename F, typename... Opts >
+        void for_each_entity(F&& f, Opts&&... opts) const;
+
+        template < typename T, typename F, typename... Opts >
+        void for_each_component(F&& f, Opts&&... opts);
+        template < typename T, typename F, typename... Opts >
+        void for_each_component(F&& f, Opts&&... opts) const;
+
+        template < typename F, typename... Opts >
+        void for_each_component(family_id family, F&& f, Opts&&... opts);
+        template < typename F, typename... Opts >
+        void for_each_component(family_id family, F&& f, Opts&&... opts) const;
+
+        // chunks of one storage may be processed from different threads,
+        // callbacks must not add or remove components of that storage
+        template < typename T >
+        std::size_t component_chunk_count(std::size_t chunk_size) const noexcept;
+
+        template < typename T, typename F, typename... Opts >
+        void for_each_component_chunk(std::size_t chunk, std::size_t chunk_size, F&& f, Opts&&... opts);
+        template < typename T, typename F, typename... Opts >
+        void for_each_component_chunk(std::size_t chunk, std::size_t chunk_size, F&& f, Opts&&... opts) const;
+
+        // returns true when the cursor cycle is finished
+        template < typename T, typename F, typename... Opts >
+        bool for_each_component_budgeted(iteration_cursor& cursor, std::size_t max_items, F&& f, Opts&&... opts);
+        template < typename T, typename F, typename... Opts >
+        bool for_each_component_budgeted(iteration_cursor& cursor, std::size_t max_items, F&& f, Opts&&... opts) const;
+
+        template < typename T, typename F, typename... Opts >
+        bool for_each_component_budgeted(iteration_cursor& cursor, std::chrono::nanoseconds max_time, F&& f, Opts&&... opts);
+        template < typename T, typename F, typename... Opts >
+        bool for_each_component_budgeted(iteration_cursor& cursor, std::chrono::nanoseconds max_time, F&& f, Opts&&... opts) const;
+
+        template < typename F, typename... Opts >
+        void for_queried_components(const runtime_query& query, F&& f, Opts&&... opts);
+        template < typename F, typename... Opts >
+        void for_queried_components(const runtime_query& query, F&& f, Opts&&... opts) const;
+
+        template < typename... Ts, typename F, typename... Opts >
+        void for_joined_components(F&& f, Opts&&... opts);
+        template < typename... Ts, typename F, typename... Opts >
+        void for_joined_components(F&& f, Opts&&... opts) const;
+
+        // visits scheduled entities whose bucket is due on the frame
+        template < typename... Ts, typename F, typename... Opts >
+        void for_scheduled_components(std::uint64_t frame, F&& f, Opts&&... opts);
+        template < typename... Ts, typename F, typename... Opts >
+        void for_scheduled_components(std::uint64_t frame, F&& f, Opts&&... opts) const;
+
+        void set_parent(const uentity& child, const uentity& parent);
+        bool remove_parent(const uentity& child) noexcept;
+        bool has_parent(const const_uentity& child) const noexcept;
+
+        entity get_parent(const uentity& child);
+        const_entity get_parent(const const_uentity& child) const;
+
+        std::size_t child_count(const const_uentity& parent) const noexcept;
+        std::size_t destroy_hierarchy(const uentity& root);
+
+        template < typename F >
+        void for_each_child(const uentity& parent, F&& f);
+        template < typename F >
+        void for_each_child(const const_uentity& parent, F&& f) const;
+
+        template < typename F >
+        void for_each_in_hierarchy(F&& f);
+        template < typename F >
+        void for_each_in_hierarchy(F&& f) const;
+
+        template < typename T >
+        void sort_components_by_hierarchy();
+
+        template < typename T >
+        void sort_components_by_id() noexcept;
+        void sort_all_components_by_id() noexcept;
+
+        template < typename T, typename... Args >
+        const T& assign_shared_component(const uentity& ent, Args&&... args);
+
+        template < typename T, typename F >
+        const T& patch_shared_component(const uentity& ent, F&& f);
+
+        template < typename T >
+        bool remove_shared_component(const uentity& ent) noexcept;
+
+        template < typename T >
+        bool exists_shared_component(const const_uentity& ent) const noexcept;
+
+        template < typename T >
+        const T& get_shared_component(const const_uentity& ent) const;
+
+        template < typename T >
+        const T* find_shared_component(const const_uentity& ent) const noexcept;
+
+        template < typename T >
+        std::size_t shared_component_count() const noexcept;
+
+        template < typename T >
+        std::size_t shared_value_count() const noexcept;
+
+        template < typename T, typename F, typename... Opts >
+        void for_each_shared_component(F&& f, Opts&&... opts);
+        template < typename T, typename F, typename... Opts >
+        void for_each_shared_component(F&& f, Opts&&... opts) const;
+
+        template < typename T, typename... Args >
+        T& assign_transient_component(const uentity& ent, Args&&... args);
+
+        template < typename T >
+        bool remove_transient_component(const uentity& ent) noexcept;
+
+        template < typename T >
+        bool exists_transient_component(const const_uentity& ent) const noexcept;
+
+        template < typename T >
+        T& get_transient_component(const uentity& ent);
+        template < typename T >
+        const T& get_transient_component(const const_uentity& ent) const;
+
+        template < typename T >
+        T* find_transient_component(const uentity& ent) noexcept;
+        template < typename T >
+        const T* find_transient_component(const const_uentity& ent) const noexcept;
+
+        template < typename T >
+        std::size_t transient_component_count() const noexcept;
+
+        template < typename T, typename F, typename... Opts >
+        void for_each_transient_component(F&& f, Opts&&... opts);
+        template < typename T, typename F, typename... Opts >
+        void for_each_transient_component(F&& f, Opts&&... opts) const;
+
+        // drops all transient components of the frame in O(1) per type
+        // and publishes the values of seqlocked storages
+        void end_frame() noexcept;
+
+        template < typename T, typename... Args >
+        T& assign_buffered_component(const uentity& ent, Args&&... args);
+
+        template < typename T >
+        bool remove_buffered_component(const uentity& ent) noexcept;
+
+        template < typename T >
+        bool exists_buffered_component(const const_uentity& ent) const noexcept;
+
+        // readers get the previous values, written ones are visible after swap_buffers
+        template < typename T >
+        const T& get_buffered_component(const const_uentity& ent) const;
+        template < typename T >
+        const T* find_buffered_component(const const_uentity& ent) const noexcept;
+
+        template < typename T >
+        T& get_next_buffered_component(const uentity& ent);
+        template < typename T >
+        T* find_next_buffered_component(const uentity& ent) noexcept;
+
+        template < typename T >
+        std::size_t buffered_component_count() const noexcept;
+
+        // f(entity, const T& previous, T& next), storages are locked shared
+        template < typename T, typename F, typename... Opts >
+        void for_each_buffered_component(F&& f, Opts&&... opts);
+        template < typename T, typename F, typename... Opts >
+        void for_each_buffered_component(F&& f, Opts&&... opts) const;
+
+        template < typename T >
+        void swap_buffers() noexcept(std::is_nothrow_copy_assignable_v<T>);
+
+        // end_frame also sorts all component storages by entity id
+        void set_deterministic(bool yesno) noexcept;
+        bool is_deterministic() const noexcept;
+
+        // order independent 64-bit hashes, equal states hash equally on every
+        // machine as long as the component hasher is platform independent too
+        std::uint64_t entity_state_hash() const noexcept;
+        template < typename T, typename Hash >
+        std::uint64_t component_state_hash(Hash&& hash) const;
+
+        template < typename R, typename... Args >
+        R& assign_relation(const uentity& source, const const_uentity& target, Args&&... args);
+
+        template < typename R >
+        bool remove_relation(const uentity& source, const const_uentity& target) noexcept;
+
+        template < typename R >
+        bool exists_relation(const const_uentity& source) const noexcept;
+        template < typename R >
+        bool exists_relation(const const_uentity& source, const const_uentity& target) const noexcept;
+
+        template < typename R >
+        R& get_relation(const uentity& source, const const_uentity& target);
+        template < typename R >
+        const R& get_relation(const const_uentity& source, const const_uentity& target) const;
+
+        template < typename R >
+        R* find_relation(const uentity& source, const const_uentity& target) noexcept;
+        template < typename R >
+        const R* find_relation(const const_uentity& source, const const_uentity& target) const noexcept;
+
+        std::size_t remove_all_relations(const uentity& ent) noexcept;
+
+        template < typename R >
+        std::size_t relation_count() const noexcept;
+        template < typename R >
+        std::size_t relation_count(const const_uentity& source) const noexcept;
+        template < typename R >
+        std::size_t related_count(const const_uentity& target) const noexcept;
+
+        template < typename R, typename F >
+        void for_each_relation(const uentity& source, F&& f);
+        template < typename R, typename F >
+        void for_each_relation(const const_uentity& source, F&& f) const;
+
+        template < typename R, typename F >
+        void for_each_related(const uentity& target, F&& f);
+        template < typename R, typename F >
+        void for_each_related(const const_uentity& target, F&& f) const;
+
+        template < typename Tag, typename... Args >
+        feature& assign_feature(Args&&... args);
+
+        template < typename Tag, typename... Args >
+        feature& ensure_feature(Args&&... args);
+
+        template < typename Tag >
+        bool has_feature() const noexcept;
+
+        template < typename Tag >
+        feature& get_feature();
+
+        template < typename Tag >
+        const feature& get_feature() const;
+
+        template < typename T, typename... Args >
+        T& assign_ctx(Args&&... args);
+
+        template < typename T, typename... Args >
+        T& ensure_ctx(Args&&... args);
+
+        template < typename T >
+        bool remove_ctx() noexcept;
+
+        template < typename T >
+        bool has_ctx() const noexcept;
+
+        template < typename T >
+        T& ctx();
+        template < typename T >
+        const T& ctx() const;
+
+        template < typename T >
+        T* find_ctx() noexcept;
+        template < typename T >
+        const T* find_ctx() const noexcept;
+
+        template < typename Event >
+        registry& process_event(const Event& event);
+
+        struct memory_usage_info {
+            std::size_t entities{0u};
+            std::size_t components{0u};
+        };
+        memory_usage_info memory_usage() const noexcept;
+
+        template < typename T >
+        std::size_t component_memory_usage() const noexcept;
+
+        std::pmr::memory_resource* resource() const noexcept;
+    private:
+        void create_entities_(std::size_t count, std::vector<entity_id>& ids);
+
+        template < typename T >
+        detail::component_storage<T>* find_storage_() noexcept;
+
+        template < typename T >
+        const detail::component_storage<T>* find_storage_() const noexcept;
+
+        template < typename T >
+        detail::component_storage<T>& get_or_create_storage_();
+
+        template < typename Storage, typename... Args >
+        Storage& create_storage_(family_id family, Args&&... args);
+
+        detail::component_storage_base* find_storage_(family_id family) noexcept;
+        const detail::component_storage_base* find_storage_(family_id family) const noexcept;
+
+        template < typename T >
+        detail::shared_storage<T>* find_shared_() noexcept;
+
+        template < typename T >
+        const detail::shared_storage<T>* find_shared_() const noexcept;
+
+        template < typename T >
+        detail::shared_storage<T>& get_or_create_shared_();
+
+        template < typename T >
+        detail::transient_storage<T>* find_transient_() noexcept;
+
+        template < typename T >
+        const detail::transient_storage<T>* find_transient_() const noexcept;
+
+        template < typename T >
+        detail::transient_storage<T>& get_or_create_transient_();
+
+        template < typename T >
+        detail::buffered_storage<T>* find_buffered_() noexcept;
+
+        template < typename T >
+        const detail::buffered_storage<T>* find_buffered_() const noexcept;
+
+        template < typename T >
+        detail::buffered_storage<T>& get_or_create_buffered_();
+
+        template < typename R >
+        detail::relation_storage<R>* find_relations_() noexcept;
+
+        template < typename R >
+        const detail::relation_storage<R>* find_relations_() const noexcept;
+
+        template < typename R >
+        detail::relation_storage<R>& get_or_create_relations_();
+
+        struct query_storages_ {
+            detail::component_storage_base* driver{nullptr};
+            std::vector<detail::component_storage_base*> required;
+            std::vector<detail::component_storage_base*> excluded;
+            std::vector<detail::component_storage_base*> optional;
+        };
+        bool resolve_query_storages_(const runtime_query& query, query_storages_& ss) const;
+
+        template < typename Ent, typename F, typename... Opts >
+        void for_queried_components_impl_(const query_storages_& ss, F&& f, Opts&&... opts) const;
+
+        template < typename Ent, typename T, typename Budget, typename F, typename... Opts >
+        bool for_each_component_budgeted_(iteration_cursor& cursor, Budget&& budget, F&& f, Opts&&... opts) const;
+
+        template < typename Ent, typename F >
+        void for_each_in_hierarchy_(F&& f) const;
+
+        // snapshots under the entity ids locker, callbacks run unlocked
+        std::vector<entity_id> scheduled_ids_(std::uint64_t frame) const;
+        bool awake_entity_(entity_id ent) const noexcept;
+
+        void set_components_active_(entity_id ent, bool yesno) noexcept;
+        bool settle_component_(detail::component_storage_base& storage, entity_id ent) noexcept;
+
+        // the caller must hold the entity ids locker
+        void release_entity_(entity_id ent) noexcept;
+    private:
+        entity_id last_entity_id_{0u};
+        detail::resource_vector<entity_id> free_entity_ids_;
+
+        /* protected by mutexes.entity_ids_mutex */
+        detail::sparse_set<entity_id, detail::entity_id_indexer> entity_ids_;
+        detail::sparse_set<entity_id, detail::entity_id_indexer> dormant_entities_;
+        detail::update_schedule schedule_;
+
+        detail::object_arena storages_arena_;
+        std::vector<detail::component_storage_base*> storages_;
+        std::vector<family_id> storage_families_;
+
+        /* lock-free, a set bit means the entity may have the component */
+        detail::entity_signatures signatures_;
+
+        std::vector<detail::shared_storage_base*> shared_;
+        std::vector<family_id> shared_families_;
+
+        std::vector<detail::transient_storage_base*> transients_;
+        std::vector<family_id> transient_families_;
+
+        std::vector<detail::buffered_storage_base*> buffered_;
+        std::vector<family_id> buffered_families_;
+
+        std::vector<detail::relation_storage_base*> relations_;
+        std::vector<family_id> relation_families_;
+
+        /* protected by mutexes.features_mutex */
+        detail::sparse_map<family_id, feature> features_;
+
+        /* protected by mutexes.hierarchy_mutex */
+        mutable detail::hierarchy_storage hierarchy_;
+
+        /* reads are lock-free, assign before sharing the registry */
+        detail::context_storage context_;
+
+        bool deterministic_{false};
+
+        mutable mutexes mutexes_;
+    };
+}
+
+// -----------------------------------------------------------------------------
+//
+// options
+//
+// -----------------------------------------------------------------------------
+
+namespace ecs_hpp
+{
+    namespace detail
+    {
+        template < typename T >
+        struct is_option
+        : std::false_type {};
+
+        template < typename T >
+        struct is_option<exists<T>>
+        : std::true_type {};
+
+        template < typename... Ts >
+        struct is_option<exists_any<Ts...>>
+        : std::true_type {};
+
+        template < typename... Ts >
+        struct is_option<exists_all<Ts...>>
+        : std::true_type {};
+
+        template < typename T >
+        struct is_option<option_neg<T>>
+        : std::true_type {};
+
+        template < typename... Ts >
+        struct is_option<option_conj<Ts...>>
+        : std::true_type {};
+
+        template < typename... Ts >
+        struct is_option<option_disj<Ts...>>
+        : std::true_type {};
+
+        template <>
+        struct is_option<option_bool>
+        : std::true_type {};
+
+        template < typename R >
+        struct is_option<related<R>>
+        : std::true_type {};
+
+        template < typename T >
+        inline constexpr bool is_option_v = is_option<T>::value;
+
+        template < typename E >
+        using option_entity_t = std::conditional_t<
+            std::is_convertible_v<const E&, const_entity>,
+            const_entity,
+            E>;
+    }
+
+    //
+    // options
+    //
+
+    template < typename T >
+    class exists final {
+    public:
+        template < typename E >
+        bool operator()(const E& e) const {
+            const detail::option_entity_t<E>& oe = e;
+            return oe.template exists_component<T>();
+        }
+    };
+
+    template < typename... Ts >
+    class exists_any final {
+    public:
+        template < typename E >
+        bool operator()(const E& e) const {
+            const detail::option_entity_t<E>& oe = e;
+            (void)oe;
+            return (... || oe.template exists_component<Ts>());
+        }
+    };
+
+    template < typename... Ts >
+    class exists_all final {
+    public:
+        template < typename E >
+        bool operator()(const E& e) const {
+            const detail::option_entity_t<E>& oe = e;
+            (void)oe;
+            return (... && oe.template exists_component<Ts>());
+        }
+    };
+
+    template < typename R >
+    class related final {
+    public:
+        related() = default;
+
+        explicit related(entity_id target)
+        : target_(target) {}
+
+        template < typename E >
+        bool operator()(const E& e) const {
+            const detail::option_entity_t<E>& oe = e;
+            return target_
+                ? oe.owner().template exists_relation<R>(oe, target_)
+                : oe.owner().template exists_relation<R>(oe);
+        }
+    private:
+        entity_id target_{0u};
+    };
+
+    //
+    // combinators
+    //
+
+    template < typename T >
+    class option_neg final {
+    public:
+        option_neg(T opt)
+        : opt_(std::move(opt)) {}
+
+        template < typename E >
+        bool operator()(const E& e) const {
+            return !opt_(e);
+        }
+    private:
+        T opt_;
+    };
+
+    template < typename... Ts >
+    class option_conj final {
+    public:
+        option_conj(Ts... opts)
+        : opts_(std::make_tuple(std::move(opts)...)) {}
+
+        template < typename E >
+        bool operator()(const E& e) const {
+            return std::apply([&e](auto&&... opts){
+                return (... && opts(e));
+            }, opts_);
+        }
+    private:
+        std::tuple<Ts...> opts_;
+    };
+
+    template < typename... Ts >
+    class option_disj final {
+    public:
+        option_disj(Ts... opts)
+        : opts_(std::make_tuple(std::move(opts)...)) {}
+
+        template < typename E >
+        bool operator()(const E& e) const {
+            return std::apply([&e](auto&&... opts){
+                return (... || opts(e));
+            }, opts_);
+        }
+    private:
+        std::tuple<Ts...> opts_;
+    };
+
+    class option_bool final {
+    public:
+        option_bool(bool b)
+        : bool_(b) {}
+
+        template < typename E >
+        bool operator()(const E& e) const {
+            (void)e;
+            return bool_;
+        }
+    private:
+        bool bool_{false};
+    };
+
+    //
+    // operators
+    //
+
+    template < typename A
+             , typename = std::enable_if_t<detail::is_option_v<A>> >
+    option_neg<std::decay_t<A>> operator!(A&& a) {
+        return {std::forward<A>(a)};
+    }
+
+    template < typename A, typename B
+             , typename = std::enable_if_t<detail::is_option_v<A>>
+             , typename = std::enable_if_t<detail::is_option_v<B>> >
+    option_conj<std::decay_t<A>, std::decay_t<B>> operator&&(A&& a, B&& b) {
+        return {std::forward<A>(a), std::forward<B>(b)};
+    }
+
+    template < typename A, typename B
+             , typename = std::enable_if_t<detail::is_option_v<A>>
+             , typename = std::enable_if_t<detail::is_option_v<B>> >
+    option_disj<std::decay_t<A>, std::decay_t<B>> operator||(A&& a, B&& b) {
+        return {std::forward<A>(a), std::forward<B>(b)};
+    }
+}
+
+// -----------------------------------------------------------------------------
+//
+// join terms
+//
+// -----------------------------------------------------------------------------
+
+namespace ecs_hpp
+{
+    template < typename T >
+    class without final {};
+
+    template < typename T >
+    class maybe final {};
+
+    namespace detail
+    {
+        template < typename T >
+        struct join_term {
+            using component_type = T;
+            static constexpr bool required = true;
+            static constexpr bool excluded = false;
+            static constexpr bool optional = false;
+        };
+
+        template < typename T >
+        struct join_term<without<T>> {
+            using component_type = T;
+            static constexpr bool required = false;
+            static constexpr bool excluded = true;
+            static constexpr bool optional = false;
+        };
+
+        template < typename T >
+        struct join_term<maybe<T>> {
+            using component_type = T;
+            static constexpr bool required = false;
+            static constexpr bool excluded = false;
+            static constexpr bool optional = true;
+        };
+
+        template < typename T >
+        using join_term_component_t = typename join_term<T>::component_type;
+
+        template < typename T >
+        auto join_term_option() noexcept {
+            if constexpr ( join_term<T>::excluded ) {
+                return !exists<join_term_component_t<T>>{};
+            } else if constexpr ( join_term<T>::optional ) {
+                return option_bool{true};
+            } else {
+                return exists<T>{};
+            }
+        }
+
+        template < typename... Ts >
+        class join_terms final {
+            static_assert(
+                are_unique_v<join_term_component_t<Ts>...>,
+                "ecs_hpp (duplicate component types in join)");
+
+            static constexpr std::size_t find_driver_index() noexcept {
+                constexpr bool required[] = {join_term<Ts>::required..., false};
+                for ( std::size_t i = 0; i < sizeof...(Ts); ++i ) {
+                    if ( required[i] ) {
+                        return i;
+                    }
+                }
+                return sizeof...(Ts);
+            }
+        public:
+            static constexpr std::size_t driver_index = find_driver_index();
+            static constexpr bool has_driver = driver_index < sizeof...(Ts);
+
+            using driver_type = std::tuple_element_t<
+                has_driver ? driver_index : 0u,
+                std::tuple<Ts..., void>>;
+
+            template < typename Ss >
+            static bool has_required_storages(const Ss& ss) noexcept {
+                return has_required_storages_(ss, std::index_sequence_for<Ts...>());
+            }
+
+            template < typename Ent, typename Ss, typename F >
+            static void invoke(const Ent& e, const Ss& ss, const F& f) {
+                static_assert(!has_driver);
+                invoke_(e, ss, static_cast<void*>(nullptr), f, std::index_sequence_for<Ts...>());
+            }
+
+            template < typename Ent, typename Ss, typename D, typename F >
+            static void invoke(const Ent& e, const Ss& ss, D* d, const F& f) {
+                invoke_(e, ss, d, f, std::index_sequence_for<Ts...>());
+            }
+        private:
+            template < typename Ss, std::size_t... Is >
+            static bool has_required_storages_(const Ss& ss, std::index_sequence<Is...>) noexcept {
+                (void)ss;
+                return (... && (!join_term<Ts>::required || std::get<Is>(ss)));
+            }
+
+            template < typename Ent, typename Ss, typename D, typename F, std::size_t... Is >
+            static void invoke_(const Ent& e, const Ss& ss, D* d, const F& f, std::index_sequence<Is...>) {
+                (void)ss; (void)d;
+                std::tuple<decltype(std::get<Is>(ss)->find(entity_id()))...> cs;
+                if ( (... && probe_<Ts, Is>(e, ss, d, std::get<Is>(cs))) ) {
+                    std::apply(f, std::tuple_cat(
+                        std::tuple<const Ent&>(e),
+                        argument_<Ts>(std::get<Is>(cs))...));
+                }
+            }
+
+            template < typename T, std::size_t I, typename Ss, typename D, typename C >
+            static bool probe_(entity_id id, const Ss& ss, D* d, C*& c) noexcept {
+                if constexpr ( I == driver_index ) {
+                    (void)id; (void)ss;
+                    c = d;
+                    return true;
+                } else if constexpr ( join_term<T>::excluded ) {
+                    (void)d; (void)c;
+                    const auto storage = std::get<I>(ss);
+                    return !storage || !storage->has_enabled(id);
+                } else if constexpr ( join_term<T>::optional ) {
+                    (void)d;
+                    const auto storage = std::get<I>(ss);
+                    c = storage ? storage->find_enabled(id) : nullptr;
+                    return true;
+                } else {
+                    (void)d;
+                    c = std::get<I>(ss)->find_enabled(id);
+                    return !!c;
+                }
+            }
+
+            template < typename T, typename C >
+            static auto argument_(C* c) noexcept {
+                if constexpr ( join_term<T>::excluded ) {
+                    (void)c;
+                    return std::tuple<>();
+                } else if constexpr ( join_term<T>::optional ) {
+                    return std::tuple<C*>(c);
+                } else {
+                    return std::tuple<C&>(*c);
+                }
+            }
+        };
+    }
+}
+
+// -----------------------------------------------------------------------------
+//
+// aspect
+//
+// -----------------------------------------------------------------------------
+
+namespace ecs_hpp
+{
+    template < typename... Ts >
+    class aspect {
+    public:
+        static auto to_option() noexcept {
+            return (option_bool{true} && ... && detail::join_term_option<Ts>());
+        }
+
+        template < typename E >
+        static bool match_entity(const E& e) noexcept {
+            return to_option()(e);
+        }
+
+        template < typename Registry, typename F, typename... Opts >
+        static void for_each_entity(Registry& owner, F&& f, Opts&&... opts) {
+            owner.template for_joined_components<Ts...>(
+                [&f](const auto& e, const auto&...){
+                    f(e);
+                }, std::forward<Opts>(opts)...);
+        }
+
+        template < typename Registry, typename F, typename... Opts >
+        static void for_joined_components(Registry& owner, F&& f, Opts&&... opts) {
+            owner.template for_joined_components<Ts...>(
+                std::forward<F>(f),
+                std::forward<Opts>(opts)...);
+        }
+    };
+}
+
+// -----------------------------------------------------------------------------
+//
+// static_entity
+//
+// -----------------------------------------------------------------------------
+
+namespace ecs_hpp
+{
+    template < typename Registry >
+    class static_entity final {
+    public:
+        static_entity(Registry& owner, entity_id id) noexcept;
+
+        template < typename R
+                 , typename = std::enable_if_t<std::is_convertible_v<R*, Registry*>> >
+        static_entity(const static_entity<R>& other) noexcept;
+
+        Registry& owner() const noexcept;
+        entity_id id() const noexcept;
+
+        operator entity_id() const noexcept;
+
+        void destroy() const noexcept;
+        bool valid() const noexcept;
+
+        template < typename T, typename... Args >
+        T& assign_component(Args&&... args) const;
+
+        template < typename T, typename... Args >
+        T& ensure_component(Args&&... args) const;
+
+        template < typename T >
+        bool remove_component() const noexcept;
+
+        template < typename T >
+        bool exists_component() const noexcept;
+
+        std::size_t remove_all_components() const noexcept;
+
+        template < typename T >
+        decltype(auto) get_component() const;
+
+        template < typename T >
+        auto find_component() const noexcept;
+
+        std::size_t component_count() const noexcept;
+    private:
+        Registry* owner_{nullptr};
+        entity_id id_{0u};
+    };
+
+    template < typename L, typename R >
+    bool operator==(const static_entity<L>& l, const static_entity<R>& r) noexcept;
+
+    template < typename L, typename R >
+    bool operator!=(const static_entity<L>& l, const static_entity<R>& r) noexcept;
+}
+
+// -----------------------------------------------------------------------------
+//
+// static_registry
+//
+// -----------------------------------------------------------------------------
+
+namespace ecs_hpp
+{
+    // components are stored in a tuple of static_component_storage, without
+    // the virtual base and the per-slot state of the dynamic registry storages
+    template < typename... Cs >
+    class static_registry final {
+        static_assert(
+            detail::are_unique_v<Cs...>,
+            "ecs_hpp::static_registry (duplicate component types)");
+    public:
+        using entity = static_entity<static_registry>;
+        using const_entity = static_entity<const static_registry>;
+
+        template < typename T >
+        static constexpr bool has_component_type = detail::is_one_of_v<T, Cs...>;
+    public:
+        static_registry() = default;
+
+        static_registry(const static_registry& other) = delete;
+        static_registry& operator=(const static_registry& other) = delete;
+
+        entity wrap_entity(entity_id ent) noexcept;
+        const_entity wrap_entity(entity_id ent) const noexcept;
+
+        entity create_entity();
+        entity create_entity(entity_id proto);
+
+        void destroy_entity(entity_id ent) noexcept;
+        bool valid_entity(entity_id ent) const noexcept;
+
+        template < typename T, typename... Args >
+        T& assign_component(entity_id ent, Args&&... args);
+
+        template < typename T, typename... Args >
+        T& ensure_component(entity_id ent, Args&&... args);
+
+        template < typename T >
+        bool remove_component(entity_id ent) noexcept;
+
+        template < typename T >
+        bool exists_component(entity_id ent) const noexcept;
+
+        std::size_t remove_all_components(entity_id ent) noexcept;
+
+        template < typename T >
+        std::size_t remove_all_components() noexcept;
+
+        template < typename T >
+        T& get_component(entity_id ent);
+        template < typename T >
+        const T& get_component(entity_id ent) const;
+
+        template < typename T >
+        T* find_component(entity_id ent) noexcept;
+        template < typename T >
+        const T* find_component(entity_id ent) const noexcept;
+
+        template < typename... Ts >
+        std::tuple<Ts&...> get_components(entity_id ent);
+        template < typename... Ts >
+        std::tuple<const Ts&...> get_components(entity_id ent) const;
+
+        template < typename... Ts >
+        std::tuple<Ts*...> find_components(entity_id ent) noexcept;
+        template < typename... Ts >
+        std::tuple<const Ts*...> find_components(entity_id ent) const noexcept;
+
+        template < typename T >
+        std::size_t component_count() const noexcept;
+        std::size_t entity_count() const noexcept;
+        std::size_t entity_component_count(entity_id ent) const noexcept;
+
+        template < typename F, typename... Opts >
+        void for_each_entity(F&& f, Opts&&... opts);
+        template < typename F, typename... Opts >
+        void for_each_entity(F&& f, Opts&&... opts) const;
+
+        template < typename T, typename F, typename... Opts >
+        void for_each_component(F&& f, Opts&&... opts);
+        template < typename T, typename F, typename... Opts >
+        void for_each_component(F&& f, Opts&&... opts) const;
+
+        template < typename... Ts, typename F, typename... Opts >
+        void for_joined_components(F&& f, Opts&&... opts);
+        template < typename... Ts, typename F, typename... Opts >
+        void for_joined_components(F&& f, Opts&&... opts) const;
+
+        struct memory_usage_info {
+            std::size_t entities{0u};
+            std::size_t components{0u};
+        };
+        memory_usage_info memory_usage() const noexcept;
+
+        template < typename T >
+        std::size_t component_memory_usage() const noexcept;
+    private:
+        template < typename T >
+        detail::static_component_storage<T>& storage_() noexcept;
+
+        template < typename T >
+        const detail::static_component_storage<T>& storage_() const noexcept;
+
+        template < typename... Ts, typename F, typename... Opts >
+        void for_joined_components_impl_(F&& f, Opts&&... opts);
+
+        template < typename... Ts, typename F, typename... Opts >
+        void for_joined_components_impl_(F&& f, Opts&&... opts) const;
+    private:
+        entity_id last_entity_id_{0u};
+        std::vector<entity_id> free_entity_ids_;
+        detail::sparse_set<entity_id, detail::entity_id_indexer> entity_ids_;
+        mutable std::shared_mutex entity_ids_locker_;
+        std::tuple<detail::static_component_storage<Cs>...> storages_;
+    };
+}
+
+// -----------------------------------------------------------------------------
+//
+// fillers
+//
+// -----------------------------------------------------------------------------
+
+namespace ecs_hpp
+{
+    class entity_filler final {
+    public:
+        entity_filler(entity& entity) noexcept
+        : entity_(entity) {}
+
+        template < typename T, typename... Args >
+        entity_filler& component(Args&&... args) {
+            entity_.assign_component<T>(std::forward<Args>(args)...);
+            return *this;
+        }
+    private:
+        entity& entity_;
+    };
+
+    class registry_filler final {
+    public:
+        registry_filler(registry& registry) noexcept
+        : registry_(registry) {}
+
+        template < typename Tag, typename... Args >
+        registry_filler& feature(Args&&... args) {
+            registry_.assign_feature<Tag>(std::forward<Args>(args)...);
+            return *this;
+        }
+    private:
+        registry& registry_;
+    };
+}
+
+// -----------------------------------------------------------------------------
+//
+// entity impl
+//
+// -----------------------------------------------------------------------------
+
+namespace ecs_hpp
+{
+    inline entity::entity(registry& owner) noexcept
+    : owner_(&owner) {}
+
+    inline entity::entity(registry& owner, entity_id id) noexcept
+    : owner_(&owner)
+    , id_(id) {}
+
+    inline registry& entity::owner() noexcept {
+        return *owner_;
+    }
+
+    inline const registry& entity::owner() const noexcept {
+        return *owner_;
+    }
+
+    inline entity_id entity::id() const noexcept {
+        return id_;
+    }
+
+    inline entity entity::clone() const {
+        return (*owner_).create_entity(id_);
+    }
+
+    inline void entity::destroy() noexcept {
+        (*owner_).destroy_entity(id_);
+    }
+
+    inline bool entity::valid() const noexcept {
+        return std::as_const(*owner_).valid_entity(id_);
+    }
+
+    template < typename T, typename... Args >
+    T& entity::assign_component(Args&&... args) {
+        return (*owner_).assign_component<T>(
+            id_,
+            std::forward<Args>(args)...);
+    }
+
+    template < typename T, typename... Args >
+    T& entity::ensure_component(Args&&... args) {
+        return (*owner_).ensure_component<T>(
+            id_,
+            std::forward<Args>(args)...);
+    }
+
+    template < typename T >
+    bool entity::remove_component() noexcept {
+        return (*owner_).remove_component<T>(id_);
+    }
+
+    template < typename T >
+    bool entity::exists_component() const noexcept {
+        return std::as_const(*owner_).exists_component<T>(id_);
+    }
+
+    inline std::size_t entity::remove_all_components() noexcept {
+        return (*owner_).remove_all_components(id_);
+    }
+
+    template < typename T >
+    T& entity::get_component() {
+        return (*owner_).get_component<T>(id_);
+    }
+
+    template < typename T >
+    const T& entity::get_component() const {
+        return std::as_const(*owner_).get_component<T>(id_);
+    }
+
+    template < typename T >
+    T* entity::find_component() noexcept {
+        return (*owner_).find_component<T>(id_);
+    }
+
+    template < typename T >
+    const T* entity::find_component() const noexcept {
+        return std::as_const(*owner_).find_component<T>(id_);
+    }
+
+    template < typename... Ts >
+    std::tuple<Ts&...> entity::get_components() {
+        return (*owner_).get_components<Ts...>(id_);
+    }
+
+    template < typename... Ts >
+    std::tuple<const Ts&...> entity::get_components() const {
+        return std::as_const(*owner_).get_components<Ts...>(id_);
+    }
+
+    template < typename... Ts >
+    std::tuple<Ts*...> entity::find_components() noexcept {
+        return (*owner_).find_components<Ts...>(id_);
+    }
+
+    template < typename... Ts >
+    std::tuple<const Ts*...> entity::find_components() const noexcept {
+        return std::as_const(*owner_).find_components<Ts...>(id_);
+    }
+
+    inline std::size_t entity::component_count() const noexcept {
+        return std::as_const(*owner_).entity_component_count(id_);
+    }
+
+    inline bool operator<(const entity& l, const entity& r) noexcept {
+        return (&l.owner() < &r.owner())
+            || (&l.owner() == &r.owner() && l.id() < r.id());
+    }
+
+    inline bool operator==(const entity& l, const entity& r) noexcept {
+        return &l.owner() == &r.owner()
+            && l.id() == r.id();
+    }
+
+    inline bool operator==(const entity& l, const const_entity& r) noexcept {
+        return &l.owner() == &r.owner()
+            && l.id() == r.id();
+    }
+
+    inline bool operator!=(const entity& l, const entity& r) noexcept {
+        return !(l == r);
+    }
+
+    inline bool operator!=(const entity& l, const const_entity& r) noexcept {
+        return !(l == r);
+    }
+}
+
+// -----------------------------------------------------------------------------
+//
+// const_entity impl
+//
+// -----------------------------------------------------------------------------
+
+namespace ecs_hpp
+{
+    inline const_entity::const_entity(const entity& ent) noexcept
+    : owner_(&ent.owner())
+    , id_(ent.id()) {}
+
+    inline const_entity::const_entity(const registry& owner) noexcept
+    : owner_(&owner) {}
+
+    inline const_entity::const_entity(const registry& owner, entity_id id) noexcept
+    : owner_(&owner)
+    , id_(id) {}
+
+    inline const registry& const_entity::owner() const noexcept {
+        return *owner_;
+    }
+
+    inline entity_id const_entity::id() const noexcept {
+        return id_;
+    }
+
+    inline bool const_entity::valid() const noexcept {
+        return (*owner_).valid_entity(id_);
+    }
+
+    template < typename T >
+    bool const_entity::exists_component() const noexcept {
+        return (*owner_).exists_component<T>(id_);
+    }
+
+    template < typename T >
+    const T& const_entity::get_component() const {
+        return (*owner_).get_component<T>(id_);
+    }
+
+    template < typename T >
+    const T* const_entity::find_component() const noexcept {
+        return (*owner_).find_component<T>(id_);
+    }
+
+    template < typename... Ts >
+    std::tuple<const Ts&...> const_entity::get_components() const {
+        return (*owner_).get_components<Ts...>(id_);
+    }
+
+    template < typename... Ts >
+    std::tuple<const Ts*...> const_entity::find_components() const noexcept {
+        return (*owner_).find_components<Ts...>(id_);
+    }
+
+    inline std::size_t const_entity::component_count() const noexcept {
+        return (*owner_).entity_component_count(id_);
+    }
+
+    inline bool operator<(const const_entity& l, const const_entity& r) noexcept {
+        return (&l.owner() < &r.owner())
+            || (&l.owner() == &r.owner() && l.id() < r.id());
+    }
+
+    inline bool operator==(const const_entity& l, const entity& r) noexcept {
+        return &l.owner() == &r.owner()
+            && l.id() == r.id();
+    }
+
+    inline bool operator==(const const_entity& l, const const_entity& r) noexcept {
+        return &l.owner() == &r.owner()
+            && l.id() == r.id();
+    }
+
+    inline bool operator!=(const const_entity& l, const entity& r) noexcept {
+        return !(l == r);
+    }
+
+    inline bool operator!=(const const_entity& l, const const_entity& r) noexcept {
+        return !(l == r);
+    }
+}
+
+// -----------------------------------------------------------------------------
+//
+// component impl
+//
+// -----------------------------------------------------------------------------
+
+namespace ecs_hpp
+{
+    template < typename T >
+    component<T>::component(const entity& owner) noexcept
+    : owner_(owner) {}
+
+    template < typename T >
+    entity& component<T>::owner() noexcept {
+        return owner_;
+    }
+
+    template < typename T >
+    const entity& component<T>::owner() const noexcept {
+        return owner_;
+    }
+
+    template < typename T >
+    bool component<T>::valid() const noexcept {
+        return owner_.valid();
+    }
+
+    template < typename T >
+    bool component<T>::exists() const noexcept {
+        return owner_.exists_component<T>();
+    }
+
+    template < typename T >
+    template < typename... Args >
+    T& component<T>::assign(Args&&... args) {
+        return owner_.assign_component<T>(std::forward<Args>(args)...);
+    }
+
+    template < typename T >
+    template < typename... Args >
+    T& component<T>::ensure(Args&&... args) {
+        return owner_.ensure_component<T>(std::forward<Args>(args)...);
+    }
+
+    template < typename T >
+    bool component<T>::remove() noexcept {
+        return owner_.remove_component<T>();
+    }
+
+    template < typename T >
+    T& component<T>::get() {
+        return owner_.get_component<T>();
+    }
+
+    template < typename T >
+    const T& component<T>::get() const {
+        return std::as_const(owner_).template get_component<T>();
+    }
+
+    template < typename T >
+    T* component<T>::find() noexcept {
+        return owner_.find_component<T>();
+    }
+
+    template < typename T >
+    const T* component<T>::find() const noexcept {
+        return std::as_const(owner_).template find_component<T>();
+    }
+
+    template < typename T >
+    T& component<T>::operator*() {
+        return get();
+    }
+
+    template < typename T >
+    const T& component<T>::operator*() const {
+        return get();
+    }
+
+    template < typename T >
+    T* component<T>::operator->() noexcept {
+        return find();
+    }
+
+    template < typename T >
+    const T* component<T>::operator->() const noexcept {
+        return find();
+    }
+
+    template < typename T >
+    component<T>::operator bool() const noexcept {
+        return exists();
+    }
+
+    template < typename T >
+    bool operator<(const component<T>& l, const component<T>& r) noexcept {
+        return l.owner() < r.owner();
+    }
+
+    template < typename T >
+    bool operator==(const component<T>& l, const component<T>& r) noexcept {
+        return l.owner() == r.owner();
+    }
+
+    template < typename T >
+    bool operator==(const component<T>& l, const const_component<T>& r) noexcept {
+        return l.owner() == r.owner();
+    }
+
+    template < typename T >
+    bool operator!=(const component<T>& l, const component<T>& r) noexcept {
+        return !(l == r);
+    }
+
+    template < typename T >
+    bool operator!=(const component<T>& l, const const_component<T>& r) noexcept {
+        return !(l == r);
+    }
+}
+
+// -----------------------------------------------------------------------------
+//
+// const_component impl
+//
+// -----------------------------------------------------------------------------
+
+namespace ecs_hpp
+{
+    template < typename T >
+    const_component<T>::const_component(const component<T>& comp) noexcept
+    : owner_(comp.owner()) {}
+
+    template < typename T >
+    const_component<T>::const_component(const const_entity& owner) noexcept
+    : owner_(owner) {}
+
+    template < typename T >
+    const const_entity& const_component<T>::owner() const noexcept {
+        return owner_;
+    }
+
+    template < typename T >
+    bool const_component<T>::valid() const noexcept {
+        return owner_.valid();
+    }
+
+    template < typename T >
+    bool const_component<T>::exists() const noexcept {
+        return std::as_const(owner_).template exists_component<T>();
+    }
+
+    template < typename T >
+    const T& const_component<T>::get() const {
+        return std::as_const(owner_).template get_component<T>();
+    }
+
+    template < typename T >
+    const T* const_component<T>::find() const noexcept {
+        return std::as_const(owner_).template find_component<T>();
+    }
+
+    template < typename T >
+    const T& const_component<T>::operator*() const {
+        return get();
+    }
+
+    template < typename T >
+    const T* const_component<T>::operator->() const noexcept {
+        return find();
+    }
+
+    template < typename T >
+    const_component<T>::operator bool() const noexcept {
+        return exists();
+    }
+
+    template < typename T >
+    bool operator<(const const_component<T>& l, const const_component<T>& r) noexcept {
+        return l.owner() < r.owner();
+    }
+
+    template < typename T >
+    bool operator==(const const_component<T>& l, const component<T>& r) noexcept {
+        return l.owner() == r.owner();
+    }
+
+    template < typename T >
+    bool operator==(const const_component<T>& l, const const_component<T>& r) noexcept {
+        return l.owner() == r.owner();
+    }
+
+    template < typename T >
+    bool operator!=(const const_component<T>& l, const component<T>& r) noexcept {
+        return !(l == r);
+    }
+
+    template < typename T >
+    bool operator!=(const const_component<T>& l, const const_component<T>& r) noexcept {
+        return !(l == r);
+    }
+}
+
+// -----------------------------------------------------------------------------
+//
+// prototype impl
+//
+// -----------------------------------------------------------------------------
+
+namespace ecs_hpp
+{
+    namespace detail
+    {
+        template < typename T, typename... Args >
+        typed_applier_with_args<T, Args...>::typed_applier_with_args(std::tuple<Args...>&& args)
+        : args_(std::move(args)) {}
+
+        template < typename T, typename... Args >
+        typed_applier_with_args<T, Args...>::typed_applier_with_args(const std::tuple<Args...>& args)
+        : args_(args) {}
+
+        template < typename T, typename... Args >
+        void typed_applier_with_args<T, Args...>::apply_to_entity(entity& ent, bool override) const {
+            std::apply([&ent, override](const Args&... args){
+                if ( override || !ent.exists_component<T>() ) {
+                    ent.assign_component<T>(args...);
+                }
+            }, args_);
+        }
+
+        template < typename T, typename... Args >
+        void typed_applier_with_args<T, Args...>::compile_to(compiled_prototype& compiled) const {
+            std::apply([&compiled](const Args&... args){
+                compiled.component<T>(args...);
+            }, args_);
+        }
+
+        template < typename T, typename... Args >
+        void typed_applier_with_args<T, Args...>::apply_to_component(T& component) const {
+            std::apply([&component](const Args&... args){
+                component = T{args...};
+            }, args_);
+        }
+
+        template < typename T >
+        shared_applier<T>::shared_applier(T value)
+        : value_(std::move(value)) {}
+
+        template < typename T >
+        void shared_applier<T>::apply_to_entity(entity& ent, bool override) const {
+            registry& owner = ent.owner();
+            if ( override || !owner.exists_shared_component<T>(ent) ) {
+                owner.assign_shared_component<T>(ent, value_);
+            }
+        }
+
+        template < typename T >
+        void shared_applier<T>::compile_to(compiled_prototype& compiled) const {
+            compiled.shared_component<T>(value_);
+        }
+    }
+
+    inline prototype::prototype(std::shared_ptr<const prototype> parent)
+    : parent_(std::move(parent)) {}
+
+    inline prototype::prototype(std::pmr::memory_resource* resource)
+    : appliers_(resource) {}
+
+    inline prototype::prototype(const prototype& other)
+    : appliers_(other.appliers_)
+    , parent_(other.parent_)
+    , resolved_appliers_cache_(std::atomic_load(&other.resolved_appliers_cache_)) {}
+
+    inline prototype& prototype::operator=(const prototype& other) {
+        if ( this != &other ) {
+            prototype p(other);
+            swap(p);
+        }
+        return *this;
+    }
+
+    inline prototype::prototype(prototype&& other) noexcept
+    : appliers_(std::move(other.appliers_))
+    , parent_(std::move(other.parent_))
+    , resolved_appliers_cache_(std::move(other.resolved_appliers_cache_)) {}
+
+    inline prototype& prototype::operator=(prototype&& other) noexcept {
+        if ( this != &other ) {
+            swap(other);
+            other.clear();
+        }
+        return *this;
+    }
+
+    inline void prototype::clear() noexcept {
+        appliers_.clear();
+        parent_.reset();
+        reset_resolved_appliers_();
+    }
+
+    inline bool prototype::empty() const noexcept {
+        return appliers_.empty()
+            && (!parent_ || parent_->empty());
+    }
+
+    inline void prototype::swap(prototype& other) noexcept {
+        using std::swap;
+        swap(appliers_, other.appliers_);
+        swap(parent_, other.parent_);
+        swap(resolved_appliers_cache_, other.resolved_appliers_cache_);
+    }
+
+    inline const std::shared_ptr<const prototype>& prototype::parent() const noexcept {
+        return parent_;
+    }
+
+    inline std::pmr::memory_resource* prototype::resource() const noexcept {
+        return appliers_.resource();
+    }
+
+    inline prototype& prototype::inherit(std::shared_ptr<const prototype> parent) & {
+        assert(parent.get() != this);
+        parent_ = std::move(parent);
+        reset_resolved_appliers_();
+        return *this;
+    }
+
+    inline prototype&& prototype::inherit(std::shared_ptr<const prototype> parent) && {
+        inherit(std::move(parent));
+        return std::move(*this);
+    }
+
+    template < typename T >
+    bool prototype::has_component() const noexcept {
+        const auto family = detail::type_family<T>::id();
+        return appliers_.has(family)
+            || (parent_ && parent_->has_component<T>());
+    }
+
+    template < typename T, typename... Args >
+    prototype& prototype::component(Args&&... args) & {
+        using applier_t = detail::typed_applier_with_args<
+            T,
+            std::decay_t<Args>...>;
+        auto applier = std::allocate_shared<applier_t>(
+            detail::resource_allocator<applier_t>(resource()),
+            std::make_tuple(std::forward<Args>(args)...));
+        const auto family = detail::type_family<T>::id();
+        appliers_.insert_or_assign(family, std::move(applier));
+        reset_resolved_appliers_();
+        return *this;
+    }
+
+    template < typename T, typename... Args >
+    prototype&& prototype::component(Args&&... args) && {
+        component<T>(std::forward<Args>(args)...);
+        return std::move(*this);
+    }
+
+    template < typename T >
+    bool prototype::has_shared_component() const noexcept {
+        const auto family = detail::type_family<detail::shared_applier_tag<T>>::id();
+        return appliers_.has(family)
+            || (parent_ && parent_->has_shared_component<T>());
+    }
+
+    template < typename T, typename... Args >
+    prototype& prototype::shared_component(Args&&... args) & {
+        auto applier = std::allocate_shared<detail::shared_applier<T>>(
+            detail::resource_allocator<detail::shared_applier<T>>(resource()),
+            T{std::forward<Args>(args)...});
+        const auto family = detail::type_family<detail::shared_applier_tag<T>>::id();
+        appliers_.insert_or_assign(family, std::move(applier));
+        reset_resolved_appliers_();
+        return *this;
+    }
+
+    template < typename T, typename... Args >
+    prototype&& prototype::shared_component(Args&&... args) && {
+        shared_component<T>(std::forward<Args>(args)...);
+        return std::move(*this);
+    }
+
+    inline prototype& prototype::merge_with(const prototype& other, bool override) & {
+        const applier_map& own_appliers = resolved_appliers_();
+        const applier_map& other_appliers = other.resolved_appliers_();
+        for ( const auto family : other_appliers ) {
+            if ( override || !own_appliers.has(family) ) {
+                appliers_.insert_or_assign(
+                    family,
+                    other_appliers.get(family));
+            }
+        }
+        reset_resolved_appliers_();
+        return *this;
+    }
+
+    inline prototype&& prototype::merge_with(const prototype& other, bool override) && {
+        merge_with(other, override);
+        return std::move(*this);
+    }
+
+    template < typename T >
+    bool prototype::apply_to_component(T& component) const {
+        const auto family = detail::type_family<T>::id();
+        const auto applier_base_ptr = resolved_appliers_().find(family);
+        if ( !applier_base_ptr ) {
+            return false;
+        }
+        using applier_t = detail::typed_applier<T>;
+        const auto applier = static_cast<const applier_t*>(applier_base_ptr->get());
+        applier->apply_to_component(component);
+        return true;
+    }
+
+    inline void prototype::apply_to_entity(entity& ent, bool override) const {
+        const applier_map& appliers = resolved_appliers_();
+        for ( const auto family : appliers ) {
+            appliers.get(family)->apply_to_entity(ent, override);
+        }
+    }
+
+    inline compiled_prototype prototype::compile(registry& owner) const {
+        compiled_prototype compiled(owner);
+        const applier_map& appliers = resolved_appliers_();
+        for ( const auto family : appliers ) {
+            appliers.get(family)->compile_to(compiled);
+        }
+        return compiled;
+    }
+
+    inline compiled_prototype prototype::capture(entity source) {
+        return capture(source.owner(), source);
+    }
+
+    inline compiled_prototype prototype::capture(registry& owner, const const_entity& source) {
+        compiled_prototype compiled(owner);
+        compiled.capture(source);
+        return compiled;
+    }
+
+    inline const prototype::applier_map& prototype::resolved_appliers_() const {
+        if ( !parent_ ) {
+            return appliers_;
+        }
+        if ( auto cache = std::atomic_load(&resolved_appliers_cache_) ) {
+            return *cache;
+        }
+        auto resolved = std::allocate_shared<applier_map>(
+            detail::resource_allocator<applier_map>(resource()),
+            resource());
+        const applier_map& parent_appliers = parent_->resolved_appliers_();
+        for ( const auto family : parent_appliers ) {
+            resolved->insert(family, parent_appliers.get(family));
+        }
+        for ( const auto family : appliers_ ) {
+            resolved->insert_or_assign(family, appliers_.get(family));
+        }
+        std::shared_ptr<const applier_map> cache = std::move(resolved);
+        std::atomic_store(&resolved_appliers_cache_, cache);
+        return *cache;
+    }
+
+    inline void prototype::reset_resolved_appliers_() noexcept {
+        std::atomic_store(&resolved_appliers_cache_, std::shared_ptr<const applier_map>());
+    }
+
+    inline void swap(prototype& l, prototype& r) noexcept {
+        l.swap(r);
+    }
+}
+
+// -----------------------------------------------------------------------------
+//
+// compiled_prototype impl
+//
+// -----------------------------------------------------------------------------
+
+namespace ecs_hpp
+{
+    inline compiled_prototype::compiled_prototype(registry& owner) noexcept
+    : owner_(&owner)
+    , values_(owner.resource()) {}
+
+    inline registry& compiled_prototype::owner() noexcept {
+        return *owner_;
+    }
+
+    inline const registry& compiled_prototype::owner() const noexcept {
+        return *owner_;
+    }
+
+    inline bool compiled_prototype::empty() const noexcept {
+        return entries_.empty();
+    }
+
+    inline std::size_t compiled_prototype::component_count() const noexcept {
+        return entries_.size();
+    }
+
+    template < typename T, typename... Args >
+    compiled_prototype& compiled_prototype::component(Args&&... args) & {
+        auto& storage = owner_->get_or_create_storage_<T>();
+        if ( replace_entry_<T>(&storage, std::forward<Args>(args)...) ) {
+            return *this;
+        }
+        T* value = values_.create<T>(T{std::forward<Args>(args)...});
+        add_entry_(&storage, value, [](void* s, const entity_id* ids, std::size_t count, const void* v){
+            static_cast<detail::component_storage<T>*>(s)->fill(
+                ids,
+                count,
+                *static_cast<const T*>(v));
+        }, storage.signature_bit());
+        return *this;
+    }
+
+    template < typename T, typename... Args >
+    compiled_prototype&& compiled_prototype::component(Args&&... args) && {
+        component<T>(std::forward<Args>(args)...);
+        return std::move(*this);
+    }
+
+    template < typename T, typename... Args >
+    compiled_prototype& compiled_prototype::shared_component(Args&&... args) & {
+        auto& storage = owner_->get_or_create_shared_<T>();
+        if ( replace_entry_<T>(&storage, std::forward<Args>(args)...) ) {
+            return *this;
+        }
+        T* value = values_.create<T>(T{std::forward<Args>(args)...});
+        add_entry_(&storage, value, [](void* s, const entity_id* ids, std::size_t count, const void* v){
+            static_cast<detail::shared_storage<T>*>(s)->fill(
+                ids,
+                count,
+                *static_cast<const T*>(v));
+        }, 0u);
+        return *this;
+    }
+
+    template < typename T, typename... Args >
+    compiled_prototype&& compiled_prototype::shared_component(Args&&... args) && {
+        shared_component<T>(std::forward<Args>(args)...);
+        return std::move(*this);
+    }
+
+    inline compiled_prototype& compiled_prototype::capture(const const_entity& source) & {
+        assert(source.valid());
+        const registry& from = source.owner();
+        const std::uint64_t signature = from.signatures_.get(source.id());
+        for ( const auto family : from.storage_families_ ) {
+            const detail::component_storage_base* storage = from.storages_[family];
+            const std::uint64_t bit = storage->signature_bit();
+            if ( !bit || (signature & bit) ) {
+                storage->capture(source.id(), *this);
+            }
+        }
+        for ( const auto family : from.shared_families_ ) {
+            from.shared_[family]->capture(source.id(), *this);
+        }
+        return *this;
+    }
+
+    inline compiled_prototype&& compiled_prototype::capture(const const_entity& source) && {
+        capture(source);
+        return std::move(*this);
+    }
+
+    inline void compiled_prototype::apply_to_entity(entity& ent) const {
+        assert(&ent.owner() == owner_);
+        const entity_id id = ent.id();
+        apply_to_entities(&id, 1u);
+    }
+
+    inline void compiled_prototype::apply_to_entities(const entity_id* ids, std::size_t count) const {
+        for ( std::size_t i = 0; i < count; ++i ) {
+            owner_->signatures_.reserve(ids[i]);
+        }
+        // a bit only means "may have", it is set before the fill so that
+        // the rollback after a throwing fill still visits this storage
+        for ( const entry& e : entries_ ) {
+            for ( std::size_t i = 0; i < count; ++i ) {
+                owner_->signatures_.set(ids[i], e.signature_bit);
+            }
+            e.fill(e.storage, ids, count, e.value);
+        }
+        for ( std::size_t i = 0; i < count; ++i ) {
+            if ( owner_->dormant_entities_.has(ids[i]) ) {
+                owner_->set_components_active_(ids[i], false);
+            }
+        }
+    }
+
+    template < typename T, typename... Args >
+    bool compiled_prototype::replace_entry_(const void* storage, Args&&... args) {
+        const auto iter = std::find_if(entries_.begin(), entries_.end(), [storage](const entry& e){
+            return e.storage == storage;
+        });
+        if ( iter == entries_.end() ) {
+            return false;
+        }
+        *static_cast<T*>(iter->value) = T{std::forward<Args>(args)...};
+        return true;
+    }
+
+    inline void compiled_prototype::add_entry_(void* storage, void* value, fill_fn fill, std::uint64_t signature_bit) {
+        entries_.push_back({storage, value, fill, signature_bit});
+    }
+}
+
+namespace ecs_hpp::detail
+{
+    template < typename T, bool E >
+    void component_storage<T, E>::capture(entity_id id, compiled_prototype& compiled) const {
+        if ( const T* c = find(id) ) {
+            compiled.component<T>(*c);
+        }
+    }
+
+    template < typename T >
+    void component_storage<T, true>::capture(entity_id id, compiled_prototype& compiled) const {
+        if ( exists(id) ) {
+            compiled.component<T>();
+        }
+    }
+
+    template < typename T >
+    void shared_storage<T>::capture(entity_id id, compiled_prototype& compiled) const {
+        if ( const T* value = find(id) ) {
+            compiled.shared_component<T>(*value);
+        }
+    }
+}
+
+// -----------------------------------------------------------------------------
+//
+// feature impl
+//
+// -----------------------------------------------------------------------------
+
+namespace ecs_hpp
+{
+    inline feature& feature::enable() & noexcept {
+        std::unique_lock lock(systems_locker_);
+        disabled_ = false;
+        return *this;
+    }
+
+    inline feature&& feature::enable() && noexcept {
+        enable();
+        return std::move(*this);
+    }
+
+    inline feature& feature::disable() & noexcept {
+        std::unique_lock lock(systems_locker_);
+        disabled_ = true;
+        return *this;
+    }
+
+    inline feature&& feature::disable() && noexcept {
+        disable();
+        return std::move(*this);
+    }
+
+    inline bool feature::is_enabled() const noexcept {
+        std::shared_lock lock(systems_locker_);
+        return !disabled_;
+    }
+
+    inline bool feature::is_disabled() const noexcept {
+        std::shared_lock lock(systems_locker_);
+        return disabled_;
+    }
+
+    template < typename T, typename... Args >
+    feature& feature::add_system(Args&&... args) & {
+        std::unique_lock lock(systems_locker_);
+        systems_.push_back(std::make_unique<T>(std::forward<Args>(args)...));
+        return *this;
+    }
+
+    template < typename T, typename... Args >
+    feature&& feature::add_system(Args&&... args) && {
+        add_system<T>(std::forward<Args>(args)...);
+        return std::move(*this);
+    }
+
+    template < typename Event >
+    feature& feature::process_event(registry& owner, const Event& event) {
+        std::shared_lock lock(systems_locker_);
+        const auto fire_event = [this, &owner](const auto& event){
+            for ( const auto& base_system : systems_ ) {
+                using system_type = system<std::decay_t<decltype(event)>>;
+                if ( auto event_system = dynamic_cast<system_type*>(base_system.get()) ) {
+                    event_system->process(owner, event);
+                }
+            }
+        };
+
+        fire_event(before<Event>{event});
+        fire_event(event);
+        fire_event(after<Event>{event});
+
+        return *this;
+    }
+}
+
+// -----------------------------------------------------------------------------
+//
+// runtime_query impl
+//
+// -----------------------------------------------------------------------------
+
+namespace ecs_hpp
+{
+    inline runtime_query& runtime_query::required(family_id family) & {
+        if ( std::find(required_.begin(), required_.end(), family) == required_.end() ) {
+            required_.push_back(family);
+        }
+        return *this;
+    }
+
+    inline runtime_query&& runtime_query::required(family_id family) && {
+        required(family);
+        return std::move(*this);
+    }
+
+    inline runtime_query& runtime_query::excluded(family_id family) & {
+        if ( std::find(excluded_.begin(), excluded_.end(), family) == excluded_.end() ) {
+            excluded_.push_back(family);
+        }
+        return *this;
+    }
+
+    inline runtime_query&& runtime_query::excluded(family_id family) && {
+        excluded(family);
+        return std::move(*this);
+    }
+
+    inline runtime_query& runtime_query::optional(family_id family) & {
+        optional_.push_back(family);
+        return *this;
+    }
+
+    inline runtime_query&& runtime_query::optional(family_id family) && {
+        optional(family);
+        return std::move(*this);
+    }
+
+    inline const std::vector<family_id>& runtime_query::required_families() const noexcept {
+        return required_;
+    }
+
+    inline const std::vector<family_id>& runtime_query::excluded_families() const noexcept {
+        return excluded_;
+    }
+
+    inline const std::vector<family_id>& runtime_query::optional_families() const noexcept {
+        return optional_;
+    }
+
+    inline std::size_t runtime_query::component_count() const noexcept {
+        return required_.size() + optional_.size();
+    }
+}
+
+// -----------------------------------------------------------------------------
+//
+// iteration_cursor impl
+//
+// -----------------------------------------------------------------------------
+
+namespace ecs_hpp
+{
+    inline bool iteration_cursor::in_cycle() const noexcept {
+        return position_ < ids_.size();
+    }
+
+    inline std::size_t iteration_cursor::remaining() const noexcept {
+        return ids_.size() - position_;
+    }
+
+    inline std::size_t iteration_cursor::cycle_count() const noexcept {
+        return cycle_count_;
+    }
+
+    inline void iteration_cursor::reset() noexcept {
+        ids_.clear();
+        position_ = 0u;
+    }
+}
+
+// -----------------------------------------------------------------------------
+//
+// registry impl
+//
+// -----------------------------------------------------------------------------
+
+namespace ecs_hpp
+{
+    //
+    // registry::uentity
+    //
+
+    inline registry::uentity::uentity(registry& owner, entity_id id) noexcept
+    : id_(id)
+    , owner_(&owner) {}
+
+    inline registry::uentity::uentity(entity_id ent) noexcept
+    : id_(ent) {}
+
+    inline registry::uentity::uentity(entity ent) noexcept
+    : id_(ent.id())
+    , owner_(&ent.owner()) {}
+
+    inline registry::uentity::operator entity_id() const noexcept {
+        return id_;
+    }
+
+    inline registry::uentity::operator entity() const noexcept {
+        assert(owner_);
+        return {*owner_, id_};
+    }
+
+    inline registry::uentity::operator const_entity() const noexcept {
+        assert(owner_);
+        return {*owner_, id_};
+    }
+
+    inline entity_id registry::uentity::id() const noexcept {
+        return id_;
+    }
+
+    inline registry* registry::uentity::owner() noexcept {
+        return owner_;
+    }
+
+    inline const registry* registry::uentity::owner() const noexcept {
+        return owner_;
+    }
+
+    inline bool registry::uentity::check_owner(const registry* owner) const noexcept {
+        return !owner_ || owner_ == owner;
+    }
+
+    //
+    // registry::const_uentity
+    //
+
+    inline registry::const_uentity::const_uentity(const registry& owner, entity_id id) noexcept
+    : id_(id)
+    , owner_(&owner) {}
+
+    inline registry::const_uentity::const_uentity(entity_id ent) noexcept
+    : id_(ent) {}
+
+    inline registry::const_uentity::const_uentity(entity ent) noexcept
+    : id_(ent.id())
+    , owner_(&ent.owner()) {}
+
+    inline registry::const_uentity::const_uentity(const_entity ent) noexcept
+    : id_(ent.id())
+    , owner_(&ent.owner()) {}
+
+    inline registry::const_uentity::const_uentity(const uentity& ent) noexcept
+    : id_(ent.id())
+    , owner_(ent.owner()) {}
+
+    inline registry::const_uentity::operator entity_id() const noexcept {
+        return id_;
+    }
+
+    inline registry::const_uentity::operator const_entity() const noexcept {
+        assert(owner_);
+        return {*owner_, id_};
+    }
+
+    inline entity_id registry::const_uentity::id() const noexcept {
+        return id_;
+    }
+
+    inline const registry* registry::const_uentity::owner() const noexcept {
+        return owner_;
+    }
+
+    inline bool registry::const_uentity::check_owner(const registry* owner) const noexcept {
+        return !owner_ || owner_ == owner;
+    }
+
+    //
+    // registry
+    //
+
+    inline registry::registry(std::pmr::memory_resource* resource)
+    : free_entity_ids_(resource)
+    , entity_ids_(resource)
+    , dormant_entities_(resource)
+    , schedule_(resource)
+    , storages_arena_(resource)
+    , signatures_(resource)
+    , hierarchy_(resource) {}
+
+    inline entity registry::wrap_entity(const const_uentity& ent) noexcept {
+        return {*this, ent.id()};
+    }
+
+    inline const_entity registry::wrap_entity(const const_uentity& ent) const noexcept {
+        return {*this, ent.id()};
+    }
+
+    template < typename T >
+    component<T> registry::wrap_component(const const_uentity& ent) noexcept {
+        return component<T>{wrap_entity(ent)};
+    }
+
+    template < typename T >
+    const_component<T> registry::wrap_component(const const_uentity& ent) const noexcept {
+        return const_component<T>{wrap_entity(ent)};
+    }
+
+    inline entity registry::create_entity() {
+        std::unique_lock lock(mutexes_.entity_ids_locker_);
+        if ( !free_entity_ids_.empty() ) {
+            const auto free_ent_id = free_entity_ids_.back();
+            const auto new_ent_id = detail::upgrade_entity_id(free_ent_id);
+            entity_ids_.insert(new_ent_id);
+            free_entity_ids_.pop_back();
+            return wrap_entity(new_ent_id);
+
+        }
+        if ( last_entity_id_ >= detail::entity_id_index_mask ) {
+            detail::throw_logic_error("ecs_hpp::registry (entity index overlow)");
+        }
+        if ( free_entity_ids_.capacity() <= entity_ids_.size() ) {
+            // ensure free entity ids capacity for safe (noexcept) entity destroying
+            free_entity_ids_.reserve(detail::next_capacity_size(
+                free_entity_ids_.capacity(),
+                entity_ids_.size() + 1,
+                free_entity_ids_.max_size()));
+        }
+        entity_ids_.insert(last_entity_id_ + 1);
+        return wrap_entity(++last_entity_id_);
+    }
+
+    inline entity registry::create_entity(const prototype& proto) {
+        auto ent = create_entity();
+        ECS_HPP_TRY {
+            proto.apply_to_entity(ent, true);
+        } ECS_HPP_CATCH_ALL {
+            destroy_entity(ent);
+            ECS_HPP_RETHROW;
+        }
+        return ent;
+    }
+
+    inline entity registry::create_entity(const compiled_prototype& proto) {
+        assert(&proto.owner() == this);
+        auto ent = create_entity();
+        ECS_HPP_TRY {
+            proto.apply_to_entity(ent);
+        } ECS_HPP_CATCH_ALL {
+            destroy_entity(ent);
+            ECS_HPP_RETHROW;
+        }
+        return ent;
+    }
+
+    template < typename OutputIt >
+    OutputIt registry::instantiate(const prototype& proto, std::size_t count, OutputIt out) {
+        return instantiate(proto.compile(*this), count, out);
+    }
+
+    template < typename OutputIt >
+    OutputIt registry::instantiate(const compiled_prototype& proto, std::size_t count, OutputIt out) {
+        assert(&proto.owner() == this);
+        std::vector<entity_id> ids;
+        create_entities_(count, ids);
+        ECS_HPP_TRY {
+            proto.apply_to_entities(ids.data(), ids.size());
+        } ECS_HPP_CATCH_ALL {
+            for ( const entity_id id : ids ) {
+                destroy_entity(wrap_entity(id));
+            }
+            ECS_HPP_RETHROW;
+        }
+        for ( const entity_id id : ids ) {
+            *out = wrap_entity(id);
+            ++out;
+        }
+        return out;
+    }
+
+    inline entity registry::create_entity(const const_uentity& proto) {
+        assert(valid_entity(proto));
+        entity ent = create_entity();
+        ECS_HPP_TRY {
+            signatures_.reserve(ent.id());
+            const std::uint64_t signature = signatures_.get(proto);
+            for ( const auto family : storage_families_ ) {
+                const std::uint64_t bit = storages_[family]->signature_bit();
+                if ( !bit || (signature & bit) ) {
+                    signatures_.set(ent.id(), bit);
+                    storages_[family]->clone(proto, ent.id());
+                }
+            }
+            for ( const auto family : shared_families_ ) {
+                shared_[family]->clone(proto, ent.id());
+            }
+            for ( const auto family : buffered_families_ ) {
+                buffered_[family]->clone(proto, ent.id());
+            }
+        } ECS_HPP_CATCH_ALL {
+            destroy_entity(ent);
+            ECS_HPP_RETHROW;
+        }
+        return ent;
+    }
+
+    inline void registry::reserve_entities(std::size_t count) {
+        if ( count > detail::entity_id_index_mask ) {
+            detail::throw_logic_error("ecs_hpp::registry (entity index overlow)");
+        }
+        std::unique_lock lock(mutexes_.entity_ids_locker_);
+        if ( free_entity_ids_.capacity() < count ) {
+            free_entity_ids_.reserve(count);
+        }
+        if ( entity_ids_.capacity() < count ) {
+            entity_ids_.reserve(count);
+        }
+        entity_ids_.reserve_indices(count + 1u);
+        signatures_.reserve_indices(count + 1u);
+    }
+
+    template < typename T >
+    void registry::reserve_components(std::size_t count) {
+        get_or_create_storage_<T>().reserve(count, entity_ids_.index_capacity());
+    }
+
+    inline status registry::try_create_entity(entity& ent) noexcept {
+        std::unique_lock lock(mutexes_.entity_ids_locker_);
+        if ( free_entity_ids_.capacity() <= entity_ids_.size() ) {
+            return status::entity_capacity_exhausted;
+        }
+        if ( !free_entity_ids_.empty() ) {
+            const auto new_ent_id = detail::upgrade_entity_id(free_entity_ids_.back());
+            if ( !entity_ids_.fits(new_ent_id) ) {
+                return status::entity_capacity_exhausted;
+            }
+            entity_ids_.insert(new_ent_id);
+            free_entity_ids_.pop_back();
+            ent = wrap_entity(new_ent_id);
+            return status::ok;
+        }
+        if ( last_entity_id_ >= detail::entity_id_index_mask
+            || !entity_ids_.fits(last_entity_id_ + 1u) )
+        {
+            return status::entity_capacity_exhausted;
+        }
+        entity_ids_.insert(last_entity_id_ + 1u);
+        ent = wrap_entity(++last_entity_id_);
+        return status::ok;
+    }
+
+    template < typename T, typename... Args >
+    status registry::try_assign_component(const uentity& ent, Args&&... args)
+        noexcept(std::is_nothrow_constructible_v<T, Args...>
+            && std::is_nothrow_move_constructible_v<T>
+            && std::is_nothrow_move_assignable_v<T>)
+    {
+        assert(valid_entity(ent));
+        detail::component_storage<T>* storage = find_storage_<T>();
+        if ( !storage || !signatures_.reserved(ent) ) {
+            return status::component_capacity_exhausted;
+        }
+        if ( !storage->try_assign(ent, std::forward<Args>(args)...) ) {
+            return status::component_capacity_exhausted;
+        }
+        signatures_.set(ent, storage->signature_bit());
+        settle_component_(*storage, ent);
+        return status::ok;
+    }
+
+    inline void registry::create_entities_(std::size_t count, std::vector<entity_id>& ids) {
+        ids.reserve(count);
+        std::unique_lock lock(mutexes_.entity_ids_locker_);
+        const std::size_t reused_count = std::min(count, free_entity_ids_.size());
+        if ( count - reused_count > detail::entity_id_index_mask - last_entity_id_ ) {
+            detail::throw_logic_error("ecs_hpp::registry (entity index overlow)");
+        }
+        if ( free_entity_ids_.capacity() < entity_ids_.size() + count ) {
+            // ensure free entity ids capacity for safe (noexcept) entity destroying
+            free_entity_ids_.reserve(detail::next_capacity_size(
+                free_entity_ids_.capacity(),
+                entity_ids_.size() + count,
+                free_entity_ids_.max_size()));
+        }
+        if ( entity_ids_.capacity() < entity_ids_.size() + count ) {
+            entity_ids_.reserve(detail::next_capacity_size(
+                entity_ids_.capacity(),
+                entity_ids_.size() + count,
+                free_entity_ids_.max_size()));
+        }
+        ECS_HPP_TRY {
+            while ( ids.size() < reused_count ) {
+                const auto new_ent_id = detail::upgrade_entity_id(free_entity_ids_.back());
+                entity_ids_.insert(new_ent_id);
+                free_entity_ids_.pop_back();
+                ids.push_back(new_ent_id);
+            }
+            while ( ids.size() < count ) {
+                entity_ids_.insert(last_entity_id_ + 1);
+                ids.push_back(++last_entity_id_);
+            }
+        } ECS_HPP_CATCH_ALL {
+            for ( const entity_id id : ids ) {
+                entity_ids_.unordered_erase(id);
+                free_entity_ids_.push_back(id);
+            }
+            ECS_HPP_RETHROW;
+        }
+    }
+
+    inline void registry::destroy_entity(const uentity& ent) noexcept {
+        std::unique_lock lock(mutexes_.entity_ids_locker_);
+        assert(valid_entity(ent));
+        {
+            std::unique_lock hierarchy_lock(mutexes_.hierarchy_locker_);
+            hierarchy_.remove(ent);
+        }
+        release_entity_(ent);
+    }
+
+    inline bool registry::valid_entity(const const_uentity& ent) const noexcept {
+        assert(ent.check_owner(this));
+        return entity_ids_.has(ent);
+    }
+
+    inline bool registry::sleep_entity(const uentity& ent) {
+        std::unique_lock lock(mutexes_.entity_ids_locker_);
+        assert(valid_entity(ent));
+        if ( !dormant_entities_.insert(ent.id()) ) {
+            return false;
+        }
+        set_components_active_(ent, false);
+        return true;
+    }
+
+    inline bool registry::wake_entity(const uentity& ent) noexcept {
+        std::unique_lock lock(mutexes_.entity_ids_locker_);
+        assert(valid_entity(ent));
+        if ( !dormant_entities_.unordered_erase(ent) ) {
+            return false;
+        }
+        set_components_active_(ent, true);
+        return true;
+    }
+
+    inline bool registry::dormant_entity(const const_uentity& ent) const noexcept {
+        assert(valid_entity(ent));
+        return dormant_entities_.has(ent);
+    }
+
+    inline std::size_t registry::dormant_entity_count() const noexcept {
+        std::shared_lock lock(mutexes_.entity_ids_locker_);
+        return dormant_entities_.size();
+    }
+
+    inline void registry::schedule_entity(const uentity& ent, std::uint32_t period) {
+        std::unique_lock lock(mutexes_.entity_ids_locker_);
+        assert(valid_entity(ent));
+        if ( !period ) {
+            detail::throw_logic_error("ecs_hpp::registry (zero update period)");
+        }
+        schedule_.assign(ent, period);
+    }
+
+    inline bool registry::unschedule_entity(const uentity& ent) noexcept {
+        std::unique_lock lock(mutexes_.entity_ids_locker_);
+        assert(valid_entity(ent));
+        return schedule_.remove(ent);
+    }
+
+    inline std::uint32_t registry::scheduled_period(const const_uentity& ent) const noexcept {
+        std::shared_lock lock(mutexes_.entity_ids_locker_);
+        assert(valid_entity(ent));
+        return schedule_.period(ent);
+    }
+
+    template < typename Ent, typename F >
+    void registry::for_each_in_hierarchy_(F&& f) const {
+        // the callback runs on a snapshot without locks, so it may
+        // query or change the hierarchy and destroy entities
+        std::vector<detail::hierarchy_storage::entry> order;
+        {
+            std::unique_lock lock(mutexes_.hierarchy_locker_);
+            const auto& cached = hierarchy_.order();
+            order.assign(cached.begin(), cached.end());
+        }
+        const auto alive = [this](entity_id id){
+            std::shared_lock lock(mutexes_.entity_ids_locker_);
+            return entity_ids_.has(id);
+        };
+        using registry_ref = std::conditional_t<std::is_same_v<Ent, entity>, registry&, const registry&>;
+        registry_ref owner = const_cast<registry&>(*this);
+        for ( const auto& e : order ) {
+            if ( alive(e.id) ) {
+                const entity_id parent = e.parent && alive(e.parent) ? e.parent : 0u;
+                f(Ent{owner, e.id}, Ent{owner, parent});
+            }
+        }
+    }
+
+    inline std::vector<entity_id> registry::scheduled_ids_(std::uint64_t frame) const {
+        std::vector<entity_id> ids;
+        std::shared_lock lock(mutexes_.entity_ids_locker_);
+        schedule_.for_each_due(frame, [&ids](entity_id id){
+            ids.push_back(id);
+        });
+        return ids;
+    }
+
+    inline bool registry::awake_entity_(entity_id ent) const noexcept {
+        std::shared_lock lock(mutexes_.entity_ids_locker_);
+        return entity_ids_.has(ent) && !dormant_entities_.has(ent);
+    }
+
+    inline void registry::release_entity_(entity_id ent) noexcept {
+        remove_all_components(wrap_entity(ent));
+        remove_all_relations(wrap_entity(ent));
+        dormant_entities_.unordered_erase(ent);
+        schedule_.remove(ent);
+        if ( entity_ids_.unordered_erase(ent) ) {
+            assert(free_entity_ids_.size() < free_entity_ids_.capacity());
+            free_entity_ids_.push_back(ent);
+        }
+    }
+
+    inline void registry::set_components_active_(entity_id ent, bool yesno) noexcept {
+        const std::uint64_t signature = signatures_.get(ent);
+        for ( const auto family : storage_families_ ) {
+            const std::uint64_t bit = storages_[family]->signature_bit();
+            if ( !bit || (signature & bit) ) {
+                storages_[family]->set_active(ent, yesno);
+            }
+        }
+    }
+
+    // components assigned to a dormant entity join the dormant suffix
+    inline bool registry::settle_component_(detail::component_storage_base& storage, entity_id ent) noexcept {
+        if ( dormant_entities_.empty() || !dormant_entities_.has(ent) ) {
+            return false;
+        }
+        storage.set_active(ent, false);
+        return true;
+    }
+
+    template < typename T, typename... Args >
+    T& registry::assign_component(const uentity& ent, Args&&... args) {
+        assert(valid_entity(ent));
+        auto& storage = get_or_create_storage_<T>();
+        signatures_.reserve(ent);
+        T* component = &storage.assign(
+            ent,
+            std::forward<Args>(args)...);
+        signatures_.set(ent, storage.signature_bit());
+        if ( settle_component_(storage, ent) ) {
+            component = storage.find(ent);
+        }
+        return *component;
+    }
+
+    template < typename T, typename... Args >
+    T& registry::ensure_component(const uentity& ent, Args&&... args) {
+        assert(valid_entity(ent));
+        auto& storage = get_or_create_storage_<T>();
+        signatures_.reserve(ent);
+        T* component = &storage.ensure(
+            ent,
+            std::forward<Args>(args)...);
+        signatures_.set(ent, storage.signature_bit());
+        if ( settle_component_(storage, ent) ) {
+            component = storage.find(ent);
+        }
+        return *component;
+    }
+
+    template < typename T >
+    bool registry::remove_component(const uentity& ent) noexcept {
+        assert(valid_entity(ent));
+        detail::component_storage<T>* storage = find_storage_<T>();
+        if ( storage && storage->remove(ent) ) {
+            signatures_.reset(ent, storage->signature_bit());
+            return true;
+        }
+        return false;
+    }
+
+    template < typename T >
+    bool registry::exists_component(const const_uentity& ent) const noexcept {
+        assert(valid_entity(ent));
+        const detail::component_storage<T>* storage = find_storage_<T>();
+        return storage
+            ? storage->exists(ent)
+            : false;
+    }
+
+    inline std::size_t registry::remove_all_components(const uentity& ent) noexcept {
+        assert(valid_entity(ent));
+        std::size_t removed_count = 0u;
+        const std::uint64_t signature = signatures_.get(ent);
+        for ( const auto family : storage_families_ ) {
+            const std::uint64_t bit = storages_[family]->signature_bit();
+            if ( bit && !(signature & bit) ) {
+                continue;
+            }
+            if ( storages_[family]->remove(ent) ) {
+                ++removed_count;
+            }
+        }
+        signatures_.clear(ent);
+        for ( const auto family : shared_families_ ) {
+            if ( shared_[family]->remove(ent) ) {
+                ++removed_count;
+            }
+        }
+        for ( const auto family : transient_families_ ) {
+            if ( transients_[family]->remove(ent) ) {
+                ++removed_count;
+            }
+        }
+        for ( const auto family : buffered_families_ ) {
+            if ( buffered_[family]->remove(ent) ) {
+                ++removed_count;
+            }
+        }
+        return removed_count;
+    }
+
+    template < typename T >
+    std::size_t registry::remove_all_components() noexcept {
+        detail::component_storage<T>* storage = find_storage_<T>();
+        return storage
+            ? storage->remove_all()
+            : 0u;
+    }
+
+    template < typename T >
+    bool registry::enable_component(const uentity& ent) {
+        assert(valid_entity(ent));
+        detail::component_storage<T>* storage = find_storage_<T>();
+        return storage
+            ? storage->set_enabled(ent, true)
+            : false;
+    }
+
+    template < typename T >
+    bool registry::disable_component(const uentity& ent) {
+        assert(valid_entity(ent));
+        detail::component_storage<T>* storage = find_storage_<T>();
+        return storage
+            ? storage->set_enabled(ent, false)
+            : false;
+    }
+
+    template < typename T >
+    bool registry::enabled_component(const const_uentity& ent) const noexcept {
+        assert(valid_entity(ent));
+        const detail::component_storage<T>* storage = find_storage_<T>();
+        return storage
+            ? storage->has_enabled(ent)
+            : false;
+    }
+
+    inline bool registry::enable_component(const uentity& ent, family_id family) {
+        assert(valid_entity(ent));
+        detail::component_storage_base* storage = find_storage_(family);
+        return storage
+            ? storage->set_enabled(ent, true)
+            : false;
+    }
+
+    inline bool registry::disable_component(const uentity& ent, family_id family) {
+        assert(valid_entity(ent));
+        detail::component_storage_base* storage = find_storage_(family);
+        return storage
+            ? storage->set_enabled(ent, false)
+            : false;
+    }
+
+    inline bool registry::enabled_component(const const_uentity& ent, family_id family) const noexcept {
+        assert(valid_entity(ent));
+        const detail::component_storage_base* storage = find_storage_(family);
+        return storage
+            ? storage->has_enabled(ent)
+            : false;
+    }
+
+    inline family_id registry::register_component(const runtime_component_info& info) {
+        const family_id family = detail::type_family_base<>::next_id();
+        create_storage_<detail::runtime_component_storage>(family, info, resource());
+        return family;
+    }
+
+    inline void* registry::assign_component(const uentity& ent, family_id family, const void* src) {
+        assert(valid_entity(ent));
+        if ( detail::component_storage_base* storage = find_storage_(family) ) {
+            signatures_.reserve(ent);
+            void* component = storage->assign_raw(ent, src);
+            signatures_.set(ent, storage->signature_bit());
+            if ( settle_component_(*storage, ent) ) {
+                component = storage->find_raw(ent);
+            }
+            return component;
+        }
+        detail::throw_logic_error("ecs_hpp::registry (component family not registered)");
+    }
+
+    inline bool registry::remove_component(const uentity& ent, family_id family) noexcept {
+        assert(valid_entity(ent));
+        detail::component_storage_base* storage = find_storage_(family);
+        if ( storage && storage->remove(ent) ) {
+            signatures_.reset(ent, storage->signature_bit());
+            return true;
+        }
+        return false;
+    }
+
+    inline bool registry::exists_component(const const_uentity& ent, family_id family) const noexcept {
+        assert(valid_entity(ent));
+        const detail::component_storage_base* storage = find_storage_(family);
+        return storage
+            ? storage->has(ent)
+            : false;
+    }
+
+    inline void* registry::find_component(const uentity& ent, family_id family) noexcept {
+        assert(valid_entity(ent));
+        detail::component_storage_base* storage = find_storage_(family);
+        return storage
+            ? storage->find_raw(ent)
+            : nullptr;
+    }
+
+    inline const void* registry::find_component(const const_uentity& ent, family_id family) const noexcept {
+        assert(valid_entity(ent));
+        const detail::component_storage_base* storage = find_storage_(family);
+        return storage
+            ? storage->find_raw(ent)
+            : nullptr;
+    }
+
+    template < typename T >
+    T& registry::get_component(const uentity& ent) {
+        assert(valid_entity(ent));
+        if ( T* component = find_component<T>(ent) ) {
+            return *component;
+        }
+        detail::throw_logic_error("ecs_hpp::registry (component not found)");
+    }
+
+    template < typename T >
+    const T& registry::get_component(const const_uentity& ent) const {
+        assert(valid_entity(ent));
+        if ( const T* component = find_component<T>(ent) ) {
+            return *component;
+        }
+        detail::throw_logic_error("ecs_hpp::registry (component not found)");
+    }
+
+    template < typename T >
+    T* registry::find_component(const uentity& ent) noexcept {
+        assert(valid_entity(ent));
+        detail::component_storage<T>* storage = find_storage_<T>();
+        return storage
+            ? storage->find(ent)
+            : nullptr;
+    }
+
+    template < typename T >
+    const T* registry::find_component(const const_uentity& ent) const noexcept {
+        assert(valid_entity(ent));
+        const detail::component_storage<T>* storage = find_storage_<T>();
+        return storage
+            ? storage->find(ent)
+            : nullptr;
+    }
+
+    template < typename... Ts >
+    std::tuple<Ts&...> registry::get_components(const uentity& ent) {
+        (void)ent;
+        assert(valid_entity(ent));
+        return std::make_tuple(std::ref(get_component<Ts>(ent))...);
+    }
+
+    template < typename... Ts >
+    std::tuple<const Ts&...> registry::get_components(const const_uentity& ent) const {
+        (void)ent;
+        assert(valid_entity(ent));
+        return std::make_tuple(std::cref(get_component<Ts>(ent))...);
+    }
+
+    template < typename... Ts >
+    std::tuple<Ts*...> registry::find_components(const uentity& ent) noexcept {
+        (void)ent;
+        assert(valid_entity(ent));
+        return std::make_tuple(find_component<Ts>(ent)...);
+    }
+
+    template < typename... Ts >
+    std::tuple<const Ts*...> registry::find_components(const const_uentity& ent) const noexcept {
+        (void)ent;
+        assert(valid_entity(ent));
+        return std::make_tuple(find_component<Ts>(ent)...);
+    }
+
+    template < typename T >
+    void registry::enable_seqlock_reads() {
+        static_assert(
+            std::is_trivially_copyable_v<T> && !std::is_empty_v<T>,
+            "seqlock reads require trivially copyable non-empty components");
+        get_or_create_storage_<T>().enable_seqlock(sizeof(T));
+    }
+
+    template < typename T >
+    bool registry::seqlock_reads_enabled() const noexcept {
+        const detail::component_storage<T>* storage = find_storage_<T>();
+        return storage && storage->seqlocked();
+    }
+
+    template < typename T >
+    std::optional<T> registry::read_component(const const_uentity& ent) const noexcept {
+        static_assert(std::is_trivially_copyable_v<T> && !std::is_empty_v<T>);
+        const detail::component_storage<T>* storage = find_storage_<T>();
+        alignas(T) std::byte buffer[sizeof(T)];
+        if ( !storage || !storage->read_seqlocked(ent, buffer) ) {
+            return std::nullopt;
+        }
+        return *std::launder(reinterpret_cast<const T*>(buffer));
+    }
+
+    template < typename T >
+    void registry::publish_components() noexcept {
+        if ( detail::component_storage<T>* storage = find_storage_<T>() ) {
+            storage->publish_seqlocked();
+        }
+    }
+
+    template < typename T >
+    std::size_t registry::component_count() const noexcept {
+        const detail::component_storage<T>* storage = find_storage_<T>();
+        return storage
+            ? storage->count()
+            : 0u;
+    }
+
+    inline std::size_t registry::component_count(family_id family) const noexcept {
+        const detail::component_storage_base* storage = find_storage_(family);
+        return storage
+            ? storage->count()
+            : 0u;
+    }
+
+    inline std::size_t registry::entity_count() const noexcept {
+        return entity_ids_.size();
+    }
+
+    inline std::size_t registry::entity_component_count(const const_uentity& ent) const noexcept {
+        assert(valid_entity(ent));
+        std::size_t component_count = 0u;
+        for ( const auto family : storage_families_ ) {
+            if ( storages_[family]->has(ent) ) {
+                ++component_count;
+            }
+        }
+        for ( const auto family : shared_families_ ) {
+            if ( shared_[family]->has(ent) ) {
+                ++component_count;
+            }
+        }
+        for ( const auto family : transient_families_ ) {
+            if ( transients_[family]->has(ent) ) {
+                ++component_count;
+            }
+        }
+        for ( const auto family : buffered_families_ ) {
+            if ( buffered_[family]->has(ent) ) {
+                ++component_count;
+            }
+        }
+        return component_count;
+    }
+
+    template < typename F, typename... Opts >
+    void registry::for_each_entity(F&& f, Opts&&... opts) {
+        std::unique_lock lock(mutexes_.entity_ids_locker_);
+        for ( const auto e : entity_ids_ ) {
+            if ( uentity ent{*this, e}; (... && opts(ent)) ) {
+                f(ent);
+            }
         }
-    };
+    }
 
-    template < typename... Ts >
-    class exists_any final {
-    public:
-        bool operator()(const const_entity& e) const {
-            return (... || e.exists_component<Ts>());
+    template < typename F, typename... Opts >
+    void registry::for_each_entity(F&& f, Opts&&... opts) const {
+        std::shared_lock lock(mutexes_.entity_ids_locker_);
+        for ( const auto e : entity_ids_ ) {
+            if ( const_uentity ent{*this, e}; (... && opts(ent)) ) {
+                f(ent);
+            }
         }
-    };
+    }
 
-    template < typename... Ts >
-    class exists_all final {
-    public:
-        bool operator()(const const_entity& e) const {
-            return (... && e.exists_component<Ts>());
+    template < typename T, typename F, typename... Opts >
+    void registry::for_each_component(F&& f, Opts&&... opts) {
+        if ( detail::component_storage<T>* storage = find_storage_<T>() ) {
+            storage->for_each_component([this, &f, &opts...](const entity_id e, T& t){
+                if ( uentity ent{*this, e}; (... && opts(ent)) ) {
+                    f(ent, t);
+                }
+            });
         }
-    };
-
-    //
-    // combinators
-    //
-
-    template < typename T >
-    class option_neg final {
-    public:
-        option_neg(T opt)
-        : opt_(std::move(opt)) {}
+    }
 
-        bool operator()(const const_entity& e) const {
-            return !opt_(e);
+    template < typename T, typename F, typename... Opts >
+    void registry::for_each_component(F&& f, Opts&&... opts) const {
+        if ( const detail::component_storage<T>* storage = find_storage_<T>() ) {
+            storage->for_each_component([this, &f, &opts...](const entity_id e, const T& t){
+                if ( const_uentity ent{*this, e}; (... && opts(ent)) ) {
+                    f(ent, t);
+                }
+            });
         }
-    private:
-        T opt_;
-    };
-
-    template < typename... Ts >
-    class option_conj final {
-    public:
-        option_conj(Ts... opts)
-        : opts_(std::make_tuple(std::move(opts)...)) {}
+    }
 
-        bool operator()(const const_entity& e) const {
-            return std::apply([&e](auto&&... opts){
-                return (... && opts(e));
-            }, opts_);
+    template < typename F, typename... Opts >
+    void registry::for_each_component(family_id family, F&& f, Opts&&... opts) {
+        if ( detail::component_storage_base* storage = find_storage_(family) ) {
+            std::unique_lock lock(storage->locker());
+            const auto view = storage->dense_view();
+            storage->for_each_enabled_index([this, &view, &f, &opts...](std::size_t i){
+                if ( uentity ent{*this, view.ids[i]}; (... && opts(ent)) ) {
+                    f(ent, static_cast<void*>(view.components + i * view.stride));
+                }
+            });
         }
-    private:
-        std::tuple<Ts...> opts_;
-    };
-
-    template < typename... Ts >
-    class option_disj final {
-    public:
-        option_disj(Ts... opts)
-        : opts_(std::make_tuple(std::move(opts)...)) {}
+    }
 
-        bool operator()(const const_entity& e) const {
-            return std::apply([&e](auto&&... opts){
-                return (... || opts(e));
-            }, opts_);
+    template < typename F, typename... Opts >
+    void registry::for_each_component(family_id family, F&& f, Opts&&... opts) const {
+        if ( const detail::component_storage_base* storage = find_storage_(family) ) {
+            std::shared_lock lock(storage->locker());
+            const auto view = storage->dense_view();
+            storage->for_each_enabled_index([this, &view, &f, &opts...](std::size_t i){
+                if ( const_uentity ent{*this, view.ids[i]}; (... && opts(ent)) ) {
+                    f(ent, static_cast<const void*>(view.components + i * view.stride));
+                }
+            });
         }
-    private:
-        std::tuple<Ts...> opts_;
-    };
+    }
 
-    class option_bool final {
-    public:
-        option_bool(bool b)
-        : bool_(b) {}
+    template < typename T >
+    std::size_t registry::component_chunk_count(std::size_t chunk_size) const noexcept {
+        assert(chunk_size > 0u);
+        const detail::component_storage<T>* storage = find_storage_<T>();
+        return storage
+            ? (storage->active_count() + chunk_size - 1u) / chunk_size
+            : 0u;
+    }
 
-        bool operator()(const const_entity& e) const {
-            (void)e;
-            return bool_;
+    // chunks take the storage locker shared, they touch disjoint slots
+    template < typename T, typename F, typename... Opts >
+    void registry::for_each_component_chunk(std::size_t chunk, std::size_t chunk_size, F&& f, Opts&&... opts) {
+        if ( detail::component_storage<T>* storage = find_storage_<T>() ) {
+            std::shared_lock lock(storage->locker());
+            const auto view = storage->dense_view();
+            storage->for_each_enabled_index(chunk * chunk_size, (chunk + 1u) * chunk_size, [this, storage, &view, &f, &opts...](std::size_t i){
+                if ( uentity ent{*this, view.ids[i]}; (... && opts(ent)) ) {
+                    f(ent, *reinterpret_cast<T*>(view.components + i * view.stride));
+                    storage->publish_seqlocked_at(view, i);
+                }
+            });
         }
-    private:
-        bool bool_{false};
-    };
+    }
 
-    //
-    // operators
-    //
+    template < typename T, typename F, typename... Opts >
+    void registry::for_each_component_chunk(std::size_t chunk, std::size_t chunk_size, F&& f, Opts&&... opts) const {
+        if ( const detail::component_storage_base* storage = find_storage_<T>() ) {
+            std::shared_lock lock(storage->locker());
+            const auto view = storage->dense_view();
+            storage->for_each_enabled_index(chunk * chunk_size, (chunk + 1u) * chunk_size, [this, &view, &f, &opts...](std::size_t i){
+                if ( const_uentity ent{*this, view.ids[i]}; (... && opts(ent)) ) {
+                    f(ent, *reinterpret_cast<const T*>(view.components + i * view.stride));
+                }
+            });
+        }
+    }
 
-    template < typename A
-             , typename = std::enable_if_t<detail::is_option_v<A>> >
-    option_neg<std::decay_t<A>> operator!(A&& a) {
-        return {std::forward<A>(a)};
+    template < typename T, typename F, typename... Opts >
+    bool registry::for_each_component_budgeted(iteration_cursor& cursor, std::size_t max_items, F&& f, Opts&&... opts) {
+        return for_each_component_budgeted_<uentity, T>(cursor, [max_items](std::size_t visited){
+            return visited < max_items;
+        }, std::forward<F>(f), std::forward<Opts>(opts)...);
     }
 
-    template < typename A, typename B
-             , typename = std::enable_if_t<detail::is_option_v<A>>
-             , typename = std::enable_if_t<detail::is_option_v<B>> >
-    option_conj<std::decay_t<A>, std::decay_t<B>> operator&&(A&& a, B&& b) {
-        return {std::forward<A>(a), std::forward<B>(b)};
+    template < typename T, typename F, typename... Opts >
+    bool registry::for_each_component_budgeted(iteration_cursor& cursor, std::size_t max_items, F&& f, Opts&&... opts) const {
+        return for_each_component_budgeted_<const_uentity, T>(cursor, [max_items](std::size_t visited){
+            return visited < max_items;
+        }, std::forward<F>(f), std::forward<Opts>(opts)...);
     }
 
-    template < typename A, typename B
-             , typename = std::enable_if_t<detail::is_option_v<A>>
-             , typename = std::enable_if_t<detail::is_option_v<B>> >
-    option_disj<std::decay_t<A>, std::decay_t<B>> operator||(A&& a, B&& b) {
-        return {std::forward<A>(a), std::forward<B>(b)};
+    template < typename T, typename F, typename... Opts >
+    bool registry::for_each_component_budgeted(iteration_cursor& cursor, std::chrono::nanoseconds max_time, F&& f, Opts&&... opts) {
+        const auto deadline = std::chrono::steady_clock::now() + max_time;
+        return for_each_component_budgeted_<uentity, T>(cursor, [deadline](std::size_t){
+            return std::chrono::steady_clock::now() < deadline;
+        }, std::forward<F>(f), std::forward<Opts>(opts)...);
     }
-}
 
-// -----------------------------------------------------------------------------
-//
-// aspect
-//
-// -----------------------------------------------------------------------------
+    template < typename T, typename F, typename... Opts >
+    bool registry::for_each_component_budgeted(iteration_cursor& cursor, std::chrono::nanoseconds max_time, F&& f, Opts&&... opts) const {
+        const auto deadline = std::chrono::steady_clock::now() + max_time;
+        return for_each_component_budgeted_<const_uentity, T>(cursor, [deadline](std::size_t){
+            return std::chrono::steady_clock::now() < deadline;
+        }, std::forward<F>(f), std::forward<Opts>(opts)...);
+    }
 
-namespace ecs_hpp
-{
-    template < typename... Ts >
-    class aspect {
-    public:
-        static auto to_option() noexcept {
-            return (option_bool{true} && ... && exists<Ts>{});
+    template < typename F, typename... Opts >
+    void registry::for_queried_components(const runtime_query& query, F&& f, Opts&&... opts) {
+        query_storages_ ss;
+        if ( resolve_query_storages_(query, ss) ) {
+            for_queried_components_impl_<uentity>(ss, [&f](const uentity& e, void* const* cs){
+                f(e, cs);
+            }, std::forward<Opts>(opts)...);
         }
+    }
 
-        static bool match_entity(const const_entity& e) noexcept {
-            return (... && e.exists_component<Ts>());
+    template < typename F, typename... Opts >
+    void registry::for_queried_components(const runtime_query& query, F&& f, Opts&&... opts) const {
+        query_storages_ ss;
+        if ( resolve_query_storages_(query, ss) ) {
+            for_queried_components_impl_<const_uentity>(ss, [&f](const const_uentity& e, void* const* cs){
+                f(e, const_cast<const void* const*>(cs));
+            }, std::forward<Opts>(opts)...);
         }
+    }
 
-        template < typename F, typename... Opts >
-        static void for_each_entity(registry& owner, F&& f, Opts&&... opts) {
-            owner.for_joined_components<Ts...>(
-                [&f](const auto& e, const auto&...){
-                    f(e);
-                }, std::forward<Opts>(opts)...);
+    template < typename... Ts, typename F, typename... Opts >
+    void registry::for_joined_components(F&& f, Opts&&... opts) {
+        using terms = detail::join_terms<Ts...>;
+        const auto ss = std::make_tuple(
+            find_storage_<detail::join_term_component_t<Ts>>()...);
+        if ( !terms::has_required_storages(ss) ) {
+            return;
         }
-
-        template < typename F, typename... Opts >
-        static void for_each_entity(const registry& owner, F&& f, Opts&&... opts) {
-            owner.for_joined_components<Ts...>(
-                [&f](const auto& e, const auto&...){
-                    f(e);
-                }, std::forward<Opts>(opts)...);
+        if constexpr ( terms::has_driver ) {
+            using driver_t = typename terms::driver_type;
+            for_each_component<driver_t>([&f, &ss](const uentity& e, driver_t& d){
+                terms::invoke(e, ss, &d, f);
+            }, std::forward<Opts>(opts)...);
+        } else {
+            for_each_entity([this, &f, &ss](const uentity& e){
+                if ( !dormant_entities_.has(e) ) {
+                    terms::invoke(e, ss, f);
+                }
+            }, std::forward<Opts>(opts)...);
         }
+    }
 
-        template < typename F, typename... Opts >
-        static void for_joined_components(registry& owner, F&& f, Opts&&... opts) {
-            owner.for_joined_components<Ts...>(
-                std::forward<F>(f),
-                std::forward<Opts>(opts)...);
+    template < typename... Ts, typename F, typename... Opts >
+    void registry::for_joined_components(F&& f, Opts&&... opts) const {
+        using terms = detail::join_terms<Ts...>;
+        const auto ss = std::make_tuple(
+            find_storage_<detail::join_term_component_t<Ts>>()...);
+        if ( !terms::has_required_storages(ss) ) {
+            return;
         }
-
-        template < typename F, typename... Opts >
-        static void for_joined_components(const registry& owner, F&& f, Opts&&... opts) {
-            owner.for_joined_components<Ts...>(
-                std::forward<F>(f),
-                std::forward<Opts>(opts)...);
+        if constexpr ( terms::has_driver ) {
+            using driver_t = typename terms::driver_type;
+            for_each_component<driver_t>([&f, &ss](const const_uentity& e, const driver_t& d){
+                terms::invoke(e, ss, &d, f);
+            }, std::forward<Opts>(opts)...);
+        } else {
+            for_each_entity([this, &f, &ss](const const_uentity& e){
+                if ( !dormant_entities_.has(e) ) {
+                    terms::invoke(e, ss, f);
+                }
+            }, std::forward<Opts>(opts)...);
         }
-    };
-}
-
-// -----------------------------------------------------------------------------
-//
-// fillers
-//
-// -----------------------------------------------------------------------------
-
-namespace ecs_hpp
-{
-    class entity_filler final {
-    public:
-        entity_filler(entity& entity) noexcept
-        : entity_(entity) {}
+    }
 
-        template < typename T, typename... Args >
-        entity_filler& component(Args&&... args) {
-            entity_.assign_component<T>(std::forward<Args>(args)...);
-            return *this;
+    template < typename... Ts, typename F, typename... Opts >
+    void registry::for_scheduled_components(std::uint64_t frame, F&& f, Opts&&... opts) {
+        using terms = detail::join_terms<Ts...>;
+        const auto ss = std::make_tuple(
+            find_storage_<detail::join_term_component_t<Ts>>()...);
+        if ( !terms::has_required_storages(ss) ) {
+            return;
         }
-    private:
-        entity& entity_;
-    };
-
-    class registry_filler final {
-    public:
-        registry_filler(registry& registry) noexcept
-        : registry_(registry) {}
-
-        template < typename Tag, typename... Args >
-        registry_filler& feature(Args&&... args) {
-            registry_.assign_feature<Tag>(std::forward<Args>(args)...);
-            return *this;
+        for ( const entity_id id : scheduled_ids_(frame) ) {
+            if ( !awake_entity_(id) ) {
+                continue;
+            }
+            if ( uentity e{*this, id}; (... && opts(e)) ) {
+                if constexpr ( terms::has_driver ) {
+                    if ( auto d = std::get<terms::driver_index>(ss)->find_enabled(id) ) {
+                        terms::invoke(e, ss, d, f);
+                    }
+                } else {
+                    terms::invoke(e, ss, f);
+                }
+            }
         }
-    private:
-        registry& registry_;
-    };
-}
-
-// -----------------------------------------------------------------------------
-//
-// entity impl
-//
-// -----------------------------------------------------------------------------
-
-namespace ecs_hpp
-{
-    inline entity::entity(registry& owner) noexcept
-    : owner_(&owner) {}
-
-    inline entity::entity(registry& owner, entity_id id) noexcept
-    : owner_(&owner)
-    , id_(id) {}
-
-    inline registry& entity::owner() noexcept {
-        return *owner_;
     }
 
-    inline const registry& entity::owner() const noexcept {
-        return *owner_;
+    template < typename... Ts, typename F, typename... Opts >
+    void registry::for_scheduled_components(std::uint64_t frame, F&& f, Opts&&... opts) const {
+        using terms = detail::join_terms<Ts...>;
+        const auto ss = std::make_tuple(
+            find_storage_<detail::join_term_component_t<Ts>>()...);
+        if ( !terms::has_required_storages(ss) ) {
+            return;
+        }
+        for ( const entity_id id : scheduled_ids_(frame) ) {
+            if ( !awake_entity_(id) ) {
+                continue;
+            }
+            if ( const_uentity e{*this, id}; (... && opts(e)) ) {
+                if constexpr ( terms::has_driver ) {
+                    if ( auto d = std::get<terms::driver_index>(ss)->find_enabled(id) ) {
+                        terms::invoke(e, ss, d, f);
+                    }
+                } else {
+                    terms::invoke(e, ss, f);
+                }
+            }
+        }
     }
 
-    inline entity_id entity::id() const noexcept {
-        return id_;
+    inline void registry::set_parent(const uentity& child, const uentity& parent) {
+        assert(valid_entity(child));
+        assert(valid_entity(parent));
+        std::unique_lock lock(mutexes_.hierarchy_locker_);
+        if ( !hierarchy_.attach(child, parent) ) {
+            detail::throw_logic_error("ecs_hpp::registry (hierarchy cycle)");
+        }
     }
 
-    inline entity entity::clone() const {
-        return (*owner_).create_entity(id_);
+    inline bool registry::remove_parent(const uentity& child) noexcept {
+        assert(valid_entity(child));
+        std::unique_lock lock(mutexes_.hierarchy_locker_);
+        return hierarchy_.detach(child);
     }
 
-    inline void entity::destroy() noexcept {
-        (*owner_).destroy_entity(id_);
+    inline bool registry::has_parent(const const_uentity& child) const noexcept {
+        assert(valid_entity(child));
+        std::shared_lock lock(mutexes_.hierarchy_locker_);
+        return hierarchy_.parent(child) != 0u;
     }
 
-    inline bool entity::valid() const noexcept {
-        return std::as_const(*owner_).valid_entity(id_);
+    inline entity registry::get_parent(const uentity& child) {
+        assert(valid_entity(child));
+        std::shared_lock lock(mutexes_.hierarchy_locker_);
+        if ( const entity_id parent = hierarchy_.parent(child) ) {
+            return wrap_entity(parent);
+        }
+        detail::throw_logic_error("ecs_hpp::registry (parent not found)");
     }
 
-    template < typename T, typename... Args >
-    T& entity::assign_component(Args&&... args) {
-        return (*owner_).assign_component<T>(
-            id_,
-            std::forward<Args>(args)...);
+    inline const_entity registry::get_parent(const const_uentity& child) const {
+        assert(valid_entity(child));
+        std::shared_lock lock(mutexes_.hierarchy_locker_);
+        if ( const entity_id parent = hierarchy_.parent(child) ) {
+            return wrap_entity(parent);
+        }
+        detail::throw_logic_error("ecs_hpp::registry (parent not found)");
     }
 
-    template < typename T, typename... Args >
-    T& entity::ensure_component(Args&&... args) {
-        return (*owner_).ensure_component<T>(
-            id_,
-            std::forward<Args>(args)...);
+    inline std::size_t registry::child_count(const const_uentity& parent) const noexcept {
+        assert(valid_entity(parent));
+        std::shared_lock lock(mutexes_.hierarchy_locker_);
+        return hierarchy_.child_count(parent);
     }
 
-    template < typename T >
-    bool entity::remove_component() noexcept {
-        return (*owner_).remove_component<T>(id_);
+    inline std::size_t registry::destroy_hierarchy(const uentity& root) {
+        std::vector<entity_id> subtree;
+        std::unique_lock lock(mutexes_.entity_ids_locker_);
+        assert(valid_entity(root));
+        {
+            std::unique_lock hierarchy_lock(mutexes_.hierarchy_locker_);
+            hierarchy_.collect_subtree(root, subtree);
+            hierarchy_.remove_subtree(subtree);
+        }
+        for ( auto iter = subtree.rbegin(); iter != subtree.rend(); ++iter ) {
+            release_entity_(*iter);
+        }
+        return subtree.size();
     }
 
-    template < typename T >
-    bool entity::exists_component() const noexcept {
-        return std::as_const(*owner_).exists_component<T>(id_);
+    template < typename F >
+    void registry::for_each_child(const uentity& parent, F&& f) {
+        assert(valid_entity(parent));
+        std::shared_lock lock(mutexes_.hierarchy_locker_);
+        hierarchy_.for_each_child(parent, [this, &f](entity_id child){
+            f(entity{*this, child});
+        });
     }
 
-    inline std::size_t entity::remove_all_components() noexcept {
-        return (*owner_).remove_all_components(id_);
+    template < typename F >
+    void registry::for_each_child(const const_uentity& parent, F&& f) const {
+        assert(valid_entity(parent));
+        std::shared_lock lock(mutexes_.hierarchy_locker_);
+        hierarchy_.for_each_child(parent, [this, &f](entity_id child){
+            f(const_entity{*this, child});
+        });
     }
 
-    template < typename T >
-    T& entity::get_component() {
-        return (*owner_).get_component<T>(id_);
+    template < typename F >
+    void registry::for_each_in_hierarchy(F&& f) {
+        for_each_in_hierarchy_<entity>(std::forward<F>(f));
     }
 
-    template < typename T >
-    const T& entity::get_component() const {
-        return std::as_const(*owner_).get_component<T>(id_);
+    template < typename F >
+    void registry::for_each_in_hierarchy(F&& f) const {
+        for_each_in_hierarchy_<const_entity>(std::forward<F>(f));
     }
 
     template < typename T >
-    T* entity::find_component() noexcept {
-        return (*owner_).find_component<T>(id_);
+    void registry::sort_components_by_hierarchy() {
+        detail::component_storage<T>* storage = find_storage_<T>();
+        if ( !storage ) {
+            return;
+        }
+        detail::sparse_map<entity_id, std::size_t, detail::entity_id_indexer> ranks;
+        {
+            std::unique_lock lock(mutexes_.hierarchy_locker_);
+            const auto& order = hierarchy_.order();
+            for ( std::size_t i = 0; i < order.size(); ++i ) {
+                ranks.insert(order[i].id, i);
+            }
+        }
+        const std::size_t unranked = std::numeric_limits<std::size_t>::max();
+        storage->sort([&ranks, unranked](entity_id l, entity_id r){
+            const std::size_t* lr = ranks.find(l);
+            const std::size_t* rr = ranks.find(r);
+            const std::size_t li = lr ? *lr : unranked;
+            const std::size_t ri = rr ? *rr : unranked;
+            return li != ri ? li < ri : l < r;
+        });
     }
 
     template < typename T >
-    const T* entity::find_component() const noexcept {
-        return std::as_const(*owner_).find_component<T>(id_);
+    void registry::sort_components_by_id() noexcept {
+        if ( detail::component_storage<T>* storage = find_storage_<T>() ) {
+            storage->sort_by_id();
+        }
     }
 
-    template < typename... Ts >
-    std::tuple<Ts&...> entity::get_components() {
-        return (*owner_).get_components<Ts...>(id_);
+    inline void registry::sort_all_components_by_id() noexcept {
+        for ( const auto family : storage_families_ ) {
+            storages_[family]->sort_by_id();
+        }
     }
 
-    template < typename... Ts >
-    std::tuple<const Ts&...> entity::get_components() const {
-        return std::as_const(*owner_).get_components<Ts...>(id_);
+    template < typename T, typename... Args >
+    const T& registry::assign_shared_component(const uentity& ent, Args&&... args) {
+        assert(valid_entity(ent));
+        return get_or_create_shared_<T>().assign(
+            ent,
+            std::forward<Args>(args)...);
     }
 
-    template < typename... Ts >
-    std::tuple<Ts*...> entity::find_components() noexcept {
-        return (*owner_).find_components<Ts...>(id_);
+    template < typename T, typename F >
+    const T& registry::patch_shared_component(const uentity& ent, F&& f) {
+        assert(valid_entity(ent));
+        detail::shared_storage<T>* storage = find_shared_<T>();
+        if ( const T* value = storage ? storage->patch(ent, std::forward<F>(f)) : nullptr ) {
+            return *value;
+        }
+        detail::throw_logic_error("ecs_hpp::registry (shared component not found)");
     }
 
-    template < typename... Ts >
-    std::tuple<const Ts*...> entity::find_components() const noexcept {
-        return std::as_const(*owner_).find_components<Ts...>(id_);
+    template < typename T >
+    bool registry::remove_shared_component(const uentity& ent) noexcept {
+        assert(valid_entity(ent));
+        detail::shared_storage<T>* storage = find_shared_<T>();
+        return storage
+            ? storage->remove(ent)
+            : false;
     }
 
-    inline std::size_t entity::component_count() const noexcept {
-        return std::as_const(*owner_).entity_component_count(id_);
+    template < typename T >
+    bool registry::exists_shared_component(const const_uentity& ent) const noexcept {
+        assert(valid_entity(ent));
+        const detail::shared_storage<T>* storage = find_shared_<T>();
+        return storage
+            ? storage->has(ent)
+            : false;
     }
 
-    inline bool operator<(const entity& l, const entity& r) noexcept {
-        return (&l.owner() < &r.owner())
-            || (&l.owner() == &r.owner() && l.id() < r.id());
+    template < typename T >
+    const T& registry::get_shared_component(const const_uentity& ent) const {
+        if ( const T* value = find_shared_component<T>(ent) ) {
+            return *value;
+        }
+        detail::throw_logic_error("ecs_hpp::registry (shared component not found)");
     }
 
-    inline bool operator==(const entity& l, const entity& r) noexcept {
-        return &l.owner() == &r.owner()
-            && l.id() == r.id();
+    template < typename T >
+    const T* registry::find_shared_component(const const_uentity& ent) const noexcept {
+        assert(valid_entity(ent));
+        const detail::shared_storage<T>* storage = find_shared_<T>();
+        return storage
+            ? storage->find(ent)
+            : nullptr;
     }
 
-    inline bool operator==(const entity& l, const const_entity& r) noexcept {
-        return &l.owner() == &r.owner()
-            && l.id() == r.id();
+    template < typename T >
+    std::size_t registry::shared_component_count() const noexcept {
+        const detail::shared_storage<T>* storage = find_shared_<T>();
+        return storage
+            ? storage->count()
+            : 0u;
     }
 
-    inline bool operator!=(const entity& l, const entity& r) noexcept {
-        return !(l == r);
+    template < typename T >
+    std::size_t registry::shared_value_count() const noexcept {
+        const detail::shared_storage<T>* storage = find_shared_<T>();
+        return storage
+            ? storage->group_count()
+            : 0u;
     }
 
-    inline bool operator!=(const entity& l, const const_entity& r) noexcept {
-        return !(l == r);
+    template < typename T, typename F, typename... Opts >
+    void registry::for_each_shared_component(F&& f, Opts&&... opts) {
+        if ( detail::shared_storage<T>* storage = find_shared_<T>() ) {
+            storage->for_each_component([this, &f, &opts...](const entity_id e, const T& t){
+                if ( uentity ent{*this, e}; (... && opts(ent)) ) {
+                    f(ent, t);
+                }
+            });
+        }
     }
-}
-
-// -----------------------------------------------------------------------------
-//
-// const_entity impl
-//
-// -----------------------------------------------------------------------------
-
-namespace ecs_hpp
-{
-    inline const_entity::const_entity(const entity& ent) noexcept
-    : owner_(&ent.owner())
-    , id_(ent.id()) {}
 
-    inline const_entity::const_entity(const registry& owner) noexcept
-    : owner_(&owner) {}
+    template < typename T, typename F, typename... Opts >
+    void registry::for_each_shared_component(F&& f, Opts&&... opts) const {
+        if ( const detail::shared_storage<T>* storage = find_shared_<T>() ) {
+            storage->for_each_component([this, &f, &opts...](const entity_id e, const T& t){
+                if ( const_uentity ent{*this, e}; (... && opts(ent)) ) {
+                    f(ent, t);
+                }
+            });
+        }
+    }
 
-    inline const_entity::const_entity(const registry& owner, entity_id id) noexcept
-    : owner_(&owner)
-    , id_(id) {}
+    template < typename T, typename... Args >
+    T& registry::assign_transient_component(const uentity& ent, Args&&... args) {
+        assert(valid_entity(ent));
+        return get_or_create_transient_<T>().assign(
+            ent,
+            std::forward<Args>(args)...);
+    }
 
-    inline const registry& const_entity::owner() const noexcept {
-        return *owner_;
+    template < typename T >
+    bool registry::remove_transient_component(const uentity& ent) noexcept {
+        assert(valid_entity(ent));
+        detail::transient_storage<T>* storage = find_transient_<T>();
+        return storage
+            ? storage->remove(ent)
+            : false;
     }
 
-    inline entity_id const_entity::id() const noexcept {
-        return id_;
+    template < typename T >
+    bool registry::exists_transient_component(const const_uentity& ent) const noexcept {
+        assert(valid_entity(ent));
+        const detail::transient_storage<T>* storage = find_transient_<T>();
+        return storage
+            ? storage->has(ent)
+            : false;
     }
 
-    inline bool const_entity::valid() const noexcept {
-        return (*owner_).valid_entity(id_);
+    template < typename T >
+    T& registry::get_transient_component(const uentity& ent) {
+        if ( T* value = find_transient_component<T>(ent) ) {
+            return *value;
+        }
+        detail::throw_logic_error("ecs_hpp::registry (transient component not found)");
     }
 
     template < typename T >
-    bool const_entity::exists_component() const noexcept {
-        return (*owner_).exists_component<T>(id_);
+    const T& registry::get_transient_component(const const_uentity& ent) const {
+        if ( const T* value = find_transient_component<T>(ent) ) {
+            return *value;
+        }
+        detail::throw_logic_error("ecs_hpp::registry (transient component not found)");
     }
 
     template < typename T >
-    const T& const_entity::get_component() const {
-        return (*owner_).get_component<T>(id_);
+    T* registry::find_transient_component(const uentity& ent) noexcept {
+        assert(valid_entity(ent));
+        detail::transient_storage<T>* storage = find_transient_<T>();
+        return storage
+            ? storage->find(ent)
+            : nullptr;
     }
 
     template < typename T >
-    const T* const_entity::find_component() const noexcept {
-        return (*owner_).find_component<T>(id_);
+    const T* registry::find_transient_component(const const_uentity& ent) const noexcept {
+        assert(valid_entity(ent));
+        const detail::transient_storage<T>* storage = find_transient_<T>();
+        return storage
+            ? storage->find(ent)
+            : nullptr;
     }
 
-    template < typename... Ts >
-    std::tuple<const Ts&...> const_entity::get_components() const {
-        return (*owner_).get_components<Ts...>(id_);
+    template < typename T >
+    std::size_t registry::transient_component_count() const noexcept {
+        const detail::transient_storage<T>* storage = find_transient_<T>();
+        return storage
+            ? storage->count()
+            : 0u;
     }
 
-    template < typename... Ts >
-    std::tuple<const Ts*...> const_entity::find_components() const noexcept {
-        return (*owner_).find_components<Ts...>(id_);
+    template < typename T, typename F, typename... Opts >
+    void registry::for_each_transient_component(F&& f, Opts&&... opts) {
+        if ( detail::transient_storage<T>* storage = find_transient_<T>() ) {
+            storage->for_each_component([this, &f, &opts...](const entity_id e, T& t){
+                if ( uentity ent{*this, e}; (... && opts(ent)) ) {
+                    f(ent, t);
+                }
+            });
+        }
     }
 
-    inline std::size_t const_entity::component_count() const noexcept {
-        return (*owner_).entity_component_count(id_);
+    template < typename T, typename F, typename... Opts >
+    void registry::for_each_transient_component(F&& f, Opts&&... opts) const {
+        if ( const detail::transient_storage<T>* storage = find_transient_<T>() ) {
+            storage->for_each_component([this, &f, &opts...](const entity_id e, const T& t){
+                if ( const_uentity ent{*this, e}; (... && opts(ent)) ) {
+                    f(ent, t);
+                }
+            });
+        }
     }
 
-    inline bool operator<(const const_entity& l, const const_entity& r) noexcept {
-        return (&l.owner() < &r.owner())
-            || (&l.owner() == &r.owner() && l.id() < r.id());
+    template < typename T, typename... Args >
+    T& registry::assign_buffered_component(const uentity& ent, Args&&... args) {
+        assert(valid_entity(ent));
+        return get_or_create_buffered_<T>().assign(
+            ent,
+            std::forward<Args>(args)...);
     }
 
-    inline bool operator==(const const_entity& l, const entity& r) noexcept {
-        return &l.owner() == &r.owner()
-            && l.id() == r.id();
+    template < typename T >
+    bool registry::remove_buffered_component(const uentity& ent) noexcept {
+        assert(valid_entity(ent));
+        detail::buffered_storage<T>* storage = find_buffered_<T>();
+        return storage
+            ? storage->remove(ent)
+            : false;
     }
 
-    inline bool operator==(const const_entity& l, const const_entity& r) noexcept {
-        return &l.owner() == &r.owner()
-            && l.id() == r.id();
+    template < typename T >
+    bool registry::exists_buffered_component(const const_uentity& ent) const noexcept {
+        assert(valid_entity(ent));
+        const detail::buffered_storage<T>* storage = find_buffered_<T>();
+        return storage
+            ? storage->has(ent)
+            : false;
     }
 
-    inline bool operator!=(const const_entity& l, const entity& r) noexcept {
-        return !(l == r);
+    template < typename T >
+    const T& registry::get_buffered_component(const const_uentity& ent) const {
+        if ( const T* value = find_buffered_component<T>(ent) ) {
+            return *value;
+        }
+        detail::throw_logic_error("ecs_hpp::registry (buffered component not found)");
     }
 
-    inline bool operator!=(const const_entity& l, const const_entity& r) noexcept {
-        return !(l == r);
+    template < typename T >
+    const T* registry::find_buffered_component(const const_uentity& ent) const noexcept {
+        assert(valid_entity(ent));
+        const detail::buffered_storage<T>* storage = find_buffered_<T>();
+        return storage
+            ? storage->find_previous(ent)
+            : nullptr;
     }
-}
 
-// -----------------------------------------------------------------------------
-//
-// component impl
-//
-// -----------------------------------------------------------------------------
+    template < typename T >
+    T& registry::get_next_buffered_component(const uentity& ent) {
+        if ( T* value = find_next_buffered_component<T>(ent) ) {
+            return *value;
+        }
+        detail::throw_logic_error("ecs_hpp::registry (buffered component not found)");
+    }
 
-namespace ecs_hpp
-{
     template < typename T >
-    component<T>::component(const entity& owner) noexcept
-    : owner_(owner) {}
+    T* registry::find_next_buffered_component(const uentity& ent) noexcept {
+        assert(valid_entity(ent));
+        detail::buffered_storage<T>* storage = find_buffered_<T>();
+        return storage
+            ? storage->find_next(ent)
+            : nullptr;
+    }
 
     template < typename T >
-    entity& component<T>::owner() noexcept {
-        return owner_;
+    std::size_t registry::buffered_component_count() const noexcept {
+        const detail::buffered_storage<T>* storage = find_buffered_<T>();
+        return storage
+            ? storage->count()
+            : 0u;
+    }
+
+    template < typename T, typename F, typename... Opts >
+    void registry::for_each_buffered_component(F&& f, Opts&&... opts) {
+        if ( detail::buffered_storage<T>* storage = find_buffered_<T>() ) {
+            storage->for_each_component([this, &f, &opts...](const entity_id e, const T& prev, T& next){
+                if ( uentity ent{*this, e}; (... && opts(ent)) ) {
+                    f(ent, prev, next);
+                }
+            });
+        }
+    }
+
+    template < typename T, typename F, typename... Opts >
+    void registry::for_each_buffered_component(F&& f, Opts&&... opts) const {
+        if ( const detail::buffered_storage<T>* storage = find_buffered_<T>() ) {
+            storage->for_each_component([this, &f, &opts...](const entity_id e, const T& prev){
+                if ( const_uentity ent{*this, e}; (... && opts(ent)) ) {
+                    f(ent, prev);
+                }
+            });
+        }
     }
 
     template < typename T >
-    const entity& component<T>::owner() const noexcept {
-        return owner_;
+    void registry::swap_buffers() noexcept(std::is_nothrow_copy_assignable_v<T>) {
+        if ( detail::buffered_storage<T>* storage = find_buffered_<T>() ) {
+            storage->swap_buffers();
+        }
     }
 
-    template < typename T >
-    bool component<T>::valid() const noexcept {
-        return owner_.valid();
+    inline void registry::end_frame() noexcept {
+        for ( const auto family : transient_families_ ) {
+            transients_[family]->clear();
+        }
+        for ( const auto family : storage_families_ ) {
+            storages_[family]->publish_seqlocked();
+        }
+        if ( deterministic_ ) {
+            sort_all_components_by_id();
+        }
     }
 
-    template < typename T >
-    bool component<T>::exists() const noexcept {
-        return owner_.exists_component<T>();
+    inline void registry::set_deterministic(bool yesno) noexcept {
+        deterministic_ = yesno;
     }
 
-    template < typename T >
-    template < typename... Args >
-    T& component<T>::assign(Args&&... args) {
-        return owner_.assign_component<T>(std::forward<Args>(args)...);
+    inline bool registry::is_deterministic() const noexcept {
+        return deterministic_;
     }
 
-    template < typename T >
-    template < typename... Args >
-    T& component<T>::ensure(Args&&... args) {
-        return owner_.ensure_component<T>(std::forward<Args>(args)...);
+    inline std::uint64_t registry::entity_state_hash() const noexcept {
+        std::shared_lock lock(mutexes_.entity_ids_locker_);
+        std::uint64_t hash = detail::mix_hash(static_cast<std::uint64_t>(entity_ids_.size()));
+        for ( const entity_id id : entity_ids_ ) {
+            hash += detail::mix_hash(id);
+        }
+        return hash;
     }
 
-    template < typename T >
-    bool component<T>::remove() noexcept {
-        return owner_.remove_component<T>();
+    template < typename T, typename Hash >
+    std::uint64_t registry::component_state_hash(Hash&& hash) const {
+        static_assert(
+            std::is_same_v<std::invoke_result_t<Hash&, const T&>, std::uint64_t>,
+            "ecs_hpp::registry (component state hashers must return std::uint64_t)");
+        const detail::component_storage_base* storage = find_storage_<T>();
+        if ( !storage ) {
+            return 0u;
+        }
+        std::shared_lock lock(storage->locker());
+        const auto view = storage->dense_view();
+        std::uint64_t state = detail::mix_hash(static_cast<std::uint64_t>(view.size));
+        for ( std::size_t i = 0; i < view.size; ++i ) {
+            const T& c = *reinterpret_cast<const T*>(view.components + i * view.stride);
+            const std::uint64_t slot = std::uint64_t{view.ids[i]}
+                | (std::uint64_t{!storage->disabled_at(i)} << 63u)
+                | (std::uint64_t{storage->dormant_at(i)} << 62u);
+            state += detail::mix_hash(detail::mix_hash(slot) ^ hash(c));
+        }
+        return state;
+    }
+
+    template < typename R, typename... Args >
+    R& registry::assign_relation(const uentity& source, const const_uentity& target, Args&&... args) {
+        assert(valid_entity(source));
+        assert(valid_entity(target));
+        return get_or_create_relations_<R>().assign(
+            source,
+            target,
+            std::forward<Args>(args)...);
     }
 
-    template < typename T >
-    T& component<T>::get() {
-        return owner_.get_component<T>();
+    template < typename R >
+    bool registry::remove_relation(const uentity& source, const const_uentity& target) noexcept {
+        assert(valid_entity(source));
+        detail::relation_storage<R>* relations = find_relations_<R>();
+        return relations
+            ? relations->remove(source, target)
+            : false;
     }
 
-    template < typename T >
-    const T& component<T>::get() const {
-        return std::as_const(owner_).template get_component<T>();
+    template < typename R >
+    bool registry::exists_relation(const const_uentity& source) const noexcept {
+        assert(valid_entity(source));
+        const detail::relation_storage<R>* relations = find_relations_<R>();
+        return relations
+            ? relations->exists(source)
+            : false;
     }
 
-    template < typename T >
-    T* component<T>::find() noexcept {
-        return owner_.find_component<T>();
+    template < typename R >
+    bool registry::exists_relation(const const_uentity& source, const const_uentity& target) const noexcept {
+        assert(valid_entity(source));
+        const detail::relation_storage<R>* relations = find_relations_<R>();
+        return relations
+            ? relations->exists(source, target)
+            : false;
     }
 
-    template < typename T >
-    const T* component<T>::find() const noexcept {
-        return std::as_const(owner_).template find_component<T>();
+    template < typename R >
+    R& registry::get_relation(const uentity& source, const const_uentity& target) {
+        if ( R* relation = find_relation<R>(source, target) ) {
+            return *relation;
+        }
+        detail::throw_logic_error("ecs_hpp::registry (relation not found)");
     }
 
-    template < typename T >
-    T& component<T>::operator*() {
-        return get();
+    template < typename R >
+    const R& registry::get_relation(const const_uentity& source, const const_uentity& target) const {
+        if ( const R* relation = find_relation<R>(source, target) ) {
+            return *relation;
+        }
+        detail::throw_logic_error("ecs_hpp::registry (relation not found)");
     }
 
-    template < typename T >
-    const T& component<T>::operator*() const {
-        return get();
+    template < typename R >
+    R* registry::find_relation(const uentity& source, const const_uentity& target) noexcept {
+        assert(valid_entity(source));
+        detail::relation_storage<R>* relations = find_relations_<R>();
+        return relations
+            ? relations->find(source, target)
+            : nullptr;
     }
 
-    template < typename T >
-    T* component<T>::operator->() noexcept {
-        return find();
+    template < typename R >
+    const R* registry::find_relation(const const_uentity& source, const const_uentity& target) const noexcept {
+        assert(valid_entity(source));
+        const detail::relation_storage<R>* relations = find_relations_<R>();
+        return relations
+            ? relations->find(source, target)
+            : nullptr;
     }
 
-    template < typename T >
-    const T* component<T>::operator->() const noexcept {
-        return find();
+    inline std::size_t registry::remove_all_relations(const uentity& ent) noexcept {
+        assert(valid_entity(ent));
+        std::size_t removed_count = 0u;
+        for ( const auto family : relation_families_ ) {
+            removed_count += relations_[family]->remove_all(ent);
+        }
+        return removed_count;
     }
 
-    template < typename T >
-    component<T>::operator bool() const noexcept {
-        return exists();
+    template < typename R >
+    std::size_t registry::relation_count() const noexcept {
+        const detail::relation_storage<R>* relations = find_relations_<R>();
+        return relations
+            ? relations->count()
+            : 0u;
     }
 
-    template < typename T >
-    bool operator<(const component<T>& l, const component<T>& r) noexcept {
-        return l.owner() < r.owner();
+    template < typename R >
+    std::size_t registry::relation_count(const const_uentity& source) const noexcept {
+        assert(valid_entity(source));
+        const detail::relation_storage<R>* relations = find_relations_<R>();
+        return relations
+            ? relations->target_count(source)
+            : 0u;
     }
 
-    template < typename T >
-    bool operator==(const component<T>& l, const component<T>& r) noexcept {
-        return l.owner() == r.owner();
+    template < typename R >
+    std::size_t registry::related_count(const const_uentity& target) const noexcept {
+        assert(valid_entity(target));
+        const detail::relation_storage<R>* relations = find_relations_<R>();
+        return relations
+            ? relations->source_count(target)
+            : 0u;
     }
 
-    template < typename T >
-    bool operator==(const component<T>& l, const const_component<T>& r) noexcept {
-        return l.owner() == r.owner();
+    template < typename R, typename F >
+    void registry::for_each_relation(const uentity& source, F&& f) {
+        assert(valid_entity(source));
+        if ( detail::relation_storage<R>* relations = find_relations_<R>() ) {
+            relations->for_each_target(source, [this, &f](const entity_id target, R& r){
+                f(uentity{*this, target}, r);
+            });
+        }
     }
 
-    template < typename T >
-    bool operator!=(const component<T>& l, const component<T>& r) noexcept {
-        return !(l == r);
+    template < typename R, typename F >
+    void registry::for_each_relation(const const_uentity& source, F&& f) const {
+        assert(valid_entity(source));
+        if ( const detail::relation_storage<R>* relations = find_relations_<R>() ) {
+            relations->for_each_target(source, [this, &f](const entity_id target, const R& r){
+                f(const_uentity{*this, target}, r);
+            });
+        }
     }
 
-    template < typename T >
-    bool operator!=(const component<T>& l, const const_component<T>& r) noexcept {
-        return !(l == r);
+    template < typename R, typename F >
+    void registry::for_each_related(const uentity& target, F&& f) {
+        assert(valid_entity(target));
+        if ( detail::relation_storage<R>* relations = find_relations_<R>() ) {
+            relations->for_each_source(target, [this, &f](const entity_id source, R& r){
+                f(uentity{*this, source}, r);
+            });
+        }
     }
-}
-
-// -----------------------------------------------------------------------------
-//
-// const_component impl
-//
-// -----------------------------------------------------------------------------
-
-namespace ecs_hpp
-{
-    template < typename T >
-    const_component<T>::const_component(const component<T>& comp) noexcept
-    : owner_(comp.owner()) {}
 
-    template < typename T >
-    const_component<T>::const_component(const const_entity& owner) noexcept
-    : owner_(owner) {}
+    template < typename R, typename F >
+    void registry::for_each_related(const const_uentity& target, F&& f) const {
+        assert(valid_entity(target));
+        if ( const detail::relation_storage<R>* relations = find_relations_<R>() ) {
+            relations->for_each_source(target, [this, &f](const entity_id source, const R& r){
+                f(const_uentity{*this, source}, r);
+            });
+        }
+    }
 
-    template < typename T >
-    const const_entity& const_component<T>::owner() const noexcept {
-        return owner_;
+    template < typename Tag, typename... Args >
+    feature& registry::assign_feature(Args&&... args) {
+        const auto feature_id = detail::type_family<Tag>::id();
+        std::unique_lock lock(mutexes_.features_locker_);
+        if (feature * f = features_.find(feature_id))
+        {
+            return *f = feature{std::forward<Args>(args)...};
+        }
+        return *features_.insert(feature_id, feature{std::forward<Args>(args)...}).first;
     }
 
-    template < typename T >
-    bool const_component<T>::valid() const noexcept {
-        return owner_.valid();
+    template < typename Tag, typename... Args >
+    feature& registry::ensure_feature(Args&&... args) {
+        const auto feature_id = detail::type_family<Tag>::id();
+        std::unique_lock lock(mutexes_.features_locker_);
+        if (feature * f = features_.find(feature_id))
+        {
+            return *f;
+        }
+        return *features_.insert(feature_id, feature{std::forward<Args>(args)...}).first;
     }
 
-    template < typename T >
-    bool const_component<T>::exists() const noexcept {
-        return std::as_const(owner_).template exists_component<T>();
+    template < typename Tag >
+    bool registry::has_feature() const noexcept {
+        const auto feature_id = detail::type_family<Tag>::id();
+        std::shared_lock lock(mutexes_.features_locker_);
+        return features_.has(feature_id);
     }
 
-    template < typename T >
-    const T& const_component<T>::get() const {
-        return std::as_const(owner_).template get_component<T>();
+    template < typename Tag >
+    feature& registry::get_feature() {
+        const auto feature_id = detail::type_family<Tag>::id();
+        std::shared_lock lock(mutexes_.features_locker_);
+        if (feature * f = features_.find(feature_id))
+        {
+            return *f;
+        }
+        detail::throw_logic_error("ecs_hpp::registry (feature not found)");
     }
 
-    template < typename T >
-    const T* const_component<T>::find() const noexcept {
-        return std::as_const(owner_).template find_component<T>();
+    template < typename Tag >
+    const feature& registry::get_feature() const {
+        const auto feature_id = detail::type_family<Tag>::id();
+        std::shared_lock lock(mutexes_.features_locker_);
+        if ( const feature* f = features_.find(feature_id) ) {
+            return *f;
+        }
+        detail::throw_logic_error("ecs_hpp::registry (feature not found)");
     }
 
-    template < typename T >
-    const T& const_component<T>::operator*() const {
-        return get();
+    template < typename T, typename... Args >
+    T& registry::assign_ctx(Args&&... args) {
+        return context_.assign<T>(std::forward<Args>(args)...);
     }
 
-    template < typename T >
-    const T* const_component<T>::operator->() const noexcept {
-        return find();
+    template < typename T, typename... Args >
+    T& registry::ensure_ctx(Args&&... args) {
+        return context_.ensure<T>(std::forward<Args>(args)...);
     }
 
     template < typename T >
-    const_component<T>::operator bool() const noexcept {
-        return exists();
+    bool registry::remove_ctx() noexcept {
+        return context_.remove<T>();
     }
 
     template < typename T >
-    bool operator<(const const_component<T>& l, const const_component<T>& r) noexcept {
-        return l.owner() < r.owner();
+    bool registry::has_ctx() const noexcept {
+        return context_.find<T>() != nullptr;
     }
 
     template < typename T >
-    bool operator==(const const_component<T>& l, const component<T>& r) noexcept {
-        return l.owner() == r.owner();
+    T& registry::ctx() {
+        if ( T* value = context_.find<T>() ) {
+            return *value;
+        }
+        detail::throw_logic_error("ecs_hpp::registry (context value not found)");
     }
 
     template < typename T >
-    bool operator==(const const_component<T>& l, const const_component<T>& r) noexcept {
-        return l.owner() == r.owner();
+    const T& registry::ctx() const {
+        if ( const T* value = context_.find<T>() ) {
+            return *value;
+        }
+        detail::throw_logic_error("ecs_hpp::registry (context value not found)");
     }
 
     template < typename T >
-    bool operator!=(const const_component<T>& l, const component<T>& r) noexcept {
-        return !(l == r);
+    T* registry::find_ctx() noexcept {
+        return context_.find<T>();
     }
 
     template < typename T >
-    bool operator!=(const const_component<T>& l, const const_component<T>& r) noexcept {
-        return !(l == r);
+    const T* registry::find_ctx() const noexcept {
+        return context_.find<T>();
     }
-}
-
-// -----------------------------------------------------------------------------
-//
-// prototype impl
-//
-// -----------------------------------------------------------------------------
-
-namespace ecs_hpp
-{
-    namespace detail
-    {
-        template < typename T, typename... Args >
-        typed_applier_with_args<T, Args...>::typed_applier_with_args(std::tuple<Args...>&& args)
-        : args_(std::move(args)) {}
-
-        template < typename T, typename... Args >
-        typed_applier_with_args<T, Args...>::typed_applier_with_args(const std::tuple<Args...>& args)
-        : args_(args) {}
 
-        template < typename T, typename... Args >
-        applier_uptr typed_applier_with_args<T, Args...>::clone() const {
-            return std::make_unique<typed_applier_with_args>(args_);
+    template < typename Event >
+    registry& registry::process_event(const Event& event) {
+        std::shared_lock lock(mutexes_.features_locker_);
+        for (const auto family : features_)
+        {
+            if ( feature& f = features_.get(family); f.is_enabled() ) {
+                f.process_event(*this, event);
+            }
         }
+        return *this;
+    }
 
-        template < typename T, typename... Args >
-        void typed_applier_with_args<T, Args...>::apply_to_entity(entity& ent, bool override) const {
-            std::apply([&ent, override](const Args&... args){
-                if ( override || !ent.exists_component<T>() ) {
-                    ent.assign_component<T>(args...);
-                }
-            }, args_);
+    inline registry::memory_usage_info registry::memory_usage() const noexcept {
+        memory_usage_info info;
+        std::shared_lock lock(mutexes_.features_locker_);
+        info.entities += free_entity_ids_.capacity() * sizeof(free_entity_ids_[0]);
+        info.entities += entity_ids_.memory_usage();
+        info.entities += dormant_entities_.memory_usage();
+        info.entities += schedule_.memory_usage();
+        {
+            std::shared_lock hierarchy_lock(mutexes_.hierarchy_locker_);
+            info.entities += hierarchy_.memory_usage();
         }
-
-        template < typename T, typename... Args >
-        void typed_applier_with_args<T, Args...>::apply_to_component(T& component) const {
-            std::apply([&component](const Args&... args){
-                component = T{args...};
-            }, args_);
+        info.entities += signatures_.memory_usage();
+        for ( const auto family : storage_families_ ) {
+            info.components += storages_[family]->memory_usage();
+        }
+        for ( const auto family : shared_families_ ) {
+            info.components += shared_[family]->memory_usage();
+        }
+        for ( const auto family : transient_families_ ) {
+            info.components += transients_[family]->memory_usage();
+        }
+        for ( const auto family : buffered_families_ ) {
+            info.components += buffered_[family]->memory_usage();
         }
+        for ( const auto family : relation_families_ ) {
+            info.components += relations_[family]->memory_usage();
+        }
+        return info;
     }
 
-    inline prototype::prototype(const prototype& other) {
-        for ( const family_id family : other.appliers_ ) {
-            appliers_.insert(family, other.appliers_.get(family)->clone());
-        }
+    template < typename T >
+    std::size_t registry::component_memory_usage() const noexcept {
+        const detail::component_storage<T>* storage = find_storage_<T>();
+        return storage
+            ? storage->memory_usage()
+            : 0u;
     }
 
-    inline prototype& prototype::operator=(const prototype& other) {
-        if ( this != &other ) {
-            prototype p(other);
-            swap(p);
-        }
-        return *this;
+    inline std::pmr::memory_resource* registry::resource() const noexcept {
+        return storages_arena_.resource();
+    }
+
+    template < typename T >
+    detail::component_storage<T>* registry::find_storage_() noexcept {
+        const auto family = detail::type_family<T>::id();
+        return family < storages_.size()
+            ? static_cast<detail::component_storage<T>*>(storages_[family])
+            : nullptr;
     }
 
-    inline prototype::prototype(prototype&& other) noexcept
-    : appliers_(std::move(other.appliers_)) {}
+    template < typename T >
+    const detail::component_storage<T>* registry::find_storage_() const noexcept {
+        const auto family = detail::type_family<T>::id();
+        return family < storages_.size()
+            ? static_cast<const detail::component_storage<T>*>(storages_[family])
+            : nullptr;
+    }
 
-    inline prototype& prototype::operator=(prototype&& other) noexcept {
-        if ( this != &other ) {
-            swap(other);
-            other.clear();
+    template < typename T >
+    detail::component_storage<T>& registry::get_or_create_storage_() {
+        if ( detail::component_storage<T>* storage = find_storage_<T>() ) {
+            return *storage;
         }
-        return *this;
+        return create_storage_<detail::component_storage<T>>(
+            detail::type_family<T>::id(),
+            resource());
     }
 
-    inline void prototype::clear() noexcept {
-        appliers_.clear();
+    template < typename Storage, typename... Args >
+    Storage& registry::create_storage_(family_id family, Args&&... args) {
+        if ( family >= storages_.size() ) {
+            storages_.resize(family + 1u, nullptr);
+        }
+        storage_families_.reserve(storage_families_.size() + 1u);
+        auto storage = storages_arena_.create<Storage>(std::forward<Args>(args)...);
+        storage->signature_bit(detail::entity_signatures::slot_bit(storage_families_.size()));
+        storages_[family] = storage;
+        storage_families_.push_back(family);
+        return *storage;
     }
 
-    inline bool prototype::empty() const noexcept {
-        return appliers_.empty();
+    template < typename T >
+    detail::shared_storage<T>* registry::find_shared_() noexcept {
+        const auto family = detail::type_family<T>::id();
+        return family < shared_.size()
+            ? static_cast<detail::shared_storage<T>*>(shared_[family])
+            : nullptr;
     }
 
-    inline void prototype::swap(prototype& other) noexcept {
-        using std::swap;
-        swap(appliers_, other.appliers_);
+    template < typename T >
+    const detail::shared_storage<T>* registry::find_shared_() const noexcept {
+        const auto family = detail::type_family<T>::id();
+        return family < shared_.size()
+            ? static_cast<const detail::shared_storage<T>*>(shared_[family])
+            : nullptr;
     }
 
     template < typename T >
-    bool prototype::has_component() const noexcept {
+    detail::shared_storage<T>& registry::get_or_create_shared_() {
+        if ( detail::shared_storage<T>* storage = find_shared_<T>() ) {
+            return *storage;
+        }
         const auto family = detail::type_family<T>::id();
-        return appliers_.has(family);
+        if ( family >= shared_.size() ) {
+            shared_.resize(family + 1u, nullptr);
+        }
+        shared_families_.reserve(shared_families_.size() + 1u);
+        auto storage = storages_arena_.create<detail::shared_storage<T>>(resource());
+        shared_[family] = storage;
+        shared_families_.push_back(family);
+        return *storage;
     }
 
-    template < typename T, typename... Args >
-    prototype& prototype::component(Args&&... args) & {
-        using applier_t = detail::typed_applier_with_args<
-            T,
-            std::decay_t<Args>...>;
-        auto applier = std::make_unique<applier_t>(
-            std::make_tuple(std::forward<Args>(args)...));
+    template < typename T >
+    detail::transient_storage<T>* registry::find_transient_() noexcept {
         const auto family = detail::type_family<T>::id();
-        appliers_.insert_or_assign(family, std::move(applier));
-        return *this;
+        return family < transients_.size()
+            ? static_cast<detail::transient_storage<T>*>(transients_[family])
+            : nullptr;
     }
 
-    template < typename T, typename... Args >
-    prototype&& prototype::component(Args&&... args) && {
-        component<T>(std::forward<Args>(args)...);
-        return std::move(*this);
+    template < typename T >
+    const detail::transient_storage<T>* registry::find_transient_() const noexcept {
+        const auto family = detail::type_family<T>::id();
+        return family < transients_.size()
+            ? static_cast<const detail::transient_storage<T>*>(transients_[family])
+            : nullptr;
     }
 
-    inline prototype& prototype::merge_with(const prototype& other, bool override) & {
-        for ( const auto family : other.appliers_ ) {
-            if ( override || !appliers_.has(family) ) {
-                appliers_.insert_or_assign(
-                    family,
-                    other.appliers_.get(family)->clone());
-            }
+    template < typename T >
+    detail::transient_storage<T>& registry::get_or_create_transient_() {
+        if ( detail::transient_storage<T>* storage = find_transient_<T>() ) {
+            return *storage;
         }
-        return *this;
+        const auto family = detail::type_family<T>::id();
+        if ( family >= transients_.size() ) {
+            transients_.resize(family + 1u, nullptr);
+        }
+        transient_families_.reserve(transient_families_.size() + 1u);
+        auto storage = storages_arena_.create<detail::transient_storage<T>>(resource());
+        transients_[family] = storage;
+        transient_families_.push_back(family);
+        return *storage;
     }
 
-    inline prototype&& prototype::merge_with(const prototype& other, bool override) && {
-        merge_with(other, override);
-        return std::move(*this);
+    template < typename T >
+    detail::buffered_storage<T>* registry::find_buffered_() noexcept {
+        const auto family = detail::type_family<T>::id();
+        return family < buffered_.size()
+            ? static_cast<detail::buffered_storage<T>*>(buffered_[family])
+            : nullptr;
     }
 
     template < typename T >
-    bool prototype::apply_to_component(T& component) const {
+    const detail::buffered_storage<T>* registry::find_buffered_() const noexcept {
         const auto family = detail::type_family<T>::id();
-        const auto applier_base_ptr = appliers_.find(family);
-        if ( !applier_base_ptr ) {
-            return false;
-        }
-        using applier_t = detail::typed_applier<T>;
-        const auto applier = static_cast<applier_t*>(applier_base_ptr->get());
-        applier->apply_to_component(component);
-        return true;
+        return family < buffered_.size()
+            ? static_cast<const detail::buffered_storage<T>*>(buffered_[family])
+            : nullptr;
     }
 
-    inline void prototype::apply_to_entity(entity& ent, bool override) const {
-        for ( const auto family : appliers_ ) {
-            appliers_.get(family)->apply_to_entity(ent, override);
+    template < typename T >
+    detail::buffered_storage<T>& registry::get_or_create_buffered_() {
+        if ( detail::buffered_storage<T>* storage = find_buffered_<T>() ) {
+            return *storage;
+        }
+        const auto family = detail::type_family<T>::id();
+        if ( family >= buffered_.size() ) {
+            buffered_.resize(family + 1u, nullptr);
         }
+        buffered_families_.reserve(buffered_families_.size() + 1u);
+        auto storage = storages_arena_.create<detail::buffered_storage<T>>(resource());
+        buffered_[family] = storage;
+        buffered_families_.push_back(family);
+        return *storage;
     }
 
-    inline void swap(prototype& l, prototype& r) noexcept {
-        l.swap(r);
+    template < typename R >
+    detail::relation_storage<R>* registry::find_relations_() noexcept {
+        const auto family = detail::type_family<R>::id();
+        return family < relations_.size()
+            ? static_cast<detail::relation_storage<R>*>(relations_[family])
+            : nullptr;
     }
-}
-
-// -----------------------------------------------------------------------------
-//
-// feature impl
-//
-// -----------------------------------------------------------------------------
 
-namespace ecs_hpp
-{
-    inline feature& feature::enable() & noexcept {
-        std::unique_lock lock(systems_locker_);
-        disabled_ = false;
-        return *this;
+    template < typename R >
+    const detail::relation_storage<R>* registry::find_relations_() const noexcept {
+        const auto family = detail::type_family<R>::id();
+        return family < relations_.size()
+            ? static_cast<const detail::relation_storage<R>*>(relations_[family])
+            : nullptr;
     }
 
-    inline feature&& feature::enable() && noexcept {
-        enable();
-        return std::move(*this);
+    template < typename R >
+    detail::relation_storage<R>& registry::get_or_create_relations_() {
+        if ( detail::relation_storage<R>* relations = find_relations_<R>() ) {
+            return *relations;
+        }
+        const auto family = detail::type_family<R>::id();
+        if ( family >= relations_.size() ) {
+            relations_.resize(family + 1u, nullptr);
+        }
+        relation_families_.reserve(relation_families_.size() + 1u);
+        auto relations = storages_arena_.create<detail::relation_storage<R>>(resource());
+        relations_[family] = relations;
+        relation_families_.push_back(family);
+        return *relations;
     }
 
-    inline feature& feature::disable() & noexcept {
-        std::unique_lock lock(systems_locker_);
-        disabled_ = true;
-        return *this;
+    inline detail::component_storage_base* registry::find_storage_(family_id family) noexcept {
+        return family < storages_.size()
+            ? storages_[family]
+            : nullptr;
     }
 
-    inline feature&& feature::disable() && noexcept {
-        disable();
-        return std::move(*this);
+    inline const detail::component_storage_base* registry::find_storage_(family_id family) const noexcept {
+        return family < storages_.size()
+            ? storages_[family]
+            : nullptr;
     }
 
-    inline bool feature::is_enabled() const noexcept {
-        std::shared_lock lock(systems_locker_);
-        return !disabled_;
-    }
+    inline bool registry::resolve_query_storages_(const runtime_query& query, query_storages_& ss) const {
+        const auto to_mutable = [](const detail::component_storage_base* storage){
+            return const_cast<detail::component_storage_base*>(storage);
+        };
 
-    inline bool feature::is_disabled() const noexcept {
-        std::shared_lock lock(systems_locker_);
-        return disabled_;
-    }
+        ss.required.reserve(query.required_families().size());
+        for ( const family_id family : query.required_families() ) {
+            const auto storage = find_storage_(family);
+            if ( !storage ) {
+                return false;
+            }
+            ss.required.push_back(to_mutable(storage));
+        }
 
-    template < typename T, typename... Args >
-    feature& feature::add_system(Args&&... args) & {
-        std::unique_lock lock(systems_locker_);
-        systems_.push_back(std::make_unique<T>(std::forward<Args>(args)...));
-        return *this;
-    }
+        for ( const family_id family : query.excluded_families() ) {
+            if ( const auto storage = find_storage_(family) ) {
+                const auto iter = std::find(ss.required.begin(), ss.required.end(), storage);
+                if ( iter != ss.required.end() ) {
+                    return false;
+                }
+                ss.excluded.push_back(to_mutable(storage));
+            }
+        }
 
-    template < typename T, typename... Args >
-    feature&& feature::add_system(Args&&... args) && {
-        add_system<T>(std::forward<Args>(args)...);
-        return std::move(*this);
+        ss.optional.reserve(query.optional_families().size());
+        for ( const family_id family : query.optional_families() ) {
+            ss.optional.push_back(to_mutable(find_storage_(family)));
+        }
+
+        std::size_t driver_count = std::numeric_limits<std::size_t>::max();
+        for ( const auto storage : ss.required ) {
+            if ( const std::size_t count = storage->count(); count < driver_count ) {
+                ss.driver = storage;
+                driver_count = count;
+            }
+        }
+        return true;
     }
 
-    template < typename Event >
-    feature& feature::process_event(registry& owner, const Event& event) {
-        std::shared_lock lock(systems_locker_);
-        const auto fire_event = [this, &owner](const auto& event){
-            for ( const auto& base_system : systems_ ) {
-                using system_type = system<std::decay_t<decltype(event)>>;
-                if ( auto event_system = dynamic_cast<system_type*>(base_system.get()) ) {
-                    event_system->process(owner, event);
+    template < typename Ent, typename F, typename... Opts >
+    void registry::for_queried_components_impl_(const query_storages_& ss, F&& f, Opts&&... opts) const {
+        std::vector<void*> cs(ss.required.size() + ss.optional.size());
+
+        const auto probe = [&ss, &cs](entity_id id, std::size_t driver_index) noexcept {
+            for ( const auto storage : ss.excluded ) {
+                if ( storage->has_enabled(id) ) {
+                    return false;
+                }
+            }
+            const auto find = [&ss, id, driver_index](detail::component_storage_base* storage) -> void* {
+                if ( storage && storage == ss.driver ) {
+                    const auto view = storage->dense_view();
+                    return view.components + driver_index * view.stride;
+                }
+                return storage && storage->has_enabled(id)
+                    ? storage->find_raw(id)
+                    : nullptr;
+            };
+            for ( std::size_t i = 0; i < ss.required.size(); ++i ) {
+                if ( !(cs[i] = find(ss.required[i])) ) {
+                    return false;
                 }
             }
+            for ( std::size_t i = 0; i < ss.optional.size(); ++i ) {
+                cs[ss.required.size() + i] = find(ss.optional[i]);
+            }
+            return true;
         };
 
-        fire_event(before<Event>{event});
-        fire_event(event);
-        fire_event(after<Event>{event});
+        const auto visit = [&probe, &cs, &f](const Ent& e, std::size_t driver_index){
+            if ( probe(e, driver_index) ) {
+                f(e, cs.data());
+            }
+        };
 
-        return *this;
+        constexpr bool is_mutable = std::is_same_v<Ent, uentity>;
+        using registry_ref = std::conditional_t<is_mutable, registry&, const registry&>;
+        registry_ref owner = const_cast<registry&>(*this);
+
+        if ( !ss.driver ) {
+            owner.for_each_entity([this, &visit](const Ent& e){
+                if ( !dormant_entities_.has(e) ) {
+                    visit(e, 0u);
+                }
+            }, std::forward<Opts>(opts)...);
+            return;
+        }
+
+        using lock_type = std::conditional_t<
+            is_mutable,
+            std::unique_lock<std::shared_mutex>,
+            std::shared_lock<std::shared_mutex>>;
+        lock_type lock(ss.driver->locker());
+        const auto view = ss.driver->dense_view();
+        ss.driver->for_each_enabled_index([&owner, &view, &visit, &opts...](std::size_t i){
+            if ( Ent e{owner, view.ids[i]}; (... && opts(e)) ) {
+                visit(e, i);
+            }
+        });
+    }
+
+    template < typename Ent, typename T, typename Budget, typename F, typename... Opts >
+    bool registry::for_each_component_budgeted_(iteration_cursor& cursor, Budget&& budget, F&& f, Opts&&... opts) const {
+        constexpr bool is_mutable = std::is_same_v<Ent, uentity>;
+        using registry_ref = std::conditional_t<is_mutable, registry&, const registry&>;
+        using storage_ptr = std::conditional_t<
+            is_mutable,
+            detail::component_storage<T>*,
+            const detail::component_storage<T>*>;
+        registry_ref owner = const_cast<registry&>(*this);
+        storage_ptr storage = owner.template find_storage_<T>();
+
+        const auto family = detail::type_family<T>::id();
+        if ( !cursor.in_cycle() || cursor.family_ != family ) {
+            cursor.ids_.clear();
+            cursor.position_ = 0u;
+            cursor.family_ = family;
+            if ( storage ) {
+                std::shared_lock lock(storage->locker());
+                const auto view = static_cast<const detail::component_storage_base*>(storage)->dense_view();
+                cursor.ids_.reserve(view.size);
+                storage->for_each_enabled_index([&cursor, &view](std::size_t i){
+                    cursor.ids_.push_back(view.ids[i]);
+                });
+            }
+        }
+
+        // components are looked up by id, callbacks run without the storage locked
+        for ( std::size_t visited = 0u; cursor.in_cycle() && budget(visited); ) {
+            const entity_id id = cursor.ids_[cursor.position_++];
+            if ( !storage || !awake_entity_(id) ) {
+                continue;
+            }
+            if ( auto c = storage->find_enabled(id) ) {
+                if ( Ent e{owner, id}; (... && opts(e)) ) {
+                    f(e, *c);
+                    ++visited;
+                }
+            }
+        }
+
+        if ( cursor.in_cycle() ) {
+            return false;
+        }
+        ++cursor.cycle_count_;
+        return true;
     }
 }
 
 // -----------------------------------------------------------------------------
 //
-// registry impl
+// static_entity impl
 //
 // -----------------------------------------------------------------------------
 
 namespace ecs_hpp
 {
-    //
-    // registry::uentity
-    //
-
-    inline registry::uentity::uentity(registry& owner, entity_id id) noexcept
-    : id_(id)
-    , owner_(&owner) {}
+    template < typename Registry >
+    static_entity<Registry>::static_entity(Registry& owner, entity_id id) noexcept
+    : owner_(&owner)
+    , id_(id) {}
 
-    inline registry::uentity::uentity(entity_id ent) noexcept
-    : id_(ent) {}
+    template < typename Registry >
+    template < typename R, typename >
+    static_entity<Registry>::static_entity(const static_entity<R>& other) noexcept
+    : owner_(&other.owner())
+    , id_(other.id()) {}
 
-    inline registry::uentity::uentity(entity ent) noexcept
-    : id_(ent.id())
-    , owner_(&ent.owner()) {}
+    template < typename Registry >
+    Registry& static_entity<Registry>::owner() const noexcept {
+        return *owner_;
+    }
 
-    inline registry::uentity::operator entity_id() const noexcept {
+    template < typename Registry >
+    entity_id static_entity<Registry>::id() const noexcept {
         return id_;
     }
 
-    inline registry::uentity::operator entity() const noexcept {
-        assert(owner_);
-        return {*owner_, id_};
+    template < typename Registry >
+    static_entity<Registry>::operator entity_id() const noexcept {
+        return id_;
     }
 
-    inline registry::uentity::operator const_entity() const noexcept {
-        assert(owner_);
-        return {*owner_, id_};
+    template < typename Registry >
+    void static_entity<Registry>::destroy() const noexcept {
+        (*owner_).destroy_entity(id_);
     }
 
-    inline entity_id registry::uentity::id() const noexcept {
-        return id_;
+    template < typename Registry >
+    bool static_entity<Registry>::valid() const noexcept {
+        return (*owner_).valid_entity(id_);
     }
 
-    inline registry* registry::uentity::owner() noexcept {
-        return owner_;
+    template < typename Registry >
+    template < typename T, typename... Args >
+    T& static_entity<Registry>::assign_component(Args&&... args) const {
+        return (*owner_).template assign_component<T>(
+            id_,
+            std::forward<Args>(args)...);
     }
 
-    inline const registry* registry::uentity::owner() const noexcept {
-        return owner_;
+    template < typename Registry >
+    template < typename T, typename... Args >
+    T& static_entity<Registry>::ensure_component(Args&&... args) const {
+        return (*owner_).template ensure_component<T>(
+            id_,
+            std::forward<Args>(args)...);
     }
 
-    inline bool registry::uentity::check_owner(const registry* owner) const noexcept {
-        return !owner_ || owner_ == owner;
+    template < typename Registry >
+    template < typename T >
+    bool static_entity<Registry>::remove_component() const noexcept {
+        return (*owner_).template remove_component<T>(id_);
     }
 
-    //
-    // registry::const_uentity
-    //
-
-    inline registry::const_uentity::const_uentity(const registry& owner, entity_id id) noexcept
-    : id_(id)
-    , owner_(&owner) {}
-
-    inline registry::const_uentity::const_uentity(entity_id ent) noexcept
-    : id_(ent) {}
-
-    inline registry::const_uentity::const_uentity(entity ent) noexcept
-    : id_(ent.id())
-    , owner_(&ent.owner()) {}
-
-    inline registry::const_uentity::const_uentity(const_entity ent) noexcept
-    : id_(ent.id())
-    , owner_(&ent.owner()) {}
-
-    inline registry::const_uentity::const_uentity(const uentity& ent) noexcept
-    : id_(ent.id())
-    , owner_(ent.owner()) {}
-
-    inline registry::const_uentity::operator entity_id() const noexcept {
-        return id_;
+    template < typename Registry >
+    template < typename T >
+    bool static_entity<Registry>::exists_component() const noexcept {
+        return (*owner_).template exists_component<T>(id_);
     }
 
-    inline registry::const_uentity::operator const_entity() const noexcept {
-        assert(owner_);
-        return {*owner_, id_};
+    template < typename Registry >
+    std::size_t static_entity<Registry>::remove_all_components() const noexcept {
+        return (*owner_).remove_all_components(id_);
     }
 
-    inline entity_id registry::const_uentity::id() const noexcept {
-        return id_;
+    template < typename Registry >
+    template < typename T >
+    decltype(auto) static_entity<Registry>::get_component() const {
+        return (*owner_).template get_component<T>(id_);
     }
 
-    inline const registry* registry::const_uentity::owner() const noexcept {
-        return owner_;
+    template < typename Registry >
+    template < typename T >
+    auto static_entity<Registry>::find_component() const noexcept {
+        return (*owner_).template find_component<T>(id_);
     }
 
-    inline bool registry::const_uentity::check_owner(const registry* owner) const noexcept {
-        return !owner_ || owner_ == owner;
+    template < typename Registry >
+    std::size_t static_entity<Registry>::component_count() const noexcept {
+        return (*owner_).entity_component_count(id_);
     }
 
-    //
-    // registry
-    //
-
-    inline entity registry::wrap_entity(const const_uentity& ent) noexcept {
-        return {*this, ent.id()};
+    template < typename L, typename R >
+    bool operator==(const static_entity<L>& l, const static_entity<R>& r) noexcept {
+        return &l.owner() == &r.owner()
+            && l.id() == r.id();
     }
 
-    inline const_entity registry::wrap_entity(const const_uentity& ent) const noexcept {
-        return {*this, ent.id()};
+    template < typename L, typename R >
+    bool operator!=(const static_entity<L>& l, const static_entity<R>& r) noexcept {
+        return !(l == r);
     }
+}
 
-    template < typename T >
-    component<T> registry::wrap_component(const const_uentity& ent) noexcept {
-        return component<T>{wrap_entity(ent)};
+// -----------------------------------------------------------------------------
+//
+// static_registry impl
+//
+// -----------------------------------------------------------------------------
+
+namespace ecs_hpp
+{
+    template < typename... Cs >
+    typename static_registry<Cs...>::entity
+    static_registry<Cs...>::wrap_entity(entity_id ent) noexcept {
+        return {*this, ent};
     }
 
-    template < typename T >
-    const_component<T> registry::wrap_component(const const_uentity& ent) const noexcept {
-        return const_component<T>{wrap_entity(ent)};
+    template < typename... Cs >
+    typename static_registry<Cs...>::const_entity
+    static_registry<Cs...>::wrap_entity(entity_id ent) const noexcept {
+        return {*this, ent};
     }
 
-    inline entity registry::create_entity() {
-        std::unique_lock lock(mutexes_.entity_ids_locker_);
+    template < typename... Cs >
+    typename static_registry<Cs...>::entity
+    static_registry<Cs...>::create_entity() {
+        std::unique_lock lock(entity_ids_locker_);
         if ( !free_entity_ids_.empty() ) {
             const auto free_ent_id = free_entity_ids_.back();
             const auto new_ent_id = detail::upgrade_entity_id(free_ent_id);
             entity_ids_.insert(new_ent_id);
             free_entity_ids_.pop_back();
             return wrap_entity(new_ent_id);
-
         }
         if ( last_entity_id_ >= detail::entity_id_index_mask ) {
-            throw std::logic_error("ecs_hpp::registry (entity index overlow)");
+            detail::throw_logic_error("ecs_hpp::static_registry (entity index overlow)");
         }
         if ( free_entity_ids_.capacity() <= entity_ids_.size() ) {
             // ensure free entity ids capacity for safe (noexcept) entity destroying
@@ -2640,33 +9216,23 @@ namespace ecs_hpp
         return wrap_entity(++last_entity_id_);
     }
 
-    inline entity registry::create_entity(const prototype& proto) {
-        auto ent = create_entity();
-        try {
-            proto.apply_to_entity(ent, true);
-        } catch (...) {
-            destroy_entity(ent);
-            throw;
-        }
-        return ent;
-    }
-
-    inline entity registry::create_entity(const const_uentity& proto) {
+    template < typename... Cs >
+    typename static_registry<Cs...>::entity
+    static_registry<Cs...>::create_entity(entity_id proto) {
         assert(valid_entity(proto));
         entity ent = create_entity();
-        try {
-            for ( const auto family : storages_ ) {
-                storages_.get(family)->clone(proto, ent.id());
-            }
-        } catch (...) {
+        ECS_HPP_TRY {
+            (storage_<Cs>().clone(proto, ent.id()), ...);
+        } ECS_HPP_CATCH_ALL {
             destroy_entity(ent);
-            throw;
+            ECS_HPP_RETHROW;
         }
         return ent;
     }
 
-    inline void registry::destroy_entity(const uentity& ent) noexcept {
-        std::unique_lock lock(mutexes_.entity_ids_locker_);
+    template < typename... Cs >
+    void static_registry<Cs...>::destroy_entity(entity_id ent) noexcept {
+        std::unique_lock lock(entity_ids_locker_);
         assert(valid_entity(ent));
         remove_all_components(ent);
         if ( entity_ids_.unordered_erase(ent) ) {
@@ -2675,442 +9241,274 @@ namespace ecs_hpp
         }
     }
 
-    inline bool registry::valid_entity(const const_uentity& ent) const noexcept {
-        assert(ent.check_owner(this));
+    template < typename... Cs >
+    bool static_registry<Cs...>::valid_entity(entity_id ent) const noexcept {
         return entity_ids_.has(ent);
     }
 
+    template < typename... Cs >
     template < typename T, typename... Args >
-    T& registry::assign_component(const uentity& ent, Args&&... args) {
+    T& static_registry<Cs...>::assign_component(entity_id ent, Args&&... args) {
         assert(valid_entity(ent));
-        return get_or_create_storage_<T>().assign(
+        return storage_<T>().assign(
             ent,
             std::forward<Args>(args)...);
     }
 
+    template < typename... Cs >
     template < typename T, typename... Args >
-    T& registry::ensure_component(const uentity& ent, Args&&... args) {
+    T& static_registry<Cs...>::ensure_component(entity_id ent, Args&&... args) {
         assert(valid_entity(ent));
-        return get_or_create_storage_<T>().ensure(
+        return storage_<T>().ensure(
             ent,
             std::forward<Args>(args)...);
     }
 
+    template < typename... Cs >
     template < typename T >
-    bool registry::remove_component(const uentity& ent) noexcept {
+    bool static_registry<Cs...>::remove_component(entity_id ent) noexcept {
         assert(valid_entity(ent));
-        detail::component_storage<T>* storage = find_storage_<T>();
-        return storage
-            ? storage->remove(ent)
-            : false;
+        return storage_<T>().remove(ent);
     }
 
+    template < typename... Cs >
     template < typename T >
-    bool registry::exists_component(const const_uentity& ent) const noexcept {
+    bool static_registry<Cs...>::exists_component(entity_id ent) const noexcept {
         assert(valid_entity(ent));
-        const detail::component_storage<T>* storage = find_storage_<T>();
-        return storage
-            ? storage->exists(ent)
-            : false;
+        return storage_<T>().exists(ent);
     }
 
-    inline std::size_t registry::remove_all_components(const uentity& ent) noexcept {
+    template < typename... Cs >
+    std::size_t static_registry<Cs...>::remove_all_components(entity_id ent) noexcept {
         assert(valid_entity(ent));
-        std::size_t removed_count = 0u;
-        for ( const auto family : storages_ ) {
-            if ( storages_.get(family)->remove(ent) ) {
-                ++removed_count;
-            }
-        }
-        return removed_count;
+        return (std::size_t{0u} + ... + (storage_<Cs>().remove(ent) ? 1u : 0u));
     }
 
+    template < typename... Cs >
     template < typename T >
-    std::size_t registry::remove_all_components() noexcept {
-        detail::component_storage<T>* storage = find_storage_<T>();
-        return storage
-            ? storage->remove_all()
-            : 0u;
+    std::size_t static_registry<Cs...>::remove_all_components() noexcept {
+        return storage_<T>().remove_all();
     }
 
+    template < typename... Cs >
     template < typename T >
-    T& registry::get_component(const uentity& ent) {
+    T& static_registry<Cs...>::get_component(entity_id ent) {
         assert(valid_entity(ent));
         if ( T* component = find_component<T>(ent) ) {
             return *component;
         }
-        throw std::logic_error("ecs_hpp::registry (component not found)");
+        detail::throw_logic_error("ecs_hpp::static_registry (component not found)");
     }
 
+    template < typename... Cs >
     template < typename T >
-    const T& registry::get_component(const const_uentity& ent) const {
+    const T& static_registry<Cs...>::get_component(entity_id ent) const {
         assert(valid_entity(ent));
         if ( const T* component = find_component<T>(ent) ) {
             return *component;
         }
-        throw std::logic_error("ecs_hpp::registry (component not found)");
+        detail::throw_logic_error("ecs_hpp::static_registry (component not found)");
     }
 
+    template < typename... Cs >
     template < typename T >
-    T* registry::find_component(const uentity& ent) noexcept {
+    T* static_registry<Cs...>::find_component(entity_id ent) noexcept {
         assert(valid_entity(ent));
-        detail::component_storage<T>* storage = find_storage_<T>();
-        return storage
-            ? storage->find(ent)
-            : nullptr;
+        return storage_<T>().find(ent);
     }
 
+    template < typename... Cs >
     template < typename T >
-    const T* registry::find_component(const const_uentity& ent) const noexcept {
+    const T* static_registry<Cs...>::find_component(entity_id ent) const noexcept {
         assert(valid_entity(ent));
-        const detail::component_storage<T>* storage = find_storage_<T>();
-        return storage
-            ? storage->find(ent)
-            : nullptr;
+        return storage_<T>().find(ent);
     }
 
+    template < typename... Cs >
     template < typename... Ts >
-    std::tuple<Ts&...> registry::get_components(const uentity& ent) {
+    std::tuple<Ts&...> static_registry<Cs...>::get_components(entity_id ent) {
         (void)ent;
         assert(valid_entity(ent));
         return std::make_tuple(std::ref(get_component<Ts>(ent))...);
     }
 
+    template < typename... Cs >
     template < typename... Ts >
-    std::tuple<const Ts&...> registry::get_components(const const_uentity& ent) const {
+    std::tuple<const Ts&...> static_registry<Cs...>::get_components(entity_id ent) const {
         (void)ent;
         assert(valid_entity(ent));
         return std::make_tuple(std::cref(get_component<Ts>(ent))...);
     }
 
+    template < typename... Cs >
     template < typename... Ts >
-    std::tuple<Ts*...> registry::find_components(const uentity& ent) noexcept {
+    std::tuple<Ts*...> static_registry<Cs...>::find_components(entity_id ent) noexcept {
         (void)ent;
         assert(valid_entity(ent));
         return std::make_tuple(find_component<Ts>(ent)...);
     }
 
+    template < typename... Cs >
     template < typename... Ts >
-    std::tuple<const Ts*...> registry::find_components(const const_uentity& ent) const noexcept {
+    std::tuple<const Ts*...> static_registry<Cs...>::find_components(entity_id ent) const noexcept {
         (void)ent;
         assert(valid_entity(ent));
         return std::make_tuple(find_component<Ts>(ent)...);
     }
 
+    template < typename... Cs >
     template < typename T >
-    std::size_t registry::component_count() const noexcept {
-        const detail::component_storage<T>* storage = find_storage_<T>();
-        return storage
-            ? storage->count()
-            : 0u;
+    std::size_t static_registry<Cs...>::component_count() const noexcept {
+        return storage_<T>().count();
     }
 
-    inline std::size_t registry::entity_count() const noexcept {
+    template < typename... Cs >
+    std::size_t static_registry<Cs...>::entity_count() const noexcept {
         return entity_ids_.size();
     }
 
-    inline std::size_t registry::entity_component_count(const const_uentity& ent) const noexcept {
+    template < typename... Cs >
+    std::size_t static_registry<Cs...>::entity_component_count(entity_id ent) const noexcept {
         assert(valid_entity(ent));
-        std::size_t component_count = 0u;
-        for ( const auto family : storages_ ) {
-            if ( storages_.get(family)->has(ent) ) {
-                ++component_count;
-            }
-        }
-        return component_count;
+        return (std::size_t{0u} + ... + (storage_<Cs>().has(ent) ? 1u : 0u));
     }
 
+    template < typename... Cs >
     template < typename F, typename... Opts >
-    void registry::for_each_entity(F&& f, Opts&&... opts) {
-        std::unique_lock lock(mutexes_.entity_ids_locker_);
+    void static_registry<Cs...>::for_each_entity(F&& f, Opts&&... opts) {
+        std::unique_lock lock(entity_ids_locker_);
         for ( const auto e : entity_ids_ ) {
-            if ( uentity ent{*this, e}; (... && opts(ent)) ) {
-                f(ent);
+            if ( (... && opts(const_entity{*this, e})) ) {
+                f(entity{*this, e});
             }
         }
     }
 
+    template < typename... Cs >
     template < typename F, typename... Opts >
-    void registry::for_each_entity(F&& f, Opts&&... opts) const {
-        std::shared_lock lock(mutexes_.entity_ids_locker_);
+    void static_registry<Cs...>::for_each_entity(F&& f, Opts&&... opts) const {
+        std::shared_lock lock(entity_ids_locker_);
         for ( const auto e : entity_ids_ ) {
-            if ( const_uentity ent{*this, e}; (... && opts(ent)) ) {
+            if ( const_entity ent{*this, e}; (... && opts(ent)) ) {
                 f(ent);
             }
         }
     }
 
+    template < typename... Cs >
     template < typename T, typename F, typename... Opts >
-    void registry::for_each_component(F&& f, Opts&&... opts) {
-        if ( detail::component_storage<T>* storage = find_storage_<T>() ) {
-            storage->for_each_component([this, &f, &opts...](const entity_id e, T& t){
-                if ( uentity ent{*this, e}; (... && opts(ent)) ) {
-                    f(ent, t);
-                }
-            });
-        }
+    void static_registry<Cs...>::for_each_component(F&& f, Opts&&... opts) {
+        storage_<T>().for_each_component([this, &f, &opts...](const entity_id e, T& t){
+            if ( (... && opts(const_entity{*this, e})) ) {
+                f(entity{*this, e}, t);
+            }
+        });
     }
 
+    template < typename... Cs >
     template < typename T, typename F, typename... Opts >
-    void registry::for_each_component(F&& f, Opts&&... opts) const {
-        if ( const detail::component_storage<T>* storage = find_storage_<T>() ) {
-            storage->for_each_component([this, &f, &opts...](const entity_id e, const T& t){
-                if ( const_uentity ent{*this, e}; (... && opts(ent)) ) {
-                    f(ent, t);
-                }
-            });
-        }
-    }
-
-    template < typename... Ts, typename F, typename... Opts >
-    void registry::for_joined_components(F&& f, Opts&&... opts) {
-        for_joined_components_impl_<Ts...>(
-            std::make_index_sequence<sizeof...(Ts)>(),
-            std::forward<F>(f),
-            std::forward<Opts>(opts)...);
+    void static_registry<Cs...>::for_each_component(F&& f, Opts&&... opts) const {
+        storage_<T>().for_each_component([this, &f, &opts...](const entity_id e, const T& t){
+            if ( const_entity ent{*this, e}; (... && opts(ent)) ) {
+                f(ent, t);
+            }
+        });
     }
 
+    template < typename... Cs >
     template < typename... Ts, typename F, typename... Opts >
-    void registry::for_joined_components(F&& f, Opts&&... opts) const {
-        for_joined_components_impl_<Ts...>(
-            std::make_index_sequence<sizeof...(Ts)>(),
-            std::forward<F>(f),
-            std::forward<Opts>(opts)...);
-    }
-
-    template < typename Tag, typename... Args >
-    feature& registry::assign_feature(Args&&... args) {
-        const auto feature_id = detail::type_family<Tag>::id();
-        std::unique_lock lock(mutexes_.features_locker_);
-        if (feature * f = features_.find(feature_id))
-        {
-            return *f = feature{std::forward<Args>(args)...};
-        }
-        return *features_.insert(feature_id, feature{std::forward<Args>(args)...}).first;
-    }
-
-    template < typename Tag, typename... Args >
-    feature& registry::ensure_feature(Args&&... args) {
-        const auto feature_id = detail::type_family<Tag>::id();
-        std::unique_lock lock(mutexes_.features_locker_);
-        if (feature * f = features_.find(feature_id))
-        {
-            return *f;
-        }
-        return *features_.insert(feature_id, feature{std::forward<Args>(args)...}).first;
-    }
-
-    template < typename Tag >
-    bool registry::has_feature() const noexcept {
-        const auto feature_id = detail::type_family<Tag>::id();
-        std::shared_lock lock(mutexes_.features_locker_);
-        return features_.has(feature_id);
-    }
-
-    template < typename Tag >
-    feature& registry::get_feature() {
-        const auto feature_id = detail::type_family<Tag>::id();
-        std::shared_lock lock(mutexes_.features_locker_);
-        if (feature * f = features_.find(feature_id))
-        {
-            return *f;
-        }
-        throw std::logic_error("ecs_hpp::registry (feature not found)");
-    }
-
-    template < typename Tag >
-    const feature& registry::get_feature() const {
-        const auto feature_id = detail::type_family<Tag>::id();
-        std::shared_lock lock(mutexes_.features_locker_);
-        if ( const feature* f = features_.find(feature_id) ) {
-            return *f;
+    void static_registry<Cs...>::for_joined_components(F&& f, Opts&&... opts) {
+        using terms = detail::join_terms<Ts...>;
+        if constexpr ( !terms::has_driver ) {
+            const auto ss = std::make_tuple(
+                &storage_<detail::join_term_component_t<Ts>>()...);
+            for_each_entity([&f, &ss](const entity& e){
+                terms::invoke(e, ss, f);
+            }, std::forward<Opts>(opts)...);
+        } else {
+            for_joined_components_impl_<Ts...>(
+                std::forward<F>(f),
+                std::forward<Opts>(opts)...);
         }
-        throw std::logic_error("ecs_hpp::registry (feature not found)");
     }
 
-    template < typename Event >
-    registry& registry::process_event(const Event& event) {
-        std::shared_lock lock(mutexes_.features_locker_);
-        for (const auto family : features_)
-        {
-            if ( feature& f = features_.get(family); f.is_enabled() ) {
-                f.process_event(*this, event);
-            }
+    template < typename... Cs >
+    template < typename... Ts, typename F, typename... Opts >
+    void static_registry<Cs...>::for_joined_components(F&& f, Opts&&... opts) const {
+        using terms = detail::join_terms<Ts...>;
+        if constexpr ( !terms::has_driver ) {
+            const auto ss = std::make_tuple(
+                &storage_<detail::join_term_component_t<Ts>>()...);
+            for_each_entity([&f, &ss](const const_entity& e){
+                terms::invoke(e, ss, f);
+            }, std::forward<Opts>(opts)...);
+        } else {
+            for_joined_components_impl_<Ts...>(
+                std::forward<F>(f),
+                std::forward<Opts>(opts)...);
         }
-        return *this;
     }
 
-    inline registry::memory_usage_info registry::memory_usage() const noexcept {
+    template < typename... Cs >
+    typename static_registry<Cs...>::memory_usage_info
+    static_registry<Cs...>::memory_usage() const noexcept {
         memory_usage_info info;
-        std::shared_lock lock(mutexes_.features_locker_);
+        std::shared_lock lock(entity_ids_locker_);
         info.entities += free_entity_ids_.capacity() * sizeof(free_entity_ids_[0]);
         info.entities += entity_ids_.memory_usage();
-        for ( const auto family : storages_ ) {
-            info.components += storages_.get(family)->memory_usage();
-        }
+        info.components += (std::size_t{0u} + ... + storage_<Cs>().memory_usage());
         return info;
     }
 
+    template < typename... Cs >
     template < typename T >
-    std::size_t registry::component_memory_usage() const noexcept {
-        const detail::component_storage<T>* storage = find_storage_<T>();
-        return storage
-            ? storage->memory_usage()
-            : 0u;
-    }
-
-    template < typename T >
-    detail::component_storage<T>* registry::find_storage_() noexcept {
-        const auto family = detail::type_family<T>::id();
-        using raw_storage_ptr = detail::component_storage<T>*;
-        const storage_uptr* storage_uptr_ptr = storages_.find(family);
-        return storage_uptr_ptr && *storage_uptr_ptr
-            ? static_cast<raw_storage_ptr>(storage_uptr_ptr->get())
-            : nullptr;
+    std::size_t static_registry<Cs...>::component_memory_usage() const noexcept {
+        return storage_<T>().memory_usage();
     }
 
+    template < typename... Cs >
     template < typename T >
-    const detail::component_storage<T>* registry::find_storage_() const noexcept {
-        const auto family = detail::type_family<T>::id();
-        using raw_storage_ptr = const detail::component_storage<T>*;
-        const storage_uptr* storage_uptr_ptr = storages_.find(family);
-        return storage_uptr_ptr && *storage_uptr_ptr
-            ? static_cast<raw_storage_ptr>(storage_uptr_ptr->get())
-            : nullptr;
+    detail::static_component_storage<T>& static_registry<Cs...>::storage_() noexcept {
+        static_assert(
+            has_component_type<T>,
+            "ecs_hpp::static_registry (unknown component type)");
+        return std::get<detail::static_component_storage<T>>(storages_);
     }
 
+    template < typename... Cs >
     template < typename T >
-    detail::component_storage<T>& registry::get_or_create_storage_() {
-        if ( detail::component_storage<T>* storage = find_storage_<T>() ) {
-            return *storage;
-        }
-        const auto family = detail::type_family<T>::id();
-        storages_.insert(
-            family,
-            std::make_unique<detail::component_storage<T>>(*this));
-        return *static_cast<detail::component_storage<T>*>(
-            storages_.get(family).get());
-    }
-
-    template < typename F, typename... Opts >
-    void registry::for_joined_components_impl_(
-        std::index_sequence<>,
-        F&& f,
-        Opts&&... opts)
-    {
-        for_each_entity(std::forward<F>(f), std::forward<Opts>(opts)...);
-    }
-
-    template < typename F, typename... Opts >
-    void registry::for_joined_components_impl_(
-        std::index_sequence<>,
-        F&& f,
-        Opts&&... opts) const
-    {
-        for_each_entity(std::forward<F>(f), std::forward<Opts>(opts)...);
-    }
-
-    template < typename T
-             , typename... Ts
-             , typename F
-             , typename... Opts
-             , std::size_t I
-             , std::size_t... Is >
-    void registry::for_joined_components_impl_(
-        std::index_sequence<I, Is...>,
-        F&& f,
-        Opts&&... opts)
-    {
-        const auto ss = std::make_tuple(find_storage_<Ts>()...);
-        if ( detail::tuple_contains(ss, nullptr) ) {
-            return;
-        }
-        for_each_component<T>([this, &f, &ss](const uentity& e, T& t) {
-            for_joined_components_impl_<Ts...>(e, f, ss, t);
-        }, std::forward<Opts>(opts)...);
-    }
-
-    template < typename T
-             , typename... Ts
-             , typename F
-             , typename... Opts
-             , std::size_t I
-             , std::size_t... Is >
-    void registry::for_joined_components_impl_(
-        std::index_sequence<I, Is...>,
-        F&& f,
-        Opts&&... opts) const
-    {
-        const auto ss = std::make_tuple(find_storage_<Ts>()...);
-        if ( detail::tuple_contains(ss, nullptr) ) {
-            return;
-        }
-        for_each_component<T>([this, &f, &ss](const const_uentity& e, const T& t) {
-            std::as_const(*this).for_joined_components_impl_<Ts...>(e, f, ss, t);
-        }, std::forward<Opts>(opts)...);
-    }
-
-    template < typename T
-             , typename... Ts
-             , typename F
-             , typename Ss
-             , typename... Cs >
-    void registry::for_joined_components_impl_(
-        const uentity& e,
-        const F& f,
-        const Ss& ss,
-        Cs&... cs)
-    {
-        if ( T* c = std::get<0>(ss)->find(e) ) {
-            for_joined_components_impl_<Ts...>(
-                e,
-                f,
-                detail::tuple_tail(ss),
-                cs...,
-                *c);
-        }
-    }
-
-    template < typename T
-             , typename... Ts
-             , typename F
-             , typename Ss
-             , typename... Cs >
-    void registry::for_joined_components_impl_(
-        const const_uentity& e,
-        const F& f,
-        const Ss& ss,
-        const Cs&... cs) const
-    {
-        if ( const T* c = std::get<0>(ss)->find(e) ) {
-            for_joined_components_impl_<Ts...>(
-                e,
-                f,
-                detail::tuple_tail(ss),
-                cs...,
-                *c);
-        }
+    const detail::static_component_storage<T>& static_registry<Cs...>::storage_() const noexcept {
+        static_assert(
+            has_component_type<T>,
+            "ecs_hpp::static_registry (unknown component type)");
+        return std::get<detail::static_component_storage<T>>(storages_);
     }
 
-    template < typename F, typename... Cs >
-    void registry::for_joined_components_impl_(
-        const uentity& e,
-        const F& f,
-        const std::tuple<>& ss,
-        Cs&... cs)
-    {
-        (void)ss;
-        f(e, cs...);
+    template < typename... Cs >
+    template < typename... Ts, typename F, typename... Opts >
+    void static_registry<Cs...>::for_joined_components_impl_(F&& f, Opts&&... opts) {
+        using terms = detail::join_terms<Ts...>;
+        using driver_t = typename terms::driver_type;
+        const auto ss = std::make_tuple(
+            &storage_<detail::join_term_component_t<Ts>>()...);
+        storage_<driver_t>().for_each_component([this, &f, &ss, &opts...](const entity_id e, driver_t& d){
+            if ( (... && opts(const_entity{*this, e})) ) {
+                terms::invoke(entity{*this, e}, ss, &d, f);
+            }
+        });
     }
 
-    template < typename F, typename... Cs >
-    void registry::for_joined_components_impl_(
-        const const_uentity& e,
-        const F& f,
-        const std::tuple<>& ss,
-        const Cs&... cs) const
-    {
-        (void)ss;
-        f(e, cs...);
+    template < typename... Cs >
+    template < typename... Ts, typename F, typename... Opts >
+    void static_registry<Cs...>::for_joined_components_impl_(F&& f, Opts&&... opts) const {
+        using terms = detail::join_terms<Ts...>;
+        using driver_t = typename terms::driver_type;
+        const auto ss = std::make_tuple(
+            &storage_<detail::join_term_component_t<Ts>>()...);
+        storage_<driver_t>().for_each_component([this, &f, &ss, &opts...](const entity_id e, const driver_t& d){
+            if ( const_entity ent{*this, e}; (... && opts(ent)) ) {
+                terms::invoke(ent, ss, &d, f);
+            }
+        });
     }
 }
@@ -7,6 +7,8 @@
 #include <ecs.hpp/ecs.hpp>
 #include "doctest/doctest.h"
 
+#include <thread>
+
 namespace ecs = ecs_hpp;
 
 namespace
@@ -28,8 +30,37 @@ namespace
     };
 
     struct movable_c{};
+
+    struct mesh_s {
+        int id{0};
+        mesh_s(int nid = 0) : id(nid) {}
+        bool operator==(const mesh_s& other) const noexcept {
+            return id == other.id;
+        }
+    };
     struct disabled_c{};
 
+    struct static_family_c{};
+
+    struct move_throwing_c {
+        static inline int moves_left{-1};
+
+        int value{0};
+
+        move_throwing_c(int v = 0) : value(v) {}
+        move_throwing_c(const move_throwing_c&) = default;
+        move_throwing_c(move_throwing_c&& other) : value(other.value) {
+            if ( moves_left == 0 ) {
+                throw std::logic_error("move_throwing_c");
+            }
+            if ( moves_left > 0 ) {
+                --moves_left;
+            }
+        }
+        move_throwing_c& operator=(const move_throwing_c&) = default;
+        move_throwing_c& operator=(move_throwing_c&&) = default;
+    };
+
     static_assert(std::is_empty_v<movable_c>, "!!!");
     static_assert(std::is_empty_v<disabled_c>, "!!!");
 
@@ -55,8 +86,40 @@ namespace
             return static_cast<std::size_t>(v.x);
         }
     };
+
+    class counting_resource final : public std::pmr::memory_resource {
+    public:
+        std::size_t allocations{0u};
+        std::size_t allocated_bytes{0u};
+    private:
+        void* do_allocate(std::size_t bytes, std::size_t alignment) override {
+            ++allocations;
+            allocated_bytes += bytes;
+            return std::pmr::new_delete_resource()->allocate(bytes, alignment);
+        }
+
+        void do_deallocate(void* p, std::size_t bytes, std::size_t alignment) override {
+            allocated_bytes -= bytes;
+            std::pmr::new_delete_resource()->deallocate(p, bytes, alignment);
+        }
+
+        bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override {
+            return this == &other;
+        }
+    };
 }
 
+template <>
+struct ecs_hpp::static_family_id<static_family_c>
+: std::integral_constant<ecs_hpp::family_id, 7u> {};
+
+template <>
+struct ecs_hpp::shared_component_hash<mesh_s> {
+    std::size_t operator()(const mesh_s& m) const noexcept {
+        return std::hash<int>()(m.id);
+    }
+};
+
 TEST_CASE("detail") {
     SUBCASE("get_type_id") {
         using namespace ecs::detail;
@@ -73,6 +136,24 @@ TEST_CASE("detail") {
 
         REQUIRE(p_id == type_family<position_c>::id());
         REQUIRE(v_id == type_family<velocity_c>::id());
+
+        REQUIRE(p_id >= ecs::static_family_id_limit);
+        REQUIRE(v_id >= ecs::static_family_id_limit);
+    }
+    SUBCASE("static_family_id") {
+        using namespace ecs::detail;
+
+        static_assert(has_static_family_id_v<static_family_c>);
+        static_assert(!has_static_family_id_v<position_c>);
+
+        REQUIRE(type_family<static_family_c>::id() == 7u);
+        REQUIRE(type_family<static_family_c>::id() != type_family<position_c>::id());
+
+        ecs::registry w;
+        auto e = w.create_entity();
+        e.assign_component<static_family_c>();
+        REQUIRE(e.exists_component<static_family_c>());
+        REQUIRE(w.component_count<static_family_c>() == 1u);
     }
     SUBCASE("tuple_tail") {
         using namespace ecs::detail;
@@ -311,6 +392,53 @@ TEST_CASE("detail") {
             REQUIRE(m.size() == 2);
         }
     }
+    SUBCASE("object_arena") {
+        using namespace ecs::detail;
+        {
+            struct obj_t {
+                int& counter;
+                std::size_t padding[100]{};
+                obj_t(int& c) : counter(c) { ++counter; }
+                ~obj_t() noexcept { --counter; }
+            };
+
+            int counter = 0;
+            {
+                object_arena a;
+                REQUIRE(a.empty());
+
+                std::vector<obj_t*> objs;
+                for ( std::size_t i = 0; i < 20u; ++i ) {
+                    objs.push_back(a.create<obj_t>(counter));
+                    REQUIRE(reinterpret_cast<std::uintptr_t>(objs.back()) % alignof(obj_t) == 0u);
+                }
+                REQUIRE(counter == 20);
+                REQUIRE(a.size() == 20u);
+
+                object_arena a2{std::move(a)};
+                REQUIRE(a.empty());
+                REQUIRE(a2.size() == 20u);
+                REQUIRE(counter == 20);
+
+                a2.clear();
+                REQUIRE(a2.empty());
+                REQUIRE(counter == 0);
+
+                a2.create<obj_t>(counter);
+                REQUIRE(counter == 1);
+            }
+            REQUIRE(counter == 0);
+        }
+        {
+            ecs::registry w;
+            const auto e = w.create_entity().id();
+            w.assign_component<position_c>(e, 1, 2);
+
+            ecs::registry w2{std::move(w)};
+            REQUIRE(w2.component_count<position_c>() == 1u);
+            REQUIRE(w2.get_component<position_c>(e) == position_c(1, 2));
+        }
+    }
 }
 
 TEST_CASE("registry") {
@@ -735,6 +863,237 @@ TEST_CASE("registry") {
             REQUIRE(c2 == velocity_c(0,0));
         }
     }
+    SUBCASE("prototype_inheritance") {
+        const auto base = std::make_shared<const ecs::prototype>(ecs::prototype()
+            .component<position_c>(1, 2)
+            .component<velocity_c>(3, 4));
+
+        const auto variant = std::make_shared<const ecs::prototype>(ecs::prototype(base)
+            .component<velocity_c>(5, 6)
+            .component<movable_c>());
+
+        const auto leaf = ecs::prototype()
+            .inherit(variant)
+            .component<position_c>(7, 8);
+
+        REQUIRE(leaf.parent().get() == variant.get());
+        REQUIRE(variant->parent().get() == base.get());
+        REQUIRE_FALSE(leaf.empty());
+        REQUIRE(leaf.has_component<velocity_c>());
+        REQUIRE(leaf.has_component<movable_c>());
+        REQUIRE_FALSE(base->has_component<movable_c>());
+
+        ecs::registry w;
+        {
+            const auto e1 = w.create_entity(*variant);
+            REQUIRE(e1.component_count() == 3u);
+            REQUIRE(e1.get_component<position_c>() == position_c(1,2));
+            REQUIRE(e1.get_component<velocity_c>() == velocity_c(5,6));
+
+            const auto e2 = w.create_entity(leaf);
+            REQUIRE(e2.component_count() == 3u);
+            REQUIRE(e2.get_component<position_c>() == position_c(7,8));
+            REQUIRE(e2.get_component<velocity_c>() == velocity_c(5,6));
+
+            const auto e3 = w.create_entity(leaf.compile(w));
+            REQUIRE(e3.get_component<position_c>() == position_c(7,8));
+            REQUIRE(e3.exists_component<movable_c>());
+        }
+        {
+            ecs::prototype copy = leaf;
+            copy.component<velocity_c>(9, 10);
+            REQUIRE(w.create_entity(copy).get_component<velocity_c>() == velocity_c(9,10));
+            REQUIRE(w.create_entity(leaf).get_component<velocity_c>() == velocity_c(5,6));
+
+            velocity_c v;
+            REQUIRE(leaf.apply_to_component(v));
+            REQUIRE(v == velocity_c(5,6));
+
+            const auto merged = ecs::prototype()
+                .component<velocity_c>(0, 0)
+                .merge_with(leaf, false);
+            REQUIRE(w.create_entity(merged).get_component<velocity_c>() == velocity_c(0,0));
+            REQUIRE(w.create_entity(merged).get_component<position_c>() == position_c(7,8));
+
+            copy.clear();
+            REQUIRE(copy.empty());
+            REQUIRE_FALSE(copy.parent().get());
+        }
+    }
+    SUBCASE("compiled_prototypes") {
+        ecs::registry w;
+        {
+            const auto compiled = ecs::prototype()
+                .component<position_c>(1, 2)
+                .component<velocity_c>(3, 4)
+                .component<movable_c>()
+                .shared_component<mesh_s>(5)
+                .compile(w);
+            REQUIRE(compiled.component_count() == 4u);
+            REQUIRE(&compiled.owner() == &w);
+
+            const auto e1 = w.create_entity(compiled);
+            const auto e2 = w.create_entity(compiled);
+            REQUIRE(w.entity_count() == 2u);
+            REQUIRE(e1.component_count() == 4u);
+            REQUIRE(e1.get_component<position_c>() == position_c(1,2));
+            REQUIRE(e2.get_component<velocity_c>() == velocity_c(3,4));
+            REQUIRE(e2.exists_component<movable_c>());
+            REQUIRE(w.get_shared_component<mesh_s>(e1).id == 5);
+            REQUIRE(w.shared_value_count<mesh_s>() == 1u);
+        }
+        {
+            ecs::compiled_prototype compiled(w);
+            REQUIRE(compiled.empty());
+            compiled
+                .component<position_c>(1, 2)
+                .component<position_c>(3, 4);
+            REQUIRE(compiled.component_count() == 1u);
+
+            const ecs::compiled_prototype moved = std::move(compiled);
+            const auto e1 = w.create_entity(moved);
+            REQUIRE(e1.component_count() == 1u);
+            REQUIRE(e1.get_component<position_c>() == position_c(3,4));
+        }
+        {
+            counting_resource res;
+            ecs::registry w2(&res);
+            ecs::compiled_prototype compiled(w2);
+            compiled
+                .component<position_c>(0, 0)
+                .shared_component<mesh_s>(0);
+            const std::size_t allocated_bytes = res.allocated_bytes;
+            for ( int i = 1; i <= 10000; ++i ) {
+                compiled
+                    .component<position_c>(i, -i)
+                    .shared_component<mesh_s>(i);
+            }
+            REQUIRE(res.allocated_bytes == allocated_bytes);
+            REQUIRE(compiled.component_count() == 2u);
+
+            const auto e1 = w2.create_entity(compiled);
+            REQUIRE(e1.get_component<position_c>() == position_c(10000,-10000));
+            REQUIRE(w2.get_shared_component<mesh_s>(e1).id == 10000);
+        }
+        {
+            const auto proto = ecs::prototype()
+                .component<position_c>(1, 2)
+                .component<movable_c>()
+                .shared_component<mesh_s>(7);
+
+            std::vector<ecs::entity> es;
+            w.instantiate(proto, 100u, std::back_inserter(es));
+            REQUIRE(es.size() == 100u);
+            for ( const auto& e : es ) {
+                REQUIRE(e.valid());
+                REQUIRE(e.get_component<position_c>() == position_c(1,2));
+                REQUIRE(e.exists_component<movable_c>());
+                REQUIRE(w.get_shared_component<mesh_s>(e).id == 7);
+            }
+            REQUIRE(w.component_count<movable_c>() == 102u);
+
+            w.destroy_entity(es[10]);
+            w.destroy_entity(es[20]);
+            const std::size_t entity_count = w.entity_count();
+
+            std::vector<ecs::entity> es2;
+            w.instantiate(proto.compile(w), 3u, std::back_inserter(es2));
+            REQUIRE(w.entity_count() == entity_count + 3u);
+            REQUIRE_FALSE(es[10].valid());
+            REQUIRE(es2[0].get_component<position_c>() == position_c(1,2));
+            REQUIRE(es2[1].id() != es[10].id());
+        }
+        {
+            struct throwing_c {
+                throwing_c() = default;
+                throwing_c(throwing_c&&) = default;
+                throwing_c(const throwing_c&) {
+                    throw std::logic_error("throwing_c");
+                }
+                throwing_c& operator=(throwing_c&&) = default;
+                throwing_c& operator=(const throwing_c&) = default;
+                int value{0};
+            };
+
+            const ecs::compiled_prototype compiled = ecs::compiled_prototype(w)
+                .component<position_c>(1, 2)
+                .component<throwing_c>();
+            const std::size_t entity_count = w.entity_count();
+            const std::size_t position_count = w.component_count<position_c>();
+            REQUIRE_THROWS_AS(w.create_entity(compiled), std::logic_error);
+            REQUIRE(w.entity_count() == entity_count);
+            REQUIRE(w.component_count<position_c>() == position_count);
+            REQUIRE(w.component_count<throwing_c>() == 0u);
+
+            std::vector<ecs::entity> es;
+            REQUIRE_THROWS_AS(
+                w.instantiate(compiled, 10u, std::back_inserter(es)),
+                std::logic_error);
+            REQUIRE(es.empty());
+            REQUIRE(w.entity_count() == entity_count);
+            REQUIRE(w.component_count<position_c>() == position_count);
+            REQUIRE(w.component_count<throwing_c>() == 0u);
+
+            ecs::entity source = w.create_entity();
+            source.assign_component<position_c>(3, 4);
+            source.assign_component<throwing_c>();
+            REQUIRE_THROWS_AS(w.create_entity(source), std::logic_error);
+            REQUIRE(w.entity_count() == entity_count + 1u);
+            REQUIRE(w.component_count<position_c>() == position_count + 1u);
+            REQUIRE(w.component_count<throwing_c>() == 1u);
+        }
+    }
+    SUBCASE("prototype_capture") {
+        ecs::registry w;
+        auto e1 = w.create_entity();
+        e1.assign_component<position_c>(1, 2);
+        e1.assign_component<movable_c>();
+        w.assign_shared_component<mesh_s>(e1, 5);
+
+        auto e2 = w.create_entity();
+        e2.assign_component<velocity_c>(3, 4);
+        {
+            const auto compiled = ecs::prototype::capture(e1);
+            REQUIRE(compiled.component_count() == 3u);
+
+            e1.get_component<position_c>() = position_c(9, 9);
+            const auto e3 = w.create_entity(compiled);
+            REQUIRE(e3.component_count() == 3u);
+            REQUIRE(e3.get_component<position_c>() == position_c(1,2));
+            REQUIRE(e3.exists_component<movable_c>());
+            REQUIRE_FALSE(e3.exists_component<velocity_c>());
+            REQUIRE(w.get_shared_component<mesh_s>(e3).id == 5);
+            REQUIRE(w.shared_value_count<mesh_s>() == 1u);
+        }
+        {
+            e1.remove_component<position_c>();
+            const auto compiled = ecs::prototype::capture(e1);
+            REQUIRE(compiled.component_count() == 2u);
+
+            const auto e4 = e2.clone();
+            REQUIRE(e4.component_count() == 1u);
+            REQUIRE(e4.get_component<velocity_c>() == velocity_c(3,4));
+        }
+        {
+            ecs::registry w2;
+            const auto compiled = ecs::compiled_prototype(w2)
+                .capture(e2)
+                .component<movable_c>();
+            REQUIRE(&compiled.owner() == &w2);
+            REQUIRE(compiled.component_count() == 2u);
+
+            const auto e5 = w2.create_entity(compiled);
+            REQUIRE(e5.get_component<velocity_c>() == velocity_c(3,4));
+            REQUIRE(e5.exists_component<movable_c>());
+            REQUIRE(w2.entity_count() == 1u);
+        }
+        {
+            w.destroy_entity(e2);
+            const auto e6 = w.create_entity();
+            REQUIRE(ecs::prototype::capture(e6).empty());
+            REQUIRE(e6.component_count() == 0u);
+        }
+    }
     SUBCASE("component_assigning") {
         {
             ecs::registry w;
@@ -1190,107 +1549,1315 @@ TEST_CASE("registry") {
             });
         }
     }
-    SUBCASE("aspects") {
-        {
-            using empty_aspect = ecs::aspect<>;
-
-            ecs::registry w;
+    SUBCASE("join_terms") {
+        ecs::registry w;
 
-            ecs::entity e1 = w.create_entity();
-            REQUIRE(empty_aspect::match_entity(e1));
+        auto e1 = w.create_entity();
+        ecs::entity_filler(e1)
+            .component<position_c>(1, 2)
+            .component<velocity_c>(3, 4);
 
-            ecs::entity e2 = w.create_entity();
-            e2.assign_component<movable_c>();
-            e2.assign_component<position_c>(1,2);
-            REQUIRE(empty_aspect::match_entity(e2));
+        auto e2 = w.create_entity();
+        ecs::entity_filler(e2)
+            .component<position_c>(5, 6)
+            .component<velocity_c>(7, 8)
+            .component<disabled_c>();
 
-            ecs::entity e3 = w.create_entity();
-            e3.assign_component<movable_c>();
-            e3.assign_component<position_c>(1,2);
-            e3.assign_component<velocity_c>(3,4);
-            REQUIRE(empty_aspect::match_entity(e3));
+        auto e3 = w.create_entity();
+        ecs::entity_filler(e3)
+            .component<position_c>(9, 10)
+            .component<movable_c>();
 
+        {
+            ecs::entity_id acc = 0;
+            w.for_joined_components<position_c, velocity_c, ecs::without<disabled_c>>([&acc](
+                ecs::entity e, position_c& p, const velocity_c& v)
             {
-                ecs::entity_id acc{};
-                empty_aspect::for_each_entity(w, [&acc](ecs::entity e){
-                    acc += e.id();
-                }, ecs::exists<movable_c>{});
-                REQUIRE(acc == e2.id() + e3.id());
-            }
-
+                acc += e.id();
+                p.x += v.x;
+            });
+            REQUIRE(acc == e1.id());
+            REQUIRE(e1.get_component<position_c>() == position_c(4, 2));
+            REQUIRE(e2.get_component<position_c>() == position_c(5, 6));
+        }
+        {
+            ecs::entity_id acc = 0;
+            std::as_const(w).for_joined_components<ecs::maybe<velocity_c>, position_c>([&acc](
+                ecs::const_entity e, const velocity_c* v, const position_c& p)
             {
-                ecs::entity_id acc{};
-                empty_aspect::for_joined_components(w, [&acc](ecs::entity e){
-                    acc += e.id();
-                }, ecs::exists<movable_c>{});
-                REQUIRE(acc == e2.id() + e3.id());
-            }
-
+                acc += e.id();
+                REQUIRE(p.x > 0);
+                REQUIRE((v != nullptr) == e.exists_component<velocity_c>());
+            });
+            REQUIRE(acc == e1.id() + e2.id() + e3.id());
+        }
+        {
+            ecs::entity_id acc = 0;
+            w.for_joined_components<ecs::without<velocity_c>, ecs::maybe<movable_c>>([&acc](
+                ecs::entity e, movable_c* m)
             {
-                ecs::entity_id acc{};
-                w.for_each_entity([&acc](ecs::entity e){
-                    acc += e.id();
-                }, empty_aspect::to_option());
-                REQUIRE(acc == e1.id() + e2.id() + e3.id());
-            }
+                REQUIRE(m);
+                acc += e.id();
+            });
+            REQUIRE(acc == e3.id());
         }
         {
-            using movable = ecs::aspect<
-                position_c,
-                velocity_c>;
+            struct unused_c {};
+            std::size_t count = 0u;
+            w.for_joined_components<position_c, ecs::maybe<unused_c>>([&count](
+                ecs::entity, position_c&, unused_c* missing)
+            {
+                REQUIRE_FALSE(missing);
+                ++count;
+            }, ecs::exists<velocity_c>{});
+            w.for_joined_components<position_c, ecs::without<unused_c>>([&count](
+                ecs::entity, position_c&)
+            {
+                ++count;
+            });
+            w.for_joined_components<unused_c, ecs::without<position_c>>([&count](
+                ecs::entity, unused_c&)
+            {
+                ++count;
+            });
+            REQUIRE(count == 2u + 3u);
+        }
+        {
+            using active_movable = ecs::aspect<position_c, velocity_c, ecs::without<disabled_c>>;
+            REQUIRE(active_movable::match_entity(e1));
+            REQUIRE_FALSE(active_movable::match_entity(e2));
+            REQUIRE_FALSE(active_movable::match_entity(e3));
+
+            ecs::entity_id acc = 0;
+            active_movable::for_each_entity(w, [&acc](ecs::entity e){
+                acc += e.id();
+            });
+            w.for_each_entity([&acc](ecs::entity e){
+                acc += e.id();
+            }, active_movable::to_option());
+            REQUIRE(acc == e1.id() * 2u);
+        }
+    }
+    SUBCASE("hierarchy") {
+        ecs::registry w;
 
-            ecs::registry w;
+        auto root = w.create_entity();
+        auto e1 = w.create_entity();
+        auto e2 = w.create_entity();
+        auto e3 = w.create_entity();
+        auto e4 = w.create_entity();
+
+        w.set_parent(e3, e1);
+        w.set_parent(e1, root);
+        w.set_parent(e2, root);
+        w.set_parent(e4, e3);
+
+        REQUIRE_FALSE(w.has_parent(root));
+        REQUIRE(w.has_parent(e1));
+        REQUIRE(w.get_parent(e4) == e3);
+        REQUIRE(std::as_const(w).get_parent(e1) == root);
+        REQUIRE_THROWS_AS(w.get_parent(root), std::logic_error);
+        REQUIRE_THROWS_AS(w.set_parent(root, e4), std::logic_error);
+        REQUIRE_THROWS_AS(w.set_parent(e1, e1), std::logic_error);
+
+        REQUIRE(w.child_count(root) == 2u);
+        REQUIRE(w.child_count(e1) == 1u);
+        REQUIRE(w.child_count(e4) == 0u);
 
-            ecs::entity e = w.create_entity();
-            REQUIRE_FALSE(movable::match_entity(e));
+        {
+            std::vector<ecs::entity_id> children;
+            w.for_each_child(root, [&children](ecs::entity e){
+                children.push_back(e.id());
+            });
+            REQUIRE(children == std::vector<ecs::entity_id>{e1.id(), e2.id()});
+        }
+        {
+            std::vector<ecs::entity_id> order;
+            std::as_const(w).for_each_in_hierarchy([&order, &root](ecs::const_entity e, ecs::const_entity parent){
+                REQUIRE(parent.valid() == (e.id() != root.id()));
+                order.push_back(e.id());
+            });
+            REQUIRE(order == std::vector<ecs::entity_id>{
+                root.id(), e1.id(), e2.id(), e3.id(), e4.id()});
+        }
+        {
+            for ( auto e : {root, e1, e2, e3, e4} ) {
+                e.assign_component<position_c>(static_cast<int>(e.id()), 1);
+            }
+            w.set_parent(e3, e2);
+            REQUIRE(w.child_count(e1) == 0u);
+            REQUIRE(w.child_count(e2) == 1u);
 
-            e.assign_component<position_c>(1,2);
-            REQUIRE_FALSE(movable::match_entity(e));
+            w.for_each_in_hierarchy([](ecs::entity e, ecs::entity parent){
+                if ( parent.valid() ) {
+                    e.get_component<position_c>().y += parent.get_component<position_c>().y;
+                }
+            });
+            REQUIRE(e1.get_component<position_c>().y == 2);
+            REQUIRE(e3.get_component<position_c>().y == 3);
+            REQUIRE(e4.get_component<position_c>().y == 4);
 
-            e.assign_component<velocity_c>(3,4);
-            REQUIRE(movable::match_entity(e));
+            w.sort_components_by_hierarchy<position_c>();
+            std::vector<ecs::entity_id> order;
+            w.for_each_component<position_c>([&order](ecs::entity e, position_c&){
+                order.push_back(e.id());
+            });
+            REQUIRE(order == std::vector<ecs::entity_id>{
+                root.id(), e1.id(), e2.id(), e3.id(), e4.id()});
+            REQUIRE(e3.get_component<position_c>().y == 3);
+        }
+        {
+            REQUIRE(w.remove_parent(e1));
+            REQUIRE_FALSE(w.remove_parent(e1));
+            REQUIRE(w.child_count(root) == 1u);
 
-            ecs::entity e2 = w.create_entity();
-            e2.assign_component<position_c>(1,2);
+            w.destroy_entity(e2);
+            REQUIRE_FALSE(w.has_parent(e3));
+            REQUIRE(w.get_parent(e4) == e3);
 
-            movable::for_joined_components(w,
-            [](ecs::entity_id, position_c& p, const velocity_c& v){
-                p.x += v.x;
-                p.y += v.y;
+            w.set_parent(e3, root);
+            REQUIRE(w.destroy_hierarchy(root) == 3u);
+            REQUIRE(w.entity_count() == 1u);
+            REQUIRE(e1.valid());
+            REQUIRE_FALSE(e4.valid());
+            REQUIRE(w.component_count<position_c>() == 1u);
+        }
+        {
+            auto a = w.create_entity();
+            auto b = w.create_entity();
+            auto c = w.create_entity();
+            auto d = w.create_entity();
+            w.set_parent(b, a);
+            w.set_parent(d, a);
+            w.set_parent(c, b);
+
+            std::vector<ecs::entity_id> visited;
+            w.for_each_in_hierarchy([&](ecs::entity e, ecs::entity){
+                visited.push_back(e.id());
+                if ( e == a ) {
+                    REQUIRE(w.child_count(e) == 2u);
+                    w.destroy_entity(d);
+                    w.set_parent(e1, a);
+                }
             });
+            REQUIRE(std::find(visited.begin(), visited.end(), d.id()) == visited.end());
+            REQUIRE(std::find(visited.begin(), visited.end(), c.id()) != visited.end());
+            REQUIRE(w.child_count(a) == 2u);
 
-            movable::for_joined_components(std::as_const(w),
-            [](ecs::entity_id, const position_c& p, const velocity_c& v){
-                const_cast<position_c&>(p).x += v.x;
-                const_cast<position_c&>(p).y += v.y;
-            });
+            REQUIRE(w.destroy_hierarchy(a) == 4u);
+            REQUIRE(w.entity_count() == 0u);
+            REQUIRE(w.component_count<position_c>() == 0u);
+        }
+    }
+    SUBCASE("shared_components") {
+        ecs::registry w;
 
-            w.for_each_entity([](ecs::entity e){
-                auto& p = e.get_component<position_c>();
-                const auto& v = e.get_component<velocity_c>();
-                p.x += v.x;
-                p.y += v.y;
-            }, movable::to_option());
+        auto e1 = w.create_entity();
+        auto e2 = w.create_entity();
+        auto e3 = w.create_entity();
+
+        const mesh_s& m1 = w.assign_shared_component<mesh_s>(e1, 1);
+        REQUIRE(&w.assign_shared_component<mesh_s>(e2, 1) == &m1);
+        w.assign_shared_component<mesh_s>(e3, 2);
+
+        REQUIRE(w.shared_component_count<mesh_s>() == 3u);
+        REQUIRE(w.shared_value_count<mesh_s>() == 2u);
+        REQUIRE(w.exists_shared_component<mesh_s>(e1));
+        REQUIRE_FALSE(w.exists_shared_component<position_c>(e1));
+        REQUIRE(&w.get_shared_component<mesh_s>(e2) == &w.get_shared_component<mesh_s>(e1));
+        REQUIRE(w.find_shared_component<mesh_s>(e3)->id == 2);
+        REQUIRE(w.entity_component_count(e1) == 1u);
+
+        REQUIRE(w.patch_shared_component<mesh_s>(e2, [](mesh_s& m){ m.id = 2; }).id == 2);
+        REQUIRE(w.get_shared_component<mesh_s>(e1).id == 1);
+        REQUIRE(w.shared_value_count<mesh_s>() == 2u);
+        REQUIRE(&w.get_shared_component<mesh_s>(e2) == &w.get_shared_component<mesh_s>(e3));
+
+        w.patch_shared_component<mesh_s>(e1, [](mesh_s& m){ m.id = 3; });
+        REQUIRE(w.shared_value_count<mesh_s>() == 2u);
+        REQUIRE(w.get_shared_component<mesh_s>(e1).id == 3);
+        REQUIRE_THROWS_AS(w.patch_shared_component<int>(e1, [](int&){}), std::logic_error);
 
-            std::as_const(w).for_each_entity([](const ecs::const_entity& e){
-                const auto& p = e.get_component<position_c>();
-                const auto& v = e.get_component<velocity_c>();
-                const_cast<position_c&>(p).x += v.x;
-                const_cast<position_c&>(p).y += v.y;
-            }, movable::to_option());
+        {
+            std::vector<int> ids;
+            std::as_const(w).for_each_shared_component<mesh_s>([&ids](ecs::const_entity, const mesh_s& m){
+                ids.push_back(m.id);
+            });
+            REQUIRE(ids.size() == 3u);
+            REQUIRE((ids[0] == ids[1] || ids[1] == ids[2]));
+        }
+        {
+            auto e4 = w.create_entity(e3);
+            REQUIRE(&w.get_shared_component<mesh_s>(e4) == &w.get_shared_component<mesh_s>(e3));
 
-            REQUIRE(e.get_component<position_c>().x == 1 + 3*4);
-            REQUIRE(e.get_component<position_c>().y == 2 + 4*4);
+            const auto proto = ecs::prototype()
+                .component<position_c>(1, 2)
+                .shared_component<mesh_s>(3);
+            REQUIRE(proto.has_shared_component<mesh_s>());
+            REQUIRE_FALSE(proto.has_component<mesh_s>());
+            auto e5 = w.create_entity(proto);
+            REQUIRE(&w.get_shared_component<mesh_s>(e5) == &w.get_shared_component<mesh_s>(e1));
+            REQUIRE(w.shared_value_count<mesh_s>() == 2u);
+
+            REQUIRE(w.remove_all_components(e5) == 2u);
+            w.destroy_entity(e4);
+            REQUIRE(w.remove_shared_component<mesh_s>(e1));
+            REQUIRE_FALSE(w.remove_shared_component<mesh_s>(e1));
+            REQUIRE(w.shared_value_count<mesh_s>() == 1u);
+            REQUIRE(w.shared_component_count<mesh_s>() == 2u);
+        }
+        {
+            std::vector<ecs::entity> es;
+            for ( int i = 0; i < 64; ++i ) {
+                es.push_back(w.create_entity());
+                w.assign_shared_component<int>(es.back(), i % 16);
+            }
+            REQUIRE(w.shared_value_count<int>() == 16u);
+            std::vector<const int*> values;
+            for ( std::size_t i = 1; i < 16u; ++i ) {
+                values.push_back(&w.get_shared_component<int>(es[i]));
+            }
+            for ( std::size_t i = 0; i < es.size(); i += 16u ) {
+                w.destroy_entity(es[i]);
+            }
+            REQUIRE(w.shared_value_count<int>() == 15u);
+            {
+                auto e = w.create_entity();
+                for ( int i = 0; i < 100; ++i ) {
+                    w.assign_shared_component<int>(e, 1000 + i);
+                    w.assign_shared_component<int>(w.create_entity(), 2000 + i);
+                }
+                w.destroy_entity(e);
+            }
+            for ( std::size_t i = 1; i < 16u; ++i ) {
+                REQUIRE(&w.get_shared_component<int>(es[i]) == values[i - 1u]);
+                REQUIRE(*values[i - 1u] == static_cast<int>(i));
+            }
+            for ( std::size_t i = 1; i < es.size(); ++i ) {
+                if ( i % 16u ) {
+                    REQUIRE(w.get_shared_component<int>(es[i]) == static_cast<int>(i % 16u));
+                    REQUIRE(&w.assign_shared_component<int>(es[i], static_cast<int>(i % 16u))
+                        == &w.get_shared_component<int>(es[i % 16u]));
+                }
+            }
 
-            REQUIRE(e2.get_component<position_c>().x == 1);
-            REQUIRE(e2.get_component<position_c>().y == 2);
+            const auto compiled = ecs::prototype()
+                .shared_component<int>(100)
+                .compile(w);
+            std::vector<ecs::entity> batch;
+            w.instantiate(compiled, 20u, std::back_inserter(batch));
+            REQUIRE(w.shared_value_count<int>() == 116u);
+            REQUIRE(&w.get_shared_component<int>(batch.front()) == &w.get_shared_component<int>(batch.back()));
         }
     }
-    SUBCASE("options") {
+    SUBCASE("transient_components") {
+        struct damage_t {
+            int amount{0};
+        };
+
+        ecs::registry w;
+        auto e1 = w.create_entity();
+        auto e2 = w.create_entity();
+        auto e3 = w.create_entity();
+
+        w.assign_transient_component<damage_t>(e1, 10);
+        w.assign_transient_component<damage_t>(e2, 20);
+        w.assign_transient_component<damage_t>(e1, 30);
+        REQUIRE(w.transient_component_count<damage_t>() == 2u);
+        REQUIRE(w.get_transient_component<damage_t>(e1).amount == 30);
+        REQUIRE(w.exists_transient_component<damage_t>(e2));
+        REQUIRE_FALSE(w.exists_transient_component<damage_t>(e3));
+        REQUIRE_FALSE(w.find_transient_component<damage_t>(e3));
+        REQUIRE_THROWS_AS(w.get_transient_component<damage_t>(e3), std::logic_error);
+        REQUIRE(w.entity_component_count(e1) == 1u);
         {
-            ecs::registry w;
+            int sum = 0;
+            w.for_each_transient_component<damage_t>([&sum](ecs::entity, damage_t& d){
+                sum += d.amount;
+            });
+            REQUIRE(sum == 50);
+        }
 
-            auto e = w.create_entity();
+        REQUIRE(w.remove_transient_component<damage_t>(e1));
+        REQUIRE_FALSE(w.remove_transient_component<damage_t>(e1));
+        REQUIRE(w.get_transient_component<damage_t>(e2).amount == 20);
+
+        const std::size_t memory = w.memory_usage().components;
+        w.end_frame();
+        REQUIRE(w.transient_component_count<damage_t>() == 0u);
+        REQUIRE_FALSE(w.exists_transient_component<damage_t>(e2));
+        REQUIRE(w.memory_usage().components == memory);
+
+        w.assign_transient_component<damage_t>(e3, 5);
+        REQUIRE(w.transient_component_count<damage_t>() == 1u);
+        REQUIRE_FALSE(w.exists_transient_component<damage_t>(e2));
+        REQUIRE(w.get_transient_component<damage_t>(e3).amount == 5);
+
+        w.destroy_entity(e3);
+        REQUIRE(w.transient_component_count<damage_t>() == 0u);
+        auto e4 = w.create_entity();
+        REQUIRE_FALSE(w.exists_transient_component<damage_t>(e4));
+    }
+    SUBCASE("enabled_components") {
+        ecs::registry w;
+
+        std::vector<ecs::entity> es;
+        for ( int i = 0; i < 100; ++i ) {
+            auto e = w.create_entity();
+            e.assign_component<position_c>(i, i);
+            if ( i % 2 ) {
+                e.assign_component<movable_c>();
+            }
+            es.push_back(e);
+        }
+
+        for ( int i = 0; i < 100; i += 3 ) {
+            REQUIRE(w.disable_component<position_c>(es[i]));
+        }
+        REQUIRE(w.disable_component<position_c>(es[0]));
+        REQUIRE_FALSE(w.disable_component<velocity_c>(es[0]));
+        REQUIRE(w.exists_component<position_c>(es[0]));
+        REQUIRE_FALSE(w.enabled_component<position_c>(es[0]));
+        REQUIRE(w.enabled_component<position_c>(es[1]));
+        REQUIRE(w.component_count<position_c>() == 100u);
+
+        const auto enabled_sum = [&w](){
+            int sum = 0;
+            w.for_each_component<position_c>([&sum](ecs::entity, const position_c& p){
+                sum += p.x;
+            });
+            return sum;
+        };
+        const auto expected_sum = [&w, &es](){
+            int sum = 0;
+            for ( const auto& e : es ) {
+                if ( e.valid() && w.enabled_component<position_c>(e) ) {
+                    sum += e.get_component<position_c>().x;
+                }
+            }
+            return sum;
+        };
+        REQUIRE(enabled_sum() == expected_sum());
+
+        {
+            std::size_t count = 0u;
+            w.for_joined_components<position_c, movable_c>([&count](
+                ecs::entity e, const position_c& p, movable_c)
+            {
+                REQUIRE(p.x % 2 == 1);
+                REQUIRE(p.x % 3 != 0);
+                REQUIRE(e.exists_component<movable_c>());
+                ++count;
+            });
+            REQUIRE(count == 33u);
+        }
+        {
+            REQUIRE(w.disable_component<movable_c>(es[1]));
+            std::size_t count = 0u;
+            w.for_joined_components<movable_c, ecs::without<position_c>>([&count](
+                ecs::entity e, movable_c)
+            {
+                REQUIRE(e.get_component<position_c>().x % 3 == 0);
+                ++count;
+            });
+            REQUIRE(count == 17u);
+            REQUIRE(w.enable_component<movable_c>(es[1]));
+        }
+
+        for ( int i = 0; i < 100; i += 5 ) {
+            w.remove_component<position_c>(es[i]);
+        }
+        es[1].destroy();
+        REQUIRE(enabled_sum() == expected_sum());
+
+        w.sort_components_by_hierarchy<position_c>();
+        REQUIRE(enabled_sum() == expected_sum());
+        REQUIRE_FALSE(w.enabled_component<position_c>(es[3]));
+        REQUIRE(w.enable_component<position_c>(es[3]));
+        REQUIRE(w.enabled_component<position_c>(es[3]));
+        REQUIRE(enabled_sum() == expected_sum());
+
+        {
+            const auto position_family = ecs::detail::type_family<position_c>::id();
+            REQUIRE_FALSE(w.enabled_component(es[6], position_family));
+            REQUIRE(w.enable_component(es[6], position_family));
+            std::size_t count = 0u;
+            w.for_each_component(position_family, [&count](ecs::entity, void*){
+                ++count;
+            });
+            REQUIRE(count == static_cast<std::size_t>(std::count_if(es.begin(), es.end(), [&w](const ecs::entity& e){
+                return e.valid() && w.enabled_component<position_c>(e);
+            })));
+        }
+
+        w.remove_all_components<position_c>();
+        es[2].assign_component<position_c>(2, 2);
+        REQUIRE(w.enabled_component<position_c>(es[2]));
+        REQUIRE(enabled_sum() == 2);
+    }
+    SUBCASE("dormant_entities") {
+        ecs::registry w;
+        const auto position_family = ecs::detail::type_family<position_c>::id();
+
+        std::vector<ecs::entity> es;
+        for ( int i = 0; i < 100; ++i ) {
+            auto e = w.create_entity();
+            e.assign_component<position_c>(i, i);
+            if ( i % 2 ) {
+                e.assign_component<movable_c>();
+            }
+            es.push_back(e);
+        }
+
+        const auto active_sum = [&w](){
+            int sum = 0;
+            w.for_each_component<position_c>([&sum](ecs::entity, const position_c& p){
+                sum += p.x;
+            });
+            return sum;
+        };
+        const auto expected_sum = [&w, &es](){
+            int sum = 0;
+            for ( const auto& e : es ) {
+                if ( e.valid()
+                    && !w.dormant_entity(e)
+                    && w.enabled_component<position_c>(e) )
+                {
+                    sum += e.get_component<position_c>().x;
+                }
+            }
+            return sum;
+        };
+
+        for ( int i = 0; i < 100; i += 4 ) {
+            REQUIRE(w.sleep_entity(es[i]));
+        }
+        REQUIRE_FALSE(w.sleep_entity(es[0]));
+        REQUIRE(w.dormant_entity(es[0]));
+        REQUIRE_FALSE(w.dormant_entity(es[1]));
+        REQUIRE(w.dormant_entity_count() == 25u);
+        REQUIRE(w.exists_component<position_c>(es[0]));
+        REQUIRE(es[4].get_component<position_c>().x == 4);
+        REQUIRE_FALSE(w.enabled_component<position_c>(es[4]));
+        REQUIRE(w.component_count<position_c>() == 100u);
+        REQUIRE(active_sum() == expected_sum());
+
+        {
+            std::size_t count = 0u;
+            w.for_joined_components<movable_c, position_c>([&count](
+                ecs::entity, movable_c, const position_c& p)
+            {
+                REQUIRE(p.x % 2 == 1);
+                ++count;
+            });
+            REQUIRE(count == 50u);
+        }
+        {
+            std::size_t count = 0u;
+            w.for_joined_components<ecs::without<movable_c>>([&count](ecs::entity){
+                ++count;
+            });
+            REQUIRE(count == 25u);
+        }
+
+        es[8].assign_component<velocity_c>(1, 1);
+        es[9].assign_component<velocity_c>(2, 2);
+        REQUIRE(es[8].get_component<velocity_c>() == velocity_c(1, 1));
+        {
+            std::size_t count = 0u;
+            w.for_each_component<velocity_c>([&count](ecs::entity e, const velocity_c&){
+                REQUIRE(e.get_component<position_c>().x == 9);
+                ++count;
+            });
+            REQUIRE(count == 1u);
+        }
+
+        REQUIRE(w.disable_component<position_c>(es[12]));
+        REQUIRE(w.disable_component<position_c>(es[13]));
+        for ( int i = 0; i < 100; i += 10 ) {
+            w.remove_component<position_c>(es[i]);
+        }
+        es[16].destroy();
+        es[17].destroy();
+        REQUIRE(w.dormant_entity_count() == 24u);
+        REQUIRE(active_sum() == expected_sum());
+
+        w.sort_components_by_hierarchy<position_c>();
+        REQUIRE(active_sum() == expected_sum());
+
+        REQUIRE(w.wake_entity(es[8]));
+        REQUIRE_FALSE(w.wake_entity(es[8]));
+        REQUIRE(w.wake_entity(es[12]));
+        REQUIRE_FALSE(w.enabled_component<position_c>(es[12]));
+        REQUIRE(w.enable_component<position_c>(es[12]));
+        REQUIRE(active_sum() == expected_sum());
+        {
+            std::size_t count = 0u;
+            w.for_each_component<velocity_c>([&count](ecs::entity, const velocity_c&){
+                ++count;
+            });
+            REQUIRE(count == 2u);
+        }
+
+        {
+            std::size_t count = 0u;
+            w.for_each_component(position_family, [&count](ecs::entity, void*){
+                ++count;
+            });
+            REQUIRE(count == static_cast<std::size_t>(std::count_if(es.begin(), es.end(), [&w](const ecs::entity& e){
+                return e.valid() && w.enabled_component<position_c>(e);
+            })));
+        }
+
+        for ( auto& e : es ) {
+            if ( e.valid() ) {
+                w.wake_entity(e);
+                w.enable_component<position_c>(e);
+            }
+        }
+        REQUIRE(w.dormant_entity_count() == 0u);
+        REQUIRE(active_sum() == expected_sum());
+        REQUIRE(w.component_count<position_c>() == 88u);
+
+        {
+            const auto name_family = w.register_component(
+                ecs::runtime_component_info::of<std::string>());
+            const std::string a = "a";
+            const std::string b = "b";
+            w.assign_component(es[1], name_family, &a);
+            w.assign_component(es[3], name_family, &b);
+            REQUIRE(w.sleep_entity(es[1]));
+
+            std::string names;
+            w.for_each_component(name_family, [&names](ecs::entity, void* c){
+                names += *static_cast<const std::string*>(c);
+            });
+            REQUIRE(names == "b");
+            REQUIRE(*static_cast<const std::string*>(w.find_component(es[1], name_family)) == "a");
+
+            REQUIRE(w.remove_component(es[3], name_family));
+            REQUIRE(w.wake_entity(es[1]));
+            names.clear();
+            w.for_each_component(name_family, [&names](ecs::entity, void* c){
+                names += *static_cast<const std::string*>(c);
+            });
+            REQUIRE(names == "a");
+        }
+    }
+    SUBCASE("budgeted_iteration") {
+        ecs::registry w;
+
+        std::vector<ecs::entity> es;
+        for ( int i = 0; i < 10; ++i ) {
+            es.push_back(w.create_entity());
+            es.back().assign_component<position_c>(i, i);
+        }
+
+        ecs::iteration_cursor cursor;
+        std::vector<int> visited;
+        const auto visit = [&visited](ecs::entity, const position_c& p){
+            visited.push_back(p.x);
+        };
+
+        REQUIRE_FALSE(w.for_each_component_budgeted<position_c>(cursor, 3u, visit));
+        REQUIRE(visited.size() == 3u);
+        REQUIRE(cursor.in_cycle());
+        REQUIRE(cursor.remaining() == 7u);
+
+        // reorders the storage between slices
+        w.remove_component<position_c>(es[visited[0]]);
+        es[visited[1]].destroy();
+        es[9].destroy();
+        es.push_back(w.create_entity());
+        es.back().assign_component<position_c>(10, 10);
+        w.sleep_entity(es[8]);
+
+        REQUIRE_FALSE(w.for_each_component_budgeted<position_c>(cursor, 3u, visit));
+        REQUIRE(w.for_each_component_budgeted<position_c>(cursor, 3u, visit));
+        REQUIRE_FALSE(cursor.in_cycle());
+        REQUIRE(cursor.cycle_count() == 1u);
+        {
+            std::vector<int> sorted = visited;
+            std::sort(sorted.begin(), sorted.end());
+            REQUIRE(std::adjacent_find(sorted.begin(), sorted.end()) == sorted.end());
+            REQUIRE(sorted.size() == 8u);
+            REQUIRE(std::find(sorted.begin(), sorted.end(), 8) == sorted.end());
+            REQUIRE(std::find(sorted.begin(), sorted.end(), 9) == sorted.end());
+            REQUIRE(std::find(sorted.begin(), sorted.end(), 10) == sorted.end());
+        }
+
+        visited.clear();
+        REQUIRE_FALSE(w.for_each_component_budgeted<position_c>(cursor, std::chrono::nanoseconds(0), visit));
+        REQUIRE(visited.empty());
+        REQUIRE(std::as_const(w).for_each_component_budgeted<position_c>(
+            cursor,
+            std::chrono::seconds(60),
+            [&visited](ecs::const_entity, const position_c& p){
+                visited.push_back(p.x);
+            }));
+        REQUIRE(visited.size() == 7u);
+        REQUIRE(std::find(visited.begin(), visited.end(), 10) != visited.end());
+        REQUIRE(cursor.cycle_count() == 2u);
+
+        es[0].assign_component<velocity_c>(1, 1);
+        REQUIRE_FALSE(w.for_each_component_budgeted<position_c>(cursor, 2u, visit));
+        REQUIRE(cursor.in_cycle());
+        std::size_t velocities = 0u;
+        REQUIRE(w.for_each_component_budgeted<velocity_c>(cursor, 10u, [&velocities](ecs::entity e, const velocity_c&){
+            REQUIRE(e.exists_component<velocity_c>());
+            ++velocities;
+        }));
+        REQUIRE(velocities == 1u);
+        REQUIRE(cursor.cycle_count() == 3u);
+
+        struct unused_c {};
+        ecs::iteration_cursor empty_cursor;
+        REQUIRE(w.for_each_component_budgeted<unused_c>(empty_cursor, 1u, [](ecs::entity, unused_c&){
+            FAIL("");
+        }));
+    }
+    SUBCASE("scheduled_components") {
+        ecs::registry w;
+
+        std::vector<ecs::entity> es;
+        for ( int i = 0; i < 16; ++i ) {
+            es.push_back(w.create_entity());
+            es.back().assign_component<position_c>(i, i);
+            w.schedule_entity(es.back(), i < 8 ? 1u : 4u);
+        }
+        w.create_entity().assign_component<position_c>(100, 100);
+
+        REQUIRE(w.scheduled_period(es[0]) == 1u);
+        REQUIRE(w.scheduled_period(es[8]) == 4u);
+        REQUIRE_THROWS_AS(w.schedule_entity(es[0], 0u), std::logic_error);
+
+        std::vector<int> visits(16, 0);
+        for ( std::uint64_t frame = 0; frame < 8; ++frame ) {
+            std::size_t count = 0u;
+            w.for_scheduled_components<position_c>(frame, [&visits, &count](ecs::entity, const position_c& p){
+                ++visits[static_cast<std::size_t>(p.x)];
+                ++count;
+            });
+            REQUIRE(count == 10u);
+        }
+        for ( int i = 0; i < 16; ++i ) {
+            REQUIRE(visits[static_cast<std::size_t>(i)] == (i < 8 ? 8 : 2));
+        }
+
+        REQUIRE(w.unschedule_entity(es[0]));
+        REQUIRE_FALSE(w.unschedule_entity(es[0]));
+        REQUIRE(w.scheduled_period(es[0]) == 0u);
+        w.schedule_entity(es[1], 4u);
+        es[2].remove_component<position_c>();
+        w.sleep_entity(es[3]);
+        {
+            std::size_t count = 0u;
+            w.for_scheduled_components<position_c>(0u, [&count](ecs::entity e, const position_c&){
+                e.destroy();
+                ++count;
+            });
+            REQUIRE(count == 7u);
+            std::size_t unused_count = 0u;
+            w.for_scheduled_components<ecs::without<velocity_c>>(0u, [&unused_count](ecs::entity e){
+                REQUIRE(e.valid());
+                ++unused_count;
+            });
+            REQUIRE(unused_count == 1u);
+        }
+        {
+            std::size_t count = 0u;
+            for ( std::uint64_t frame = 0; frame < 4; ++frame ) {
+                std::as_const(w).for_scheduled_components<position_c>(frame, [&count](ecs::const_entity, const position_c&){
+                    ++count;
+                });
+            }
+            REQUIRE(count == 6u);
+        }
+        {
+            auto a = w.create_entity();
+            auto b = w.create_entity();
+            a.assign_component<position_c>(200, 0);
+            b.assign_component<position_c>(201, 0);
+            w.schedule_entity(a, 1u);
+            w.schedule_entity(b, 1u);
+            std::size_t pair_visits = 0u;
+            w.for_scheduled_components<position_c>(1u, [&w, &a, &b, &pair_visits](ecs::entity e, const position_c&){
+                if ( e == a || e == b ) {
+                    ++pair_visits;
+                    w.destroy_entity(e == a ? b : a);
+                    w.schedule_entity(e, 2u);
+                }
+            });
+            REQUIRE(pair_visits == 1u);
+            REQUIRE(a.valid() != b.valid());
+            REQUIRE(w.scheduled_period(a.valid() ? a : b) == 2u);
+        }
+    }
+    SUBCASE("deterministic_mode") {
+        const auto position_hash = [](const position_c& p){
+            return (std::uint64_t{static_cast<std::uint32_t>(p.x)} << 32u)
+                | static_cast<std::uint32_t>(p.y);
+        };
+        const auto state_hash = [&position_hash](const ecs::registry& w){
+            return w.entity_state_hash()
+                ^ ecs::detail::mix_hash(w.component_state_hash<position_c>(position_hash));
+        };
+        const auto iteration_order = [](ecs::registry& w){
+            std::vector<ecs::entity_id> ids;
+            w.for_each_component<position_c>([&ids](ecs::entity e, const position_c&){
+                ids.push_back(e.id());
+            });
+            return ids;
+        };
+
+        ecs::registry w1;
+        ecs::registry w2;
+        w1.set_deterministic(true);
+        w2.set_deterministic(true);
+        REQUIRE(w1.is_deterministic());
+
+        std::vector<ecs::entity> es1;
+        std::vector<ecs::entity> es2;
+        for ( int i = 0; i < 40; ++i ) {
+            es1.push_back(w1.create_entity());
+            es2.push_back(w2.create_entity());
+        }
+        for ( int i = 0; i < 40; ++i ) {
+            es1[static_cast<std::size_t>(i)].assign_component<position_c>(i, i);
+            es2[static_cast<std::size_t>(39 - i)].assign_component<position_c>(39 - i, 39 - i);
+        }
+        w1.disable_component<position_c>(es1[5]);
+        w2.disable_component<position_c>(es2[5]);
+        w1.sleep_entity(es1[7]);
+        w2.sleep_entity(es2[7]);
+        for ( std::size_t i = 0; i < 40; i += 3 ) {
+            es1[i].remove_component<position_c>();
+        }
+        for ( std::size_t i = 39; i < 40; i -= 3 ) {
+            if ( i % 3 == 0 ) {
+                es2[i].remove_component<position_c>();
+            }
+        }
+
+        // frame by frame validation harness
+        for ( int frame = 0; frame < 3; ++frame ) {
+            w1.for_each_component<position_c>([](ecs::entity, position_c& p){ ++p.x; });
+            w2.for_each_component<position_c>([](ecs::entity, position_c& p){ ++p.x; });
+            REQUIRE(state_hash(w1) == state_hash(w2));
+            w1.end_frame();
+            w2.end_frame();
+            const auto order = iteration_order(w1);
+            REQUIRE(order == iteration_order(w2));
+            REQUIRE(std::is_sorted(order.begin(), order.end()));
+        }
+        es2[1].get_component<position_c>().y += 1;
+        REQUIRE(state_hash(w1) != state_hash(w2));
+        es2[1].get_component<position_c>().y -= 1;
+        REQUIRE(state_hash(w1) == state_hash(w2));
+        REQUIRE(w1.wake_entity(es1[7]));
+        REQUIRE(state_hash(w1) != state_hash(w2));
+
+        w1.sort_components_by_id<position_c>();
+        {
+            const std::size_t chunk_size = 8u;
+            const std::size_t chunk_count = w1.component_chunk_count<position_c>(chunk_size);
+            REQUIRE(chunk_count == 4u);
+            std::vector<std::vector<ecs::entity_id>> chunks(chunk_count);
+            for ( std::size_t chunk = chunk_count; chunk > 0u; --chunk ) {
+                w1.for_each_component_chunk<position_c>(chunk - 1u, chunk_size, [&chunks, chunk](ecs::entity e, position_c&){
+                    chunks[chunk - 1u].push_back(e.id());
+                });
+            }
+            std::vector<ecs::entity_id> merged;
+            for ( const auto& ids : chunks ) {
+                REQUIRE(ids.size() <= chunk_size);
+                merged.insert(merged.end(), ids.begin(), ids.end());
+            }
+            REQUIRE(std::is_sorted(merged.begin(), merged.end()));
+            REQUIRE(merged == iteration_order(w1));
+        }
+        {
+            // the values must not depend on the platform or the standard library
+            ecs::registry w;
+            for ( int i = 0; i < 3; ++i ) {
+                w.create_entity().assign_component<position_c>(i, -i);
+            }
+            REQUIRE(w.entity_state_hash() == 0x6f0b0c90105e6c4fu);
+            REQUIRE(w.component_state_hash<position_c>(position_hash) == 0x1c2bfb993c877589u);
+        }
+        {
+            ecs::registry sleeping;
+            ecs::registry disabled;
+            auto e1 = sleeping.create_entity();
+            auto e2 = disabled.create_entity();
+            e1.assign_component<position_c>(1, 1);
+            e2.assign_component<position_c>(1, 1);
+            REQUIRE(sleeping.sleep_entity(e1));
+            REQUIRE(disabled.disable_component<position_c>(e2));
+            REQUIRE(sleeping.component_state_hash<position_c>(position_hash)
+                != disabled.component_state_hash<position_c>(position_hash));
+            REQUIRE(disabled.sleep_entity(e2));
+            REQUIRE(sleeping.component_state_hash<position_c>(position_hash)
+                != disabled.component_state_hash<position_c>(position_hash));
+            REQUIRE(disabled.enable_component<position_c>(e2));
+            REQUIRE(sleeping.component_state_hash<position_c>(position_hash)
+                == disabled.component_state_hash<position_c>(position_hash));
+        }
+    }
+    SUBCASE("seqlock_reads") {
+        ecs::registry w;
+        std::vector<ecs::entity> es;
+        for ( int i = 0; i < 5; ++i ) {
+            es.push_back(w.create_entity());
+            es.back().assign_component<position_c>(i, i);
+        }
+        REQUIRE_FALSE(w.seqlock_reads_enabled<position_c>());
+        REQUIRE_FALSE(w.read_component<position_c>(es[0]));
+
+        w.enable_seqlock_reads<position_c>();
+        REQUIRE(w.seqlock_reads_enabled<position_c>());
+        REQUIRE_FALSE(w.seqlock_reads_enabled<velocity_c>());
+        REQUIRE_FALSE(w.read_component<velocity_c>(es[0]));
+        for ( std::size_t i = 0; i < es.size(); ++i ) {
+            const int v = static_cast<int>(i);
+            REQUIRE(w.read_component<position_c>(es[i]) == position_c(v, v));
+        }
+
+        ecs::entity e5 = w.create_entity();
+        REQUIRE_FALSE(w.read_component<position_c>(e5));
+        e5.assign_component<position_c>(5, 5);
+        REQUIRE(w.read_component<position_c>(e5) == position_c(5, 5));
+        e5.assign_component<position_c>(6, 6);
+        REQUIRE(w.read_component<position_c>(e5) == position_c(6, 6));
+
+        w.for_each_component<position_c>([](ecs::entity, position_c& p){
+            p.y += 10;
+        });
+        REQUIRE(w.read_component<position_c>(es[2]) == position_c(2, 12));
+
+        for ( std::size_t chunk = 0u; chunk < w.component_chunk_count<position_c>(4u); ++chunk ) {
+            w.for_each_component_chunk<position_c>(chunk, 4u, [](ecs::entity, position_c& p){
+                p.y -= 10;
+            });
+        }
+        REQUIRE(w.read_component<position_c>(es[2]) == position_c(2, 2));
+        REQUIRE(w.read_component<position_c>(e5) == position_c(6, 6));
+
+        es[3].get_component<position_c>().x = 42;
+        REQUIRE(w.read_component<position_c>(es[3]) == position_c(3, 3));
+        w.publish_components<position_c>();
+        REQUIRE(w.read_component<position_c>(es[3]) == position_c(42, 3));
+        es[3].get_component<position_c>().x = 43;
+        w.end_frame();
+        REQUIRE(w.read_component<position_c>(es[3]) == position_c(43, 3));
+
+        REQUIRE(es[1].remove_component<position_c>());
+        REQUIRE_FALSE(w.read_component<position_c>(es[1]));
+        const ecs::entity_id reused = es[4].id();
+        es[4].destroy();
+        ecs::entity e6 = w.create_entity();
+        REQUIRE(ecs::detail::entity_id_index(e6.id()) == ecs::detail::entity_id_index(reused));
+        REQUIRE_FALSE(w.read_component<position_c>(e6));
+        e6.assign_component<position_c>(7, 7);
+        REQUIRE(w.read_component<position_c>(e6) == position_c(7, 7));
+        REQUIRE(w.memory_usage().components > 0u);
+    }
+    SUBCASE("seqlock_concurrent_reads") {
+        // spans several words, so a torn read breaks the invariant
+        struct wide_c {
+            std::int64_t a{0};
+            std::int64_t b{0};
+            std::int64_t c{0};
+        };
+
+        ecs::registry w;
+        ecs::entity e = w.create_entity();
+        e.assign_component<wide_c>(wide_c{1, ~std::int64_t{1}, 3});
+        w.enable_seqlock_reads<wide_c>();
+
+        constexpr std::int64_t writes = 20000;
+        std::atomic<bool> done{false};
+        std::size_t reads = 0u;
+        std::size_t misses = 0u;
+        bool torn = false;
+
+        std::thread reader([&w, e, &done, &reads, &misses, &torn](){
+            std::int64_t last = 0;
+            while ( !done.load(std::memory_order_acquire) ) {
+                if ( const auto v = w.read_component<wide_c>(e) ) {
+                    const bool valid = v->a >= 1 && v->a <= writes
+                        && v->b == ~v->a
+                        && v->c == v->a * 3
+                        && v->a >= last;
+                    torn = torn || !valid;
+                    last = v->a;
+                    ++reads;
+                } else {
+                    ++misses;
+                }
+            }
+        });
+
+        for ( std::int64_t i = 1; i <= writes; ++i ) {
+            if ( i % 64 == 0 ) {
+                e.remove_component<wide_c>();
+            }
+            e.assign_component<wide_c>(wide_c{i, ~i, i * 3});
+        }
+        done.store(true, std::memory_order_release);
+        reader.join();
+
+        REQUIRE_FALSE(torn);
+        REQUIRE(reads + misses > 0u);
+        REQUIRE(w.read_component<wide_c>(e)->a == writes);
+    }
+
+    SUBCASE("buffered_components") {
+        ecs::registry w;
+        std::vector<ecs::entity> es;
+        for ( int i = 0; i < 6; ++i ) {
+            es.push_back(w.create_entity());
+            w.assign_buffered_component<position_c>(es.back(), i, 0);
+        }
+        const ecs::entity plain = w.create_entity();
+        REQUIRE(w.buffered_component_count<position_c>() == 6u);
+        REQUIRE(w.exists_buffered_component<position_c>(es[0]));
+        REQUIRE_FALSE(w.exists_buffered_component<position_c>(plain));
+        REQUIRE_FALSE(w.exists_buffered_component<velocity_c>(es[0]));
+        REQUIRE_FALSE(w.find_buffered_component<position_c>(plain));
+        REQUIRE_FALSE(w.find_next_buffered_component<position_c>(plain));
+        REQUIRE_THROWS_AS(w.get_buffered_component<position_c>(plain), std::logic_error);
+        REQUIRE(w.entity_component_count(es[0]) == 1u);
+
+        for ( int frame = 1; frame <= 3; ++frame ) {
+            w.for_each_buffered_component<position_c>([](ecs::entity, const position_c& prev, position_c& next){
+                next.y = prev.y + prev.x;
+            });
+            for ( std::size_t i = 0; i < es.size(); ++i ) {
+                const int x = static_cast<int>(i);
+                REQUIRE(w.get_buffered_component<position_c>(es[i]) == position_c(x, x * (frame - 1)));
+                REQUIRE(w.get_next_buffered_component<position_c>(es[i]) == position_c(x, x * frame));
+            }
+            w.swap_buffers<position_c>();
+            REQUIRE(w.get_buffered_component<position_c>(es[3]) == position_c(3, 3 * frame));
+        }
+
+        {
+            const ecs::registry& cw = w;
+            int sum = 0;
+            cw.for_each_buffered_component<position_c>([&sum](ecs::const_entity, const position_c& prev){
+                sum += prev.y;
+            }, !ecs::exists<velocity_c>{});
+            REQUIRE(sum == 45);
+        }
+
+        w.assign_buffered_component<position_c>(es[1], 10, 20);
+        REQUIRE(w.get_buffered_component<position_c>(es[1]) == position_c(10, 20));
+        REQUIRE(w.get_next_buffered_component<position_c>(es[1]) == position_c(10, 20));
+
+        REQUIRE(w.remove_buffered_component<position_c>(es[0]));
+        REQUIRE_FALSE(w.remove_buffered_component<position_c>(es[0]));
+        es[5].destroy();
+        REQUIRE(w.buffered_component_count<position_c>() == 4u);
+        REQUIRE(w.get_buffered_component<position_c>(es[4]) == position_c(4, 12));
+        w.get_next_buffered_component<position_c>(es[2]).y = 100;
+        w.swap_buffers<position_c>();
+        REQUIRE(w.get_buffered_component<position_c>(es[2]) == position_c(2, 100));
+        REQUIRE(w.get_buffered_component<position_c>(es[4]) == position_c(4, 12));
+        REQUIRE(w.get_next_buffered_component<position_c>(es[4]) == position_c(4, 12));
+        w.swap_buffers<position_c>();
+        REQUIRE(w.get_buffered_component<position_c>(es[2]) == position_c(2, 100));
+
+        const ecs::entity clone = w.create_entity(es[2]);
+        REQUIRE(w.get_buffered_component<position_c>(clone) == position_c(2, 100));
+        REQUIRE(w.buffered_component_count<position_c>() == 5u);
+        REQUIRE(w.remove_all_components(clone) == 1u);
+
+        REQUIRE(w.remove_all_components(es[4]) == 1u);
+        REQUIRE(w.buffered_component_count<position_c>() == 3u);
+        REQUIRE(w.memory_usage().components > 0u);
+
+        {
+            ecs::registry w2;
+            const ecs::entity e1 = w2.create_entity();
+            const ecs::entity e2 = w2.create_entity();
+            w2.assign_buffered_component<move_throwing_c>(e1, 1);
+            for ( int fail_at : {0, 1} ) {
+                move_throwing_c::moves_left = fail_at;
+                REQUIRE_THROWS_AS(
+                    w2.assign_buffered_component<move_throwing_c>(e2, 2),
+                    std::logic_error);
+                REQUIRE_THROWS_AS(w2.create_entity(e1), std::logic_error);
+                move_throwing_c::moves_left = -1;
+                REQUIRE(w2.buffered_component_count<move_throwing_c>() == 1u);
+                REQUIRE_FALSE(w2.exists_buffered_component<move_throwing_c>(e2));
+                int visited = 0;
+                w2.for_each_buffered_component<move_throwing_c>(
+                    [&visited](ecs::entity, const move_throwing_c& prev, move_throwing_c& next){
+                        visited += prev.value + next.value;
+                    });
+                REQUIRE(visited == 2);
+            }
+            w2.assign_buffered_component<move_throwing_c>(e2, 2);
+            REQUIRE(w2.get_buffered_component<move_throwing_c>(e2).value == 2);
+            REQUIRE(w2.remove_buffered_component<move_throwing_c>(e1));
+            REQUIRE(w2.get_next_buffered_component<move_throwing_c>(e2).value == 2);
+        }
+    }
+
+    SUBCASE("relations") {
+        struct targets_r {
+            int priority{0};
+            targets_r(int p = 0) : priority(p) {}
+        };
+        struct owned_by_r {};
+
+        ecs::registry w;
+
+        auto e1 = w.create_entity();
+        auto e2 = w.create_entity();
+        auto e3 = w.create_entity();
+
+        REQUIRE(w.assign_relation<targets_r>(e1, e2, 1).priority == 1);
+        REQUIRE(w.assign_relation<targets_r>(e1, e3, 2).priority == 2);
+        REQUIRE(w.assign_relation<targets_r>(e1, e2, 3).priority == 3);
+        w.assign_relation<targets_r>(e3, e2);
+        w.assign_relation<owned_by_r>(e2, e1);
+
+        REQUIRE(w.relation_count<targets_r>() == 3u);
+        REQUIRE(w.relation_count<targets_r>(e1) == 2u);
+        REQUIRE(w.related_count<targets_r>(e2) == 2u);
+        REQUIRE(w.related_count<targets_r>(e1) == 0u);
+
+        REQUIRE(w.exists_relation<targets_r>(e1));
+        REQUIRE_FALSE(w.exists_relation<targets_r>(e2));
+        REQUIRE(w.exists_relation<targets_r>(e3, e2));
+        REQUIRE_FALSE(w.exists_relation<targets_r>(e2, e3));
+        REQUIRE(w.get_relation<targets_r>(e1, e3).priority == 2);
+        REQUIRE(std::as_const(w).find_relation<targets_r>(e1, e2)->priority == 3);
+        REQUIRE_FALSE(w.find_relation<owned_by_r>(e1, e2));
+        REQUIRE_THROWS_AS(w.get_relation<owned_by_r>(e1, e2), std::logic_error);
+
+        {
+            ecs::entity_id acc = 0;
+            w.for_each_related<targets_r>(e2, [&acc](ecs::entity source, targets_r& r){
+                acc += source.id();
+                ++r.priority;
+            });
+            REQUIRE(acc == e1.id() + e3.id());
+            REQUIRE(w.get_relation<targets_r>(e1, e2).priority == 4);
+
+            acc = 0;
+            std::as_const(w).for_each_relation<targets_r>(e1, [&acc](ecs::const_entity target, const targets_r&){
+                acc += target.id();
+            });
+            REQUIRE(acc == e2.id() + e3.id());
+        }
+        {
+            ecs::entity_id acc = 0;
+            w.for_each_entity([&acc](ecs::entity e){
+                acc += e.id();
+            }, ecs::related<targets_r>(e2.id()));
+            REQUIRE(acc == e1.id() + e3.id());
+
+            acc = 0;
+            w.for_each_entity([&acc](ecs::entity e){
+                acc += e.id();
+            }, !ecs::related<targets_r>());
+            REQUIRE(acc == e2.id());
+        }
+        {
+            REQUIRE(w.remove_relation<targets_r>(e3, e2));
+            REQUIRE_FALSE(w.remove_relation<targets_r>(e3, e2));
+            REQUIRE(w.related_count<targets_r>(e2) == 1u);
+
+            w.destroy_entity(e2);
+            REQUIRE(w.relation_count<targets_r>() == 1u);
+            REQUIRE(w.relation_count<targets_r>(e1) == 1u);
+            REQUIRE(w.relation_count<owned_by_r>() == 0u);
+
+            REQUIRE(w.remove_all_relations(e1) == 1u);
+            REQUIRE(w.relation_count<targets_r>() == 0u);
+        }
+        {
+            auto hub = w.create_entity();
+            std::vector<ecs::entity> es;
+            for ( int i = 0; i < 12; ++i ) {
+                es.push_back(w.create_entity());
+                w.assign_relation<targets_r>(es.back(), hub, i);
+                w.assign_relation<targets_r>(hub, es.back(), -i);
+            }
+            w.assign_relation<targets_r>(hub, hub, 100);
+            REQUIRE(w.relation_count<targets_r>() == 25u);
+
+            for ( std::size_t i = 0; i < es.size(); i += 3u ) {
+                w.destroy_entity(es[i]);
+            }
+            REQUIRE(w.remove_relation<targets_r>(es[4], hub));
+            REQUIRE(w.relation_count<targets_r>() == 16u);
+            REQUIRE(w.related_count<targets_r>(hub) == 8u);
+            REQUIRE(w.relation_count<targets_r>(hub) == 9u);
+
+            int sum = 0;
+            std::vector<std::pair<ecs::entity, const targets_r*>> related;
+            w.for_each_related<targets_r>(hub, [&sum, &related](ecs::entity source, targets_r& r){
+                related.emplace_back(source, &r);
+                sum += r.priority;
+            });
+            for ( const auto& p : related ) {
+                REQUIRE(&w.get_relation<targets_r>(p.first, hub) == p.second);
+            }
+            REQUIRE(sum == 1 + 2 + 5 + 7 + 8 + 10 + 11 + 100);
+            for ( std::size_t i = 0; i < es.size(); ++i ) {
+                if ( i % 3u ) {
+                    REQUIRE(w.get_relation<targets_r>(hub, es[i]).priority == -static_cast<int>(i));
+                }
+            }
+
+            w.destroy_entity(hub);
+            REQUIRE(w.relation_count<targets_r>() == 0u);
+        }
+    }
+    SUBCASE("context") {
+        struct game_clock {
+            int frame{0};
+        };
+
+        struct update_evt {};
+
+        class clock_system : public ecs::system<update_evt> {
+        public:
+            void process(ecs::registry& owner, const update_evt&) override {
+                ++owner.ctx<game_clock>().frame;
+            }
+        };
+
+        ecs::registry w;
+        REQUIRE_FALSE(w.has_ctx<game_clock>());
+        REQUIRE_FALSE(w.find_ctx<game_clock>());
+        REQUIRE_THROWS_AS(w.ctx<game_clock>(), std::logic_error);
+
+        game_clock& clock = w.assign_ctx<game_clock>(game_clock{2});
+        REQUIRE(w.has_ctx<game_clock>());
+        REQUIRE(&w.ctx<game_clock>() == &clock);
+        REQUIRE(&w.ensure_ctx<game_clock>() == &clock);
+        REQUIRE(&w.assign_ctx<game_clock>(game_clock{3}) == &clock);
+        REQUIRE(std::as_const(w).ctx<game_clock>().frame == 3);
+        REQUIRE_FALSE(w.has_ctx<position_c>());
+
+        w.assign_feature<update_evt>().add_system<clock_system>();
+        w.process_event(update_evt{});
+        REQUIRE(clock.frame == 4);
+
+        ecs::registry w2 = std::move(w);
+        REQUIRE(&w2.ctx<game_clock>() == &clock);
+
+        REQUIRE(w2.remove_ctx<game_clock>());
+        REQUIRE_FALSE(w2.remove_ctx<game_clock>());
+        REQUIRE_FALSE(w2.has_ctx<game_clock>());
+        REQUIRE(w2.ensure_ctx<game_clock>().frame == 0);
+    }
+    SUBCASE("aspects") {
+        {
+            using empty_aspect = ecs::aspect<>;
+
+            ecs::registry w;
+
+            ecs::entity e1 = w.create_entity();
+            REQUIRE(empty_aspect::match_entity(e1));
+
+            ecs::entity e2 = w.create_entity();
+            e2.assign_component<movable_c>();
+            e2.assign_component<position_c>(1,2);
+            REQUIRE(empty_aspect::match_entity(e2));
+
+            ecs::entity e3 = w.create_entity();
+            e3.assign_component<movable_c>();
+            e3.assign_component<position_c>(1,2);
+            e3.assign_component<velocity_c>(3,4);
+            REQUIRE(empty_aspect::match_entity(e3));
+
+            {
+                ecs::entity_id acc{};
+                empty_aspect::for_each_entity(w, [&acc](ecs::entity e){
+                    acc += e.id();
+                }, ecs::exists<movable_c>{});
+                REQUIRE(acc == e2.id() + e3.id());
+            }
+
+            {
+                ecs::entity_id acc{};
+                empty_aspect::for_joined_components(w, [&acc](ecs::entity e){
+                    acc += e.id();
+                }, ecs::exists<movable_c>{});
+                REQUIRE(acc == e2.id() + e3.id());
+            }
+
+            {
+                ecs::entity_id acc{};
+                w.for_each_entity([&acc](ecs::entity e){
+                    acc += e.id();
+                }, empty_aspect::to_option());
+                REQUIRE(acc == e1.id() + e2.id() + e3.id());
+            }
+        }
+        {
+            using movable = ecs::aspect<
+                position_c,
+                velocity_c>;
+
+            ecs::registry w;
+
+            ecs::entity e = w.create_entity();
+            REQUIRE_FALSE(movable::match_entity(e));
+
+            e.assign_component<position_c>(1,2);
+            REQUIRE_FALSE(movable::match_entity(e));
+
+            e.assign_component<velocity_c>(3,4);
+            REQUIRE(movable::match_entity(e));
+
+            ecs::entity e2 = w.create_entity();
+            e2.assign_component<position_c>(1,2);
+
+            movable::for_joined_components(w,
+            [](ecs::entity_id, position_c& p, const velocity_c& v){
+                p.x += v.x;
+                p.y += v.y;
+            });
+
+            movable::for_joined_components(std::as_const(w),
+            [](ecs::entity_id, const position_c& p, const velocity_c& v){
+                const_cast<position_c&>(p).x += v.x;
+                const_cast<position_c&>(p).y += v.y;
+            });
+
+            w.for_each_entity([](ecs::entity e){
+                auto& p = e.get_component<position_c>();
+                const auto& v = e.get_component<velocity_c>();
+                p.x += v.x;
+                p.y += v.y;
+            }, movable::to_option());
+
+            std::as_const(w).for_each_entity([](const ecs::const_entity& e){
+                const auto& p = e.get_component<position_c>();
+                const auto& v = e.get_component<velocity_c>();
+                const_cast<position_c&>(p).x += v.x;
+                const_cast<position_c&>(p).y += v.y;
+            }, movable::to_option());
+
+            REQUIRE(e.get_component<position_c>().x == 1 + 3*4);
+            REQUIRE(e.get_component<position_c>().y == 2 + 4*4);
+
+            REQUIRE(e2.get_component<position_c>().x == 1);
+            REQUIRE(e2.get_component<position_c>().y == 2);
+        }
+    }
+    SUBCASE("options") {
+        {
+            ecs::registry w;
+
+            auto e = w.create_entity();
 
             REQUIRE((!ecs::exists<position_c>{})(e));
             REQUIRE((!ecs::exists<velocity_c>{})(e));
@@ -1728,6 +3295,259 @@ TEST_CASE("registry") {
                 2 * sizeof(ecs::entity_id));
         }
     }
+    SUBCASE("memory_resources") {
+        {
+            counting_resource res;
+            {
+                ecs::registry w(&res);
+                REQUIRE(w.resource() == &res);
+
+                auto e1 = w.create_entity();
+                auto e2 = w.create_entity();
+                e1.assign_component<position_c>(1, 2);
+                e2.assign_component<movable_c>();
+                w.assign_shared_component<int>(e1, 5);
+                w.assign_shared_component<int>(e2, 5);
+                w.set_parent(e2, e1);
+                REQUIRE(res.allocations > 0u);
+                REQUIRE(res.allocated_bytes >= w.memory_usage().components);
+
+                ecs::registry w2 = std::move(w);
+                REQUIRE(w2.resource() == &res);
+                REQUIRE(w2.get_parent(e2.id()).id() == e1.id());
+                REQUIRE(w2.get_component<position_c>(e1.id()) == position_c(1,2));
+            }
+            REQUIRE(res.allocated_bytes == 0u);
+        }
+        {
+            counting_resource res;
+            {
+                auto parent = std::make_shared<ecs::prototype>(
+                    ecs::prototype(&res).component<position_c>(1, 2));
+                const auto proto = ecs::prototype(&res)
+                    .inherit(parent)
+                    .component<velocity_c>(3, 4);
+                REQUIRE(proto.resource() == &res);
+                REQUIRE(res.allocations > 0u);
+
+                ecs::registry w;
+                const auto e1 = w.create_entity(proto);
+                REQUIRE(e1.get_component<position_c>() == position_c(1,2));
+                REQUIRE(e1.get_component<velocity_c>() == velocity_c(3,4));
+
+                const ecs::prototype copy = proto;
+                REQUIRE(copy.resource() == &res);
+            }
+            REQUIRE(res.allocated_bytes == 0u);
+        }
+        {
+            std::byte buffer[64 * 1024];
+            std::pmr::monotonic_buffer_resource res(buffer, sizeof(buffer));
+            ecs::registry w(&res);
+            std::vector<ecs::entity> es;
+            w.instantiate(ecs::prototype().component<position_c>(1, 2), 100u, std::back_inserter(es));
+            REQUIRE(w.component_count<position_c>() == 100u);
+        }
+    }
+    SUBCASE("bounded_mode") {
+        counting_resource res;
+        ecs::registry w(&res);
+        w.reserve_entities(3u);
+        w.reserve_components<position_c>(2u);
+        w.reserve_components<movable_c>(3u);
+        const std::size_t allocations = res.allocations;
+
+        ecs::entity e1(w), e2(w), e3(w), e4(w);
+        REQUIRE(w.try_create_entity(e1) == ecs::status::ok);
+        REQUIRE(w.try_create_entity(e2) == ecs::status::ok);
+        REQUIRE(w.try_create_entity(e3) == ecs::status::ok);
+        REQUIRE(w.try_create_entity(e4) == ecs::status::entity_capacity_exhausted);
+        REQUIRE(w.entity_count() == 3u);
+
+        REQUIRE(w.try_assign_component<position_c>(e1, 1, 2) == ecs::status::ok);
+        REQUIRE(w.try_assign_component<position_c>(e2, 3, 4) == ecs::status::ok);
+        REQUIRE(w.try_assign_component<position_c>(e3, 5, 6) == ecs::status::component_capacity_exhausted);
+        REQUIRE(w.try_assign_component<position_c>(e1, 7, 8) == ecs::status::ok);
+        REQUIRE(w.try_assign_component<velocity_c>(e1) == ecs::status::component_capacity_exhausted);
+        REQUIRE(w.try_assign_component<movable_c>(e3) == ecs::status::ok);
+        REQUIRE(e1.get_component<position_c>() == position_c(7,8));
+        REQUIRE_FALSE(e3.exists_component<position_c>());
+        REQUIRE(e3.exists_component<movable_c>());
+
+        e2.destroy();
+        REQUIRE(w.try_create_entity(e4) == ecs::status::ok);
+        REQUIRE(w.try_assign_component<position_c>(e4, 5, 6) == ecs::status::ok);
+        REQUIRE(w.component_count<position_c>() == 2u);
+        REQUIRE(res.allocations == allocations);
+
+        REQUIRE_THROWS_AS(w.reserve_entities(std::size_t(1u) << 30u), std::logic_error);
+    }
+    SUBCASE("runtime_components") {
+        {
+            struct script_data_t {
+                std::vector<int> values;
+            };
+
+            ecs::registry w;
+            const auto script_data = w.register_component(
+                ecs::runtime_component_info::of<script_data_t>());
+            REQUIRE(script_data >= ecs::static_family_id_limit);
+            REQUIRE(script_data != ecs::detail::type_family<script_data_t>::id());
+
+            const auto pod_data = w.register_component(
+                ecs::runtime_component_info{sizeof(int), alignof(int)});
+            REQUIRE(script_data != pod_data);
+
+            std::vector<ecs::entity> es;
+            for ( int i = 0; i < 10; ++i ) {
+                auto e = w.create_entity();
+                script_data_t d{{i, i * 2}};
+                void* p = w.assign_component(e, script_data, &d);
+                REQUIRE(static_cast<script_data_t*>(p)->values == d.values);
+                if ( i % 2 ) {
+                    w.assign_component(e, pod_data, &i);
+                }
+                es.push_back(e);
+            }
+
+            REQUIRE(w.component_count(script_data) == 10u);
+            REQUIRE(w.component_count(pod_data) == 5u);
+            REQUIRE(w.entity_component_count(es[1]) == 2u);
+            REQUIRE(w.exists_component(es[1], pod_data));
+            REQUIRE_FALSE(w.exists_component(es[2], pod_data));
+            REQUIRE(*static_cast<const int*>(std::as_const(w).find_component(es[3], pod_data)) == 3);
+
+            REQUIRE(w.remove_component(es[0], script_data));
+            REQUIRE_FALSE(w.remove_component(es[0], script_data));
+            REQUIRE_FALSE(w.find_component(es[0], script_data));
+            REQUIRE(static_cast<script_data_t*>(w.find_component(es[9], script_data))->values[1] == 18);
+
+            {
+                script_data_t d{{42}};
+                w.assign_component(es[9], script_data, &d);
+                REQUIRE(static_cast<script_data_t*>(w.find_component(es[9], script_data))->values.size() == 1u);
+            }
+
+            {
+                int acc = 0;
+                w.for_each_component(script_data, [&acc](ecs::entity, void* p){
+                    acc += static_cast<script_data_t*>(p)->values[0];
+                }, !ecs::exists<position_c>{});
+                REQUIRE(acc == 1 + 2 + 3 + 4 + 5 + 6 + 7 + 8 + 42);
+            }
+
+            {
+                int acc = 0;
+                std::as_const(w).for_each_component(pod_data, [&acc](ecs::const_entity, const void* p){
+                    acc += *static_cast<const int*>(p);
+                });
+                REQUIRE(acc == 1 + 3 + 5 + 7 + 9);
+            }
+
+            auto e = w.create_entity(es[5]);
+            REQUIRE(w.exists_component(e, script_data));
+            REQUIRE(w.exists_component(e, pod_data));
+
+            es[5].destroy();
+            REQUIRE(w.component_count(script_data) == 9u);
+            REQUIRE(w.memory_usage().components > 0u);
+
+            REQUIRE_THROWS_AS(w.assign_component(e, ecs::family_id(1000u), nullptr), std::logic_error);
+            REQUIRE_FALSE(w.find_component(e, ecs::family_id(1000u)));
+        }
+        {
+            ecs::registry w;
+            auto e = w.create_entity();
+            const auto family = ecs::detail::type_family<position_c>::id();
+
+            const position_c p{1, 2};
+            REQUIRE_THROWS_AS(w.assign_component(e, family, &p), std::logic_error);
+
+            w.create_entity().assign_component<position_c>();
+            w.assign_component(e, family, &p);
+            REQUIRE(e.get_component<position_c>() == position_c(1, 2));
+            REQUIRE(static_cast<position_c*>(w.find_component(e, family))->y == 2);
+            REQUIRE(w.component_count(family) == 2u);
+        }
+    }
+    SUBCASE("runtime_queries") {
+        ecs::registry w;
+        const auto health = w.register_component(
+            ecs::runtime_component_info{sizeof(int), alignof(int)});
+
+        const auto position = ecs::detail::type_family<position_c>::id();
+        const auto velocity = ecs::detail::type_family<velocity_c>::id();
+        const auto disabled = ecs::detail::type_family<disabled_c>::id();
+
+        auto e1 = w.create_entity();
+        e1.assign_component<position_c>(1, 2);
+        e1.assign_component<velocity_c>(3, 4);
+
+        auto e2 = w.create_entity();
+        e2.assign_component<position_c>(5, 6);
+        e2.assign_component<velocity_c>(7, 8);
+        e2.assign_component<disabled_c>();
+
+        auto e3 = w.create_entity();
+        e3.assign_component<position_c>(9, 10);
+        const int hp = 42;
+        w.assign_component(e3, health, &hp);
+        w.assign_component(e1, health, &hp);
+
+        {
+            const auto query = ecs::runtime_query()
+                .required(position)
+                .required(velocity)
+                .excluded(disabled)
+                .optional(health);
+            REQUIRE(query.component_count() == 3u);
+
+            std::vector<ecs::entity_id> ids;
+            w.for_queried_components(query, [&ids](ecs::entity e, void* const* cs){
+                auto p = static_cast<position_c*>(cs[0]);
+                auto v = static_cast<const velocity_c*>(cs[1]);
+                auto h = static_cast<const int*>(cs[2]);
+                p->x += v->x + (h ? *h : 0);
+                ids.push_back(e.id());
+            });
+            REQUIRE(ids == std::vector<ecs::entity_id>{e1.id()});
+            REQUIRE(e1.get_component<position_c>() == position_c(46, 2));
+            REQUIRE(e2.get_component<position_c>() == position_c(5, 6));
+        }
+        {
+            const auto query = ecs::runtime_query()
+                .required(position)
+                .required(health);
+
+            int acc = 0;
+            std::as_const(w).for_queried_components(query, [&acc](ecs::const_entity, const void* const* cs){
+                acc += static_cast<const position_c*>(cs[0])->x;
+                acc += *static_cast<const int*>(cs[1]);
+            }, !ecs::exists<velocity_c>{});
+            REQUIRE(acc == 9 + 42);
+        }
+        {
+            std::size_t count = 0u;
+            w.for_queried_components(ecs::runtime_query().excluded(velocity).optional(health),
+            [&count](ecs::entity, void* const* cs){
+                REQUIRE(cs[0]);
+                ++count;
+            });
+            REQUIRE(count == 1u);
+        }
+        {
+            std::size_t count = 0u;
+            w.for_queried_components(ecs::runtime_query().required(position).excluded(position),
+            [&count](ecs::entity, void* const*){
+                ++count;
+            });
+            w.for_queried_components(ecs::runtime_query().required(ecs::family_id(1000u)),
+            [&count](ecs::entity, void* const*){
+                ++count;
+            });
+            REQUIRE_FALSE(count);
+        }
+    }
     SUBCASE("empty_component") {
         ecs::registry w;
         auto e1 = w.create_entity();
@@ -1742,3 +3562,154 @@ TEST_CASE("registry") {
         });
     }
 }
+
+TEST_CASE("static_registry") {
+    using world_t = ecs::static_registry<position_c, velocity_c, movable_c, disabled_c>;
+
+    static_assert(world_t::has_component_type<position_c>);
+    static_assert(!world_t::has_component_type<int>);
+    static_assert(!std::is_polymorphic_v<ecs::detail::static_component_storage<position_c>>);
+    static_assert(!std::is_polymorphic_v<ecs::detail::static_component_storage<movable_c>>);
+
+    SUBCASE("entities") {
+        world_t w;
+        REQUIRE_FALSE(w.entity_count());
+
+        auto e1 = w.create_entity();
+        auto e2 = w.create_entity();
+        REQUIRE(e1 != e2);
+        REQUIRE(w.entity_count() == 2u);
+        REQUIRE(e1.valid());
+        REQUIRE(w.valid_entity(e2));
+
+        e1.destroy();
+        REQUIRE_FALSE(e1.valid());
+        REQUIRE(w.entity_count() == 1u);
+
+        auto e3 = w.create_entity();
+        REQUIRE(ecs::detail::entity_id_index(e1.id()) == ecs::detail::entity_id_index(e3.id()));
+        REQUIRE(ecs::detail::entity_id_version(e1.id()) + 1 == ecs::detail::entity_id_version(e3.id()));
+    }
+    SUBCASE("components") {
+        world_t w;
+
+        auto e1 = w.create_entity();
+        REQUIRE(e1.assign_component<position_c>(1, 2) == position_c(1, 2));
+        REQUIRE(e1.ensure_component<position_c>(3, 4) == position_c(1, 2));
+        REQUIRE(e1.exists_component<position_c>());
+        REQUIRE_FALSE(e1.exists_component<velocity_c>());
+        REQUIRE(e1.find_component<position_c>());
+        REQUIRE_FALSE(e1.find_component<velocity_c>());
+        REQUIRE_THROWS_AS(e1.get_component<velocity_c>(), std::logic_error);
+        REQUIRE(e1.component_count() == 1u);
+
+        e1.assign_component<velocity_c>(5, 6);
+        e1.assign_component<movable_c>();
+        REQUIRE(e1.component_count() == 3u);
+        REQUIRE(w.get_components<position_c, velocity_c>(e1)
+            == std::make_tuple(position_c(1, 2), velocity_c(5, 6)));
+        REQUIRE(std::get<1>(std::as_const(w).find_components<position_c, disabled_c>(e1)) == nullptr);
+
+        auto e2 = w.create_entity(e1);
+        REQUIRE(e2.component_count() == 3u);
+        REQUIRE(e2.get_component<velocity_c>() == velocity_c(5, 6));
+        REQUIRE(w.component_count<position_c>() == 2u);
+
+        REQUIRE(e1.remove_component<movable_c>());
+        REQUIRE_FALSE(e1.remove_component<movable_c>());
+        REQUIRE(e1.remove_all_components() == 2u);
+        REQUIRE_FALSE(e1.component_count());
+
+        REQUIRE(w.remove_all_components<position_c>() == 1u);
+        REQUIRE_FALSE(w.component_count<position_c>());
+
+        e2.destroy();
+        REQUIRE_FALSE(w.component_count<velocity_c>());
+        REQUIRE(w.memory_usage().components > 0u);
+        REQUIRE(w.component_memory_usage<velocity_c>() > 0u);
+    }
+    SUBCASE("for_joined_components") {
+        world_t w;
+
+        auto e1 = w.create_entity();
+        e1.assign_component<position_c>(1, 2);
+        e1.assign_component<velocity_c>(3, 4);
+
+        auto e2 = w.create_entity();
+        e2.assign_component<position_c>(5, 6);
+        e2.assign_component<velocity_c>(7, 8);
+        e2.assign_component<disabled_c>();
+
+        auto e3 = w.create_entity();
+        e3.assign_component<position_c>(100, 500);
+
+        {
+            ecs::entity_id acc1 = 0;
+            int acc2 = 0;
+            w.for_joined_components<position_c, velocity_c>([&acc1, &acc2](
+                ecs::entity_id id, const position_c& p, const velocity_c& v)
+            {
+                acc1 += id;
+                acc2 += p.x + v.x;
+            });
+            REQUIRE(acc1 == e1.id() + e2.id());
+            REQUIRE(acc2 == 16);
+        }
+        {
+            w.for_joined_components<position_c, velocity_c>([](
+                world_t::entity, position_c& p, const velocity_c& v)
+            {
+                p.x += v.x;
+                p.y += v.y;
+            }, !ecs::exists<disabled_c>{});
+            REQUIRE(e1.get_component<position_c>() == position_c(4, 6));
+            REQUIRE(e2.get_component<position_c>() == position_c(5, 6));
+        }
+        {
+            ecs::entity_id acc = 0;
+            std::as_const(w).for_each_component<position_c>([&acc](
+                world_t::const_entity e, const position_c&)
+            {
+                acc += e.id();
+            }, ecs::exists_any<velocity_c, disabled_c>{});
+            REQUIRE(acc == e1.id() + e2.id());
+        }
+        {
+            using movable = ecs::aspect<position_c, velocity_c>;
+            REQUIRE(movable::match_entity(e1));
+            REQUIRE_FALSE(movable::match_entity(e3));
+
+            ecs::entity_id acc = 0;
+            movable::for_each_entity(std::as_const(w), [&acc](world_t::const_entity e){
+                acc += e.id();
+            }, ecs::exists<disabled_c>{});
+            REQUIRE(acc == e2.id());
+        }
+        {
+            ecs::entity_id acc = 0;
+            w.for_joined_components<>([&acc](world_t::entity e){
+                acc += e.id();
+            });
+            REQUIRE(acc == e1.id() + e2.id() + e3.id());
+        }
+        {
+            ecs::entity_id acc = 0;
+            w.for_joined_components<position_c, ecs::maybe<velocity_c>, ecs::without<disabled_c>>([&acc, &e1](
+                world_t::entity e, position_c&, velocity_c* v)
+            {
+                acc += e.id();
+                REQUIRE((v != nullptr) == (e == e1));
+            });
+            REQUIRE(acc == e1.id() + e3.id());
+        }
+        {
+            ecs::entity_id acc = 0;
+            std::as_const(w).for_joined_components<ecs::without<velocity_c>>([&acc](
+                world_t::const_entity e)
+            {
+                acc += e.id();
+            });
+            REQUIRE(acc == e3.id());
+        }
+    }
+}
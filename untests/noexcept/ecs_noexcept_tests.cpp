@@ -0,0 +1,95 @@
+/*******************************************************************************
+ * This file is part of the "https://github.com/blackmatov/ecs.hpp"
+ * For conditions of distribution and use, see copyright notice in LICENSE.md
+ * Copyright (C) 2018-2021, by Matvey Cherevko (blackmatov@gmail.com)
+ ******************************************************************************/
+
+#include <ecs.hpp/ecs.hpp>
+
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+#include <iterator>
+
+#if !defined(ECS_HPP_NO_EXCEPTIONS)
+#  error "ecs.hpp.noexcept must be built with exceptions disabled"
+#endif
+
+namespace ecs = ecs_hpp;
+
+namespace
+{
+    struct position_c {
+        int x{0};
+        int y{0};
+
+        position_c() = default;
+        position_c(int nx, int ny) : x(nx), y(ny) {}
+    };
+
+    struct movable_c {};
+
+    struct damage_t {
+        int amount{0};
+    };
+
+    void require(bool condition, const char* what) {
+        if ( !condition ) {
+            std::fprintf(stderr, "ecs.hpp.noexcept: %s\n", what);
+            std::abort();
+        }
+    }
+}
+
+int main() {
+    ecs::registry w;
+
+    auto e = w.create_entity();
+    e.assign_component<position_c>(1, 2);
+    e.assign_component<movable_c>();
+    require(w.get_component<position_c>(e).x == 1, "get_component");
+    require(w.entity_component_count(e) == 2u, "entity_component_count");
+
+    {
+        const auto proto = ecs::prototype()
+            .component<position_c>(3, 4)
+            .shared_component<int>(7);
+        std::vector<ecs::entity> es;
+        w.instantiate(proto, 10u, std::back_inserter(es));
+        require(es.size() == 10u, "instantiate");
+        require(w.shared_value_count<int>() == 1u, "shared_value_count");
+        require(w.component_count<position_c>() == 11u, "component_count");
+    }
+    {
+        auto c = e.clone();
+        w.set_parent(c, e);
+        w.assign_relation<int>(e, c, 1);
+        require(w.child_count(e) == 1u, "child_count");
+        require(w.relation_count<int>(e) == 1u, "relation_count");
+        require(w.destroy_hierarchy(e) == 2u, "destroy_hierarchy");
+        require(w.relation_count<int>() == 0u, "remove_all_relations");
+    }
+    {
+        auto t = w.create_entity();
+        w.assign_transient_component<damage_t>(t, 10);
+        w.assign_buffered_component<position_c>(t, 5, 6);
+        w.get_next_buffered_component<position_c>(t).x = 7;
+        w.swap_buffers<position_c>();
+        require(w.get_buffered_component<position_c>(t).x == 7, "swap_buffers");
+        w.end_frame();
+        require(!w.exists_transient_component<damage_t>(t), "end_frame");
+    }
+    {
+        w.reserve_entities(64u);
+        ecs::entity out{w};
+        require(w.try_create_entity(out) == ecs::status::ok, "try_create_entity");
+        require(w.valid_entity(out), "valid_entity");
+    }
+    {
+        ecs::static_registry<position_c> sw;
+        auto se = sw.create_entity();
+        se.assign_component<position_c>(1, 1);
+        require(se.exists_component<position_c>(), "static_registry");
+    }
+    return 0;
+}